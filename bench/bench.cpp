@@ -0,0 +1,339 @@
+#include "backend.h"
+#include "converter.h"
+#include "corpusgenerator.h"
+#include "directoryscanner.h"
+#include "imagelist.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QtTest>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace {
+struct BenchOptions {
+  CorpusSpec corpus;
+  // 转换基准只取前若干张，避免大图库时单次迭代过长。
+  int convertPages = 200;
+  QString corpusPath;
+  QString jsonPath = QStringLiteral("images2pdf-bench.json");
+};
+
+// 每项基准的总耗时与迭代次数，结束后换算为每秒处理量写入 JSON。
+struct BenchResult {
+  QString name;
+  qint64 iterations = 0;
+  qint64 elapsedNsecs = 0;
+  qint64 itemsPerIteration = 0;
+  qint64 bytesPerIteration = 0;
+};
+
+QJsonObject resultToJson(const BenchResult &result) {
+  QJsonObject object;
+  object.insert(QStringLiteral("name"), result.name);
+  object.insert(QStringLiteral("iterations"), result.iterations);
+  if (result.iterations <= 0 || result.elapsedNsecs <= 0)
+    return object;
+  const double seconds =
+      double(result.elapsedNsecs) / 1e9 / double(result.iterations);
+  object.insert(QStringLiteral("msPerIteration"), seconds * 1000.0);
+  object.insert(QStringLiteral("itemsPerSecond"),
+                double(result.itemsPerIteration) / seconds);
+  if (result.bytesPerIteration > 0)
+    object.insert(QStringLiteral("megabytesPerSecond"),
+                  double(result.bytesPerIteration) / (1024.0 * 1024.0) /
+                      seconds);
+  return object;
+}
+
+bool parseSize(const QString &text, QSize *size) {
+  const QStringList parts = text.split(QLatin1Char('x'));
+  if (parts.size() != 2)
+    return false;
+  bool widthOk = false;
+  bool heightOk = false;
+  const QSize parsed(parts.at(0).toInt(&widthOk), parts.at(1).toInt(&heightOk));
+  if (!widthOk || !heightOk || parsed.isEmpty())
+    return false;
+  *size = parsed;
+  return true;
+}
+
+// 取出本程序自己的参数，其余原样交给 QTest（例如 -iterations、函数名）。
+bool parseArguments(const QStringList &arguments, BenchOptions *options,
+                    QStringList *testArguments, QString *error) {
+  testArguments->append(arguments.value(0));
+  for (int i = 1; i < arguments.size(); ++i) {
+    const QString &argument = arguments.at(i);
+    const auto value = [&]() -> QString {
+      return i + 1 < arguments.size() ? arguments.at(++i) : QString();
+    };
+    bool ok = true;
+    if (argument == QLatin1String("--images")) {
+      options->corpus.imageCount = value().toInt(&ok);
+      ok = ok && options->corpus.imageCount > 0;
+    } else if (argument == QLatin1String("--per-directory")) {
+      options->corpus.filesPerDirectory = value().toInt(&ok);
+      ok = ok && options->corpus.filesPerDirectory > 0;
+    } else if (argument == QLatin1String("--size")) {
+      ok = parseSize(value(), &options->corpus.imageSize);
+    } else if (argument == QLatin1String("--format")) {
+      options->corpus.format = value().toLatin1();
+      ok = !options->corpus.format.isEmpty();
+    } else if (argument == QLatin1String("--seed")) {
+      options->corpus.seed = value().toUInt(&ok);
+    } else if (argument == QLatin1String("--convert-pages")) {
+      options->convertPages = value().toInt(&ok);
+      ok = ok && options->convertPages > 0;
+    } else if (argument == QLatin1String("--corpus")) {
+      options->corpusPath = value();
+      ok = !options->corpusPath.isEmpty();
+    } else if (argument == QLatin1String("--json")) {
+      options->jsonPath = value();
+      ok = !options->jsonPath.isEmpty();
+    } else {
+      testArguments->append(argument);
+      continue;
+    }
+    if (!ok) {
+      *error = QStringLiteral("参数无效：%1").arg(argument);
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+class Images2PdfBenchmark : public QObject {
+  Q_OBJECT
+public:
+  explicit Images2PdfBenchmark(BenchOptions options)
+      : m_options(std::move(options)) {}
+
+  const QList<BenchResult> &results() const { return m_results; }
+  const Corpus &corpus() const { return m_corpus; }
+
+private slots:
+  void initTestCase() {
+    QString root = m_options.corpusPath;
+    if (root.isEmpty()) {
+      m_temporaryDirectory = std::make_unique<QTemporaryDir>();
+      QVERIFY(m_temporaryDirectory->isValid());
+      root = m_temporaryDirectory->filePath(QStringLiteral("corpus"));
+    }
+    QElapsedTimer timer;
+    timer.start();
+    m_corpus = generateCorpus(root, m_options.corpus);
+    QVERIFY2(!m_corpus.files.isEmpty(), "无法生成测试图片");
+    qInfo("已生成 %s，用时 %lld ms",
+          qPrintable(describeCorpus(m_options.corpus)), timer.elapsed());
+
+    // 打乱后的列表模拟用户按任意顺序拖入的文件。
+    m_shuffled = m_corpus.files;
+    QRandomGenerator random(m_options.corpus.seed);
+    for (qsizetype i = m_shuffled.size() - 1; i > 0; --i)
+      m_shuffled.swapItemsAt(i, random.bounded(int(i + 1)));
+  }
+
+  // 目录扫描本身，不经过模型与事件循环。
+  void scanDirectory() {
+    const std::atomic_bool cancelled(false);
+    qsizetype found = 0;
+    measure([&]() {
+      found = 0;
+      streamImageDirectory(m_corpus.rootPath, true, &cancelled,
+                           [&found](const QStringList &batch) {
+                             found += batch.size();
+                           });
+    });
+    QCOMPARE(found, m_corpus.files.size());
+    record(m_corpus.files.size(), 0);
+  }
+
+  // Backend::addDirectory 的完整流程：后台扫描、分批插入与保持有序。
+  void addDirectory() {
+    Backend backend;
+    measure([&]() {
+      backend.clearImages();
+      QVERIFY(backend.addDirectory(m_corpus.rootPath, true, true));
+      QTRY_VERIFY_WITH_TIMEOUT(
+          backend.imageCount() == m_corpus.files.size() &&
+              backend.statusText().startsWith(QStringLiteral("已选择")),
+          600000);
+    });
+    record(m_corpus.files.size(), 0);
+  }
+
+  void resortByName() { resort(Backend::SortNameAscending,
+                               Backend::SortNameDescending); }
+  void resortByTime() { resort(Backend::SortTimeNewestFirst,
+                               Backend::SortTimeOldestFirst); }
+
+  // 第二次添加同一批文件全部是重复项，只走去重判断。
+  void addImagesDedup() {
+    Backend backend;
+    measure([&]() {
+      backend.clearImages();
+      backend.addImages(m_shuffled);
+      backend.addImages(m_shuffled);
+    });
+    QCOMPARE(backend.imageCount(), int(m_corpus.files.size()));
+    record(m_shuffled.size() * 2, 0);
+  }
+
+  // 与 Backend::processBatchInsert 相同的步骤：每批 256 条先排序，
+  // 再按位置合并进已排好序的模型。
+  void batchInsert() {
+    constexpr qsizetype kBatchSize = 256;
+    ImageModel model;
+    NameSortKeyCache keys;
+    measure([&]() {
+      model.clear();
+      for (qsizetype begin = 0; begin < m_shuffled.size();
+           begin += kBatchSize) {
+        QStringList chunk = m_shuffled.mid(begin, kBatchSize);
+        sortImagesByName(chunk, true, &keys);
+        model.insertSorted(chunk, imageNameLessThan(true, &keys));
+      }
+    });
+    QCOMPARE(model.count(), int(m_shuffled.size()));
+    record(m_shuffled.size(), 0);
+  }
+
+  void convertToPdf() { convert(ConversionOptions()); }
+
+  // 与 convertToPdf 对照，差值即预读省下的读盘等待。语料刚生成时都在页缓存
+  // 中，要在冷缓存下比较请先清空缓存，或用 --corpus 把语料生成到慢速存储上。
+  void convertWithoutReadahead() {
+    ConversionOptions options;
+    options.readaheadFiles = 0;
+    convert(options);
+  }
+
+private:
+  void convert(ConversionOptions options) {
+    const QStringList files = m_corpus.files.mid(0, m_options.convertPages);
+    qint64 inputBytes = 0;
+    for (const QString &file : files)
+      inputBytes += QFileInfo(file).size();
+
+    QTemporaryDir output;
+    QVERIFY(output.isValid());
+    options.outputFile = output.filePath(QStringLiteral("bench.pdf"));
+    ConversionResult result;
+    measure([&]() {
+      PdfConverter converter(files, options);
+      result = converter.run();
+    });
+    QVERIFY2(result.success, qPrintable(result.errorText));
+    QCOMPARE(result.convertedPages, int(files.size()));
+    record(files.size(), inputBytes);
+  }
+
+  void resort(Backend::SortMode first, Backend::SortMode second) {
+    Backend backend;
+    backend.setSortMode(Backend::SortManual);
+    backend.addImages(m_shuffled);
+    bool useFirst = true;
+    measure([&]() {
+      backend.setSortMode(useFirst ? first : second);
+      useFirst = !useFirst;
+    });
+    record(m_shuffled.size(), 0);
+  }
+
+  // QBENCHMARK 会按测量方式决定重复次数，这里另外统计总的挂钟时间，
+  // 以便换算为每秒处理量。
+  template <typename Body> void measure(Body body) {
+    m_iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+      body();
+      ++m_iterations;
+    }
+    m_elapsedNsecs = timer.nsecsElapsed();
+  }
+
+  void record(qint64 items, qint64 bytes) {
+    BenchResult result;
+    result.name = QString::fromLatin1(QTest::currentTestFunction());
+    result.iterations = m_iterations;
+    result.elapsedNsecs = m_elapsedNsecs;
+    result.itemsPerIteration = items;
+    result.bytesPerIteration = bytes;
+    m_results.append(result);
+  }
+
+  BenchOptions m_options;
+  std::unique_ptr<QTemporaryDir> m_temporaryDirectory;
+  Corpus m_corpus;
+  QStringList m_shuffled;
+  QList<BenchResult> m_results;
+  qint64 m_iterations = 0;
+  qint64 m_elapsedNsecs = 0;
+};
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName(QStringLiteral("images2pdf-bench"));
+  // 扫描索引等缓存写到测试专用目录，不影响正常使用时的缓存。
+  QStandardPaths::setTestModeEnabled(true);
+
+  BenchOptions options;
+  QStringList testArguments;
+  QString error;
+  if (!parseArguments(app.arguments(), &options, &testArguments, &error)) {
+    QTextStream(stderr) << error << '\n';
+    return 2;
+  }
+
+  Images2PdfBenchmark benchmark(options);
+  const int failures = QTest::qExec(&benchmark, testArguments);
+
+  QJsonObject corpus;
+  corpus.insert(QStringLiteral("description"), describeCorpus(options.corpus));
+  corpus.insert(QStringLiteral("images"), options.corpus.imageCount);
+  corpus.insert(QStringLiteral("width"), options.corpus.imageSize.width());
+  corpus.insert(QStringLiteral("height"), options.corpus.imageSize.height());
+  corpus.insert(QStringLiteral("format"),
+                QString::fromLatin1(options.corpus.format));
+  corpus.insert(QStringLiteral("seed"), qint64(options.corpus.seed));
+  corpus.insert(QStringLiteral("bytes"), benchmark.corpus().totalBytes);
+
+  QJsonArray results;
+  for (const BenchResult &result : benchmark.results())
+    results.append(resultToJson(result));
+
+  QJsonObject report;
+  report.insert(QStringLiteral("schema"), 1);
+  report.insert(QStringLiteral("timestamp"),
+                QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+  report.insert(QStringLiteral("qtVersion"), QString::fromLatin1(qVersion()));
+  report.insert(QStringLiteral("threads"), QThread::idealThreadCount());
+  report.insert(QStringLiteral("failures"), failures);
+  report.insert(QStringLiteral("corpus"), corpus);
+  report.insert(QStringLiteral("results"), results);
+
+  QFile file(options.jsonPath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    QTextStream(stderr) << "无法写入 " << options.jsonPath << '\n';
+    return 2;
+  }
+  file.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+  return failures == 0 ? 0 : 1;
+}
+
+#include "bench.moc"
@@ -0,0 +1,100 @@
+#include "corpusgenerator.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QRandomGenerator>
+#include <QTimeZone>
+#include <algorithm>
+#include <vector>
+
+namespace {
+QString extensionForFormat(const QByteArray &format) {
+  const QByteArray lower = format.toLower();
+  if (lower == "jpeg")
+    return QStringLiteral("jpg");
+  if (lower == "tiff")
+    return QStringLiteral("tif");
+  return QString::fromLatin1(lower);
+}
+
+// 每张图由种子决定的渐变与条纹组成，内容互不相同，编码后的大小也接近
+// 真实照片或扫描件，而不是几乎不占空间的纯色图。
+QImage syntheticImage(const QSize &size, quint32 seed) {
+  QRandomGenerator random(seed);
+  const int ax = int(random.bounded(1u, 7u));
+  const int ay = int(random.bounded(1u, 7u));
+  const int stripe = int(random.bounded(3u, 17u));
+  const int base = int(random.bounded(256u));
+
+  QImage image(size, QImage::Format_RGB32);
+  for (int y = 0; y < size.height(); ++y) {
+    auto *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+    for (int x = 0; x < size.width(); ++x) {
+      const int r = (x * ax + base) & 0xff;
+      const int g = (y * ay + base / 2) & 0xff;
+      const int b = ((x + y) / stripe % 2) ? 200 : 40;
+      line[x] = qRgb(r, g, b ^ ((x * y + base) & 0x1f));
+    }
+  }
+  return image;
+}
+} // namespace
+
+Corpus generateCorpus(const QString &rootPath, const CorpusSpec &spec) {
+  Corpus corpus;
+  corpus.rootPath = QDir(rootPath).absolutePath();
+  if (spec.imageCount <= 0 || spec.imageSize.isEmpty() ||
+      !QDir().mkpath(corpus.rootPath))
+    return corpus;
+
+  // 修改时间是文件序号的一个固定排列，按时间排序与按名称排序的结果不同。
+  std::vector<int> order(spec.imageCount);
+  for (int i = 0; i < spec.imageCount; ++i)
+    order[i] = i;
+  QRandomGenerator shuffle(spec.seed);
+  for (int i = spec.imageCount - 1; i > 0; --i)
+    std::swap(order[i], order[shuffle.bounded(i + 1)]);
+
+  const QDateTime baseTime(QDate(2020, 1, 1), QTime(0, 0), QTimeZone::UTC);
+  const QString extension = extensionForFormat(spec.format);
+  const int perDirectory = std::max(1, spec.filesPerDirectory);
+  corpus.files.reserve(spec.imageCount);
+
+  for (int i = 0; i < spec.imageCount; ++i) {
+    const int directory = i / perDirectory;
+    const QString directoryPath =
+        corpus.rootPath + QStringLiteral("/set-%1/part-%2")
+                              .arg(directory / 10)
+                              .arg(directory % 10);
+    if (i % perDirectory == 0 && !QDir().mkpath(directoryPath))
+      return Corpus();
+
+    // 序号不补零，排序时需要按自然顺序处理数字。
+    const QString filePath =
+        directoryPath + QStringLiteral("/IMG_%1.").arg(i) + extension;
+    QImageWriter writer(filePath, spec.format);
+    if (!writer.write(syntheticImage(spec.imageSize, spec.seed * 7919u + i)))
+      return Corpus();
+
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadWrite)) {
+      file.setFileTime(baseTime.addSecs(qint64(order[i]) * 60),
+                       QFileDevice::FileModificationTime);
+      corpus.totalBytes += file.size();
+    }
+    corpus.files.append(filePath);
+  }
+  return corpus;
+}
+
+QString describeCorpus(const CorpusSpec &spec) {
+  return QStringLiteral("%1 x %2x%3 %4, seed %5")
+      .arg(spec.imageCount)
+      .arg(spec.imageSize.width())
+      .arg(spec.imageSize.height())
+      .arg(QString::fromLatin1(spec.format))
+      .arg(spec.seed);
+}
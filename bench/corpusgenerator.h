@@ -0,0 +1,34 @@
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+// 基准测试用的合成图片目录。相同的参数总是生成相同的文件名、像素内容
+// 与修改时间，不同机器上的结果因而可以直接比较。
+struct CorpusSpec {
+  int imageCount = 2000;
+  // 每个子目录的文件数，目录按两层展开以覆盖递归扫描。
+  int filesPerDirectory = 100;
+  QSize imageSize = QSize(320, 240);
+  // QImageWriter 的格式名，同时决定扩展名。
+  QByteArray format = "jpeg";
+  quint32 seed = 1;
+};
+
+struct Corpus {
+  QString rootPath;
+  // 按生成顺序排列的绝对路径。
+  QStringList files;
+  qint64 totalBytes = 0;
+};
+
+// 在 rootPath 下生成图片；已有同名文件会被覆盖。失败时返回的 files 为空。
+Corpus generateCorpus(const QString &rootPath, const CorpusSpec &spec);
+
+// 便于写入 JSON 报告的描述，例如 "2000 x 320x240 jpeg, seed 1"。
+QString describeCorpus(const CorpusSpec &spec);
+
+#endif // CORPUSGENERATOR_H
@@ -2,20 +2,61 @@
 #define BACKEND_H
 
 #include <QAbstractListModel>
+#include <QFileSystemWatcher>
 #include <QFutureWatcher>
 #include <QObject>
-#include <QPageSize>
+#include <QSet>
+#include <QSize>
 #include <QString>
 #include <QStringList>
+#include <QThreadPool>
 #include <QTimer>
+#include <QVariantMap>
 #include <atomic>
+#include <memory>
+#include <vector>
+
+#include "conversiontrace.h"
+#include "converter.h"
+#include "filemetadata.h"
+#include "imagelist.h"
+#include "jobqueue.h"
+
+// 列表行的附加信息，首次显示时在后台读取。
+struct ImageDetails {
+  qint64 fileSize = -1;
+  QSize pixelSize;
+  QString format;
+  // 按默认转换选项粗略估计的页面图像字节数。
+  qint64 estimatedBytes = -1;
+  bool decodeError = false;
+  // 多页 TIFF 与动画 GIF/WebP 的帧数，转换时每帧一页。
+  int frameCount = 1;
+};
 
 class ImageModel : public QAbstractListModel {
   Q_OBJECT
 public:
-  enum Roles { PathRole = Qt::UserRole + 1 };
+  enum Roles {
+    PathRole = Qt::UserRole + 1,
+    DetailsLoadedRole,
+    FileSizeRole,
+    PixelSizeRole,
+    FormatRole,
+    EstimatedBytesRole,
+    DecodeErrorRole,
+    FrameCountRole
+  };
 
   explicit ImageModel(QObject *parent = nullptr);
+  ~ImageModel() override;
+
+  // 附加信息依赖的元数据缓存；须在视图首次取数据前设置。
+  void setMetadataCache(FileMetadataCache *metadata);
+  // 停止后台读取并等待进行中的任务结束，元数据缓存析构前调用。
+  void stopDetailLoading();
+  // 目录内容有变化时丢弃其中文件的附加信息，可见行会重新读取。
+  void invalidateDirectory(const QString &directoryPath);
 
   int rowCount(const QModelIndex &parent = QModelIndex()) const override;
   QVariant data(const QModelIndex &index,
@@ -23,6 +64,8 @@ public:
   QHash<int, QByteArray> roleNames() const override;
 
   void addPaths(const QStringList &paths);
+  // paths 须已按 lessThan 排好序且都不在列表中；逐段插入，不重置模型。
+  void insertSorted(const QStringList &paths, const ImageLessThan &lessThan);
   void removeAt(int index);
   void move(int from, int to);
   void clear();
@@ -30,14 +73,50 @@ public:
 
   const QStringList &getList() const;
   int count() const;
+  bool contains(const QString &path) const;
 
 private:
+  struct DetailRequest {
+    QString path;
+    // 请求时的行号，结果回来时先按它查找，行被移动后才退回线性查找。
+    int rowHint;
+  };
+  struct DetailResult {
+    QString path;
+    int rowHint;
+    ImageDetails details;
+  };
+
+  void requestDetails(const QString &path, int row) const;
+  void dispatchDetailRequests();
+  void applyDetails(const std::vector<DetailResult> &results);
+  void emitDetailsChanged();
+
   QStringList m_data;
+  // 与 m_data 内容相同的哈希索引，用于常数时间的去重判断。
+  QSet<QString> m_index;
+
+  // 附加信息按路径保存，插入、移动与重新排序都不会使其失效。
+  FileMetadataCache *m_metadata;
+  QHash<QString, ImageDetails> m_details;
+  // data() 由视图调用，只有已实例化的委托（视口及其缓冲区内的行）才会
+  // 触发读取；请求在事件循环中合并后分批交给线程池。
+  mutable std::vector<DetailRequest> m_detailQueue;
+  mutable QSet<QString> m_detailRequested;
+  mutable QTimer m_detailDispatchTimer;
+  int m_detailBatchesInFlight;
+  // 读取完成的行先攒起来，定时合并为连续区间发出 dataChanged。
+  std::vector<DetailRequest> m_changedDetails;
+  QTimer m_detailsChangedTimer;
+  std::atomic_bool m_stopDetailLoading;
+  QThreadPool m_detailPool;
 };
 
 class Backend : public QObject {
   Q_OBJECT
   Q_PROPERTY(QObject *imageModel READ imageModel CONSTANT)
+  // 转换任务列表（ConversionJobQueue），每次 convertToPdf 加入一个任务。
+  Q_PROPERTY(QObject *jobQueue READ jobQueue CONSTANT)
   Q_PROPERTY(int imageCount READ imageCount NOTIFY imageCountChanged)
 
   Q_PROPERTY(QString windowTitle READ windowTitle CONSTANT)
@@ -48,6 +127,10 @@ class Backend : public QObject {
                  conversionProgressChanged)
   Q_PROPERTY(int sortMode READ sortMode WRITE setSortMode NOTIFY
                  sortModeChanged)
+  // 最近一次扫描与转换的性能摘要：{ "scan": {...}, "conversion": {...} }，
+  // 字段见 TraceSummary::toVariantMap。
+  Q_PROPERTY(QVariantMap performanceSummary READ performanceSummary NOTIFY
+                 performanceSummaryChanged)
 
 public:
   enum SortMode {
@@ -60,8 +143,10 @@ public:
   Q_ENUM(SortMode)
 
   explicit Backend(QObject *parent = nullptr);
+  ~Backend() override;
 
   QObject *imageModel() const;
+  QObject *jobQueue() const;
   int imageCount() const;
 
   QString windowTitle() const;
@@ -70,10 +155,14 @@ public:
   double conversionProgress() const;
   int sortMode() const;
   void setSortMode(int mode);
+  QVariantMap performanceSummary() const;
+  // 与缩略图提供器共用，生命周期随 Backend。
+  FileMetadataCache *metadataCache();
 
   Q_INVOKABLE void addImages(const QStringList &paths);
   Q_INVOKABLE bool addDirectory(const QString &directoryPath,
-                                bool includeSubdirectories = true);
+                                bool includeSubdirectories = true,
+                                bool forceRescan = false);
   Q_INVOKABLE void removeImage(int index);
   Q_INVOKABLE void moveImage(int fromIndex, int toIndex);
   Q_INVOKABLE void clearImages();
@@ -82,7 +171,11 @@ public:
                bool stretchToPage = false,
                const QString &pageSizeId = QStringLiteral("A4"),
                bool landscapeOrientation = false,
-               bool convertToGrayscale = false);
+               bool convertToGrayscale = false, bool jpegPassthrough = true,
+               int effectiveDpi = 0, int bilevelMode = 0, int splitMode = 0,
+               int splitValue = 0, bool appendToExisting = false,
+               bool automaticEncoding = false);
+  Q_INVOKABLE void cancelConversion();
 
 signals:
   void statusTextChanged();
@@ -90,33 +183,51 @@ signals:
   void conversionRunningChanged();
   void conversionProgressChanged();
   void sortModeChanged();
+  void performanceSummaryChanged();
 
 private:
   void setStatusText(const QString &text);
   void setConversionRunning(bool running);
   void setConversionProgress(double progress);
   QString cleanedPath(const QString &path) const;
-  QPageSize pageSizeFromName(const QString &pageName) const;
   void applyCurrentSort(bool announceChange);
   static SortMode normalizeSortMode(int value);
-  void resortByName(QStringList &entries, bool ascending) const;
-  void resortByTime(QStringList &entries, bool newestFirst) const;
   QString sortDescription(SortMode mode) const;
+  void handleScanResultsReady(int begin, int end);
   void handleDirectoryScanFinished();
-  void startBatchInsert(QStringList files);
   void processBatchInsert();
+  void finishBatchInsert();
+  void insertImages(QStringList paths);
+  void watchParentDirectories(const QStringList &paths);
+  void handleWatchedDirectoryChanged(const QString &directoryPath);
+  void handleJobFinished(int jobId, const QString &title,
+                         const ConversionResult &result,
+                         const QVariantMap &performance);
+  void updatePerformanceSummary(const QString &key,
+                                const ConversionTrace &trace);
 
   QString m_windowTitle;
   QString m_statusText;
   bool m_conversionRunning;
   double m_conversionProgress;
   SortMode m_sortMode;
+  bool m_orderDisturbed;
 
   ImageModel *m_model;
   QFutureWatcher<QStringList> m_scanWatcher;
   QStringList m_pendingInsert;
+  QSet<QString> m_scanKnownPaths;
+  int m_scanFoundCount;
+  FileMetadataCache m_metadata;
+  QFileSystemWatcher m_directoryWatcher;
+  QSet<QString> m_watchedDirectories;
+  NameSortKeyCache m_nameSortKeys;
   QTimer m_batchInsertTimer;
   std::atomic_bool m_cancelScan;
+  ConversionJobQueue *m_jobs;
+  // 扫描线程与界面线程共享扫描的记录；转换的记录由各任务结束时汇报。
+  std::shared_ptr<ConversionTrace> m_scanTrace;
+  QVariantMap m_performanceSummary;
 };
 
 #endif // BACKEND_H
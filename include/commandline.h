@@ -0,0 +1,12 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QStringList>
+
+// 启动参数中包含 --input、--job 等选项时进入无界面的批处理模式。
+bool isCommandLineInvocation(int argc, char *argv[]);
+
+// 在 QCoreApplication 下执行命令行任务，返回进程退出码。
+int runCommandLine(const QStringList &arguments);
+
+#endif // COMMANDLINE_H
@@ -0,0 +1,10 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 非加密哈希，用于在同一任务内识别内容相同的图片。
+uint64_t xxHash64(const void *data, size_t length, uint64_t seed = 0);
+
+#endif // CONTENTHASH_H
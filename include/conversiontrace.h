@@ -0,0 +1,116 @@
+#ifndef CONVERSIONTRACE_H
+#define CONVERSIONTRACE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include <array>
+#include <vector>
+
+// 转换与扫描中可单独计时的阶段。
+enum class TraceStage {
+  Read,      // 读入（映射）文件
+  Readahead, // 为后续文件发出预读提示
+  Hash,      // 内容哈希（去重）
+  Decode,    // 解码为像素
+  Grayscale, // 灰度转换
+  Resample,  // 缩放
+  Bilevel,   // 二值化
+  Analyze,   // 自动编码前的内容分析
+  Encode,    // 重新压缩（JPEG / Flate）
+  Wait,      // 写入线程等待解码结果
+  Write,     // 写入 PDF 文件
+  Finish,    // 写出页面树与交叉引用表
+  Scan,      // 遍历目录
+  IndexLoad, // 读取扫描索引
+  IndexSave, // 保存扫描索引
+  Count
+};
+
+const char *traceStageName(TraceStage stage);
+
+struct TraceEvent {
+  TraceStage stage;
+  // 页面序号；与页面无关的阶段为 -1。
+  int page;
+  qint64 startNsecs;
+  qint64 durationNsecs;
+  qint64 bytes;
+  quint64 threadId;
+};
+
+struct TraceSummary {
+  struct StageTotals {
+    qint64 nsecs = 0;
+    qint64 bytes = 0;
+    int count = 0;
+  };
+
+  int pages = 0;
+  qint64 elapsedNsecs = 0;
+  qint64 inputBytes = 0;
+  qint64 outputBytes = 0;
+  qint64 peakRssBytes = 0;
+  std::array<StageTotals, static_cast<size_t>(TraceStage::Count)> stages;
+
+  // 供 QML 使用：pagesPerSecond、inputMBps、outputMBps、peakRssBytes、
+  // 最耗时的阶段 bottleneck 与按累计耗时排列的 stages 列表。
+  QVariantMap toVariantMap() const;
+};
+
+// 记录一次任务中各阶段的起止时间与字节数，可在任意线程调用。
+// 每页每阶段一条记录，锁的开销相对于解码与压缩可以忽略。
+class ConversionTrace {
+public:
+  ConversionTrace();
+
+  // 自构造以来经过的纳秒数，作为所有事件的时间基准。
+  qint64 now() const;
+  void record(TraceStage stage, int page, qint64 startNsecs, qint64 bytes = 0);
+
+  // 完成的页数（扫描时为找到的图片数），可多次累加。
+  void addPages(int pages);
+  void addInputBytes(qint64 bytes);
+  void addOutputBytes(qint64 bytes);
+
+  TraceSummary summary() const;
+  // Chrome Trace Event 格式（JSON），可在 Perfetto 或 chrome://tracing 中查看。
+  bool writeChromeTrace(const QString &filePath, QString *error) const;
+
+private:
+  QElapsedTimer m_clock;
+  mutable QMutex m_mutex;
+  std::vector<TraceEvent> m_events;
+  int m_pages;
+  qint64 m_inputBytes;
+  qint64 m_outputBytes;
+};
+
+// 作用域计时：析构时记录一条事件；trace 为空时什么也不做。
+class TraceScope {
+public:
+  TraceScope(ConversionTrace *trace, TraceStage stage, int page = -1)
+      : m_trace(trace), m_stage(stage), m_page(page),
+        m_start(trace ? trace->now() : 0), m_bytes(0) {}
+  ~TraceScope() {
+    if (m_trace)
+      m_trace->record(m_stage, m_page, m_start, m_bytes);
+  }
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  void setBytes(qint64 bytes) { m_bytes = bytes; }
+
+private:
+  ConversionTrace *m_trace;
+  TraceStage m_stage;
+  int m_page;
+  qint64 m_start;
+  qint64 m_bytes;
+};
+
+// 进程迄今为止的峰值常驻内存，无法取得时返回 0。
+qint64 peakResidentSetBytes();
+
+#endif // CONVERSIONTRACE_H
@@ -0,0 +1,214 @@
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include <QList>
+#include <QObject>
+#include <QPageSize>
+#include <QRect>
+#include <QSizeF>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "pixelops.h"
+#include "resampler.h"
+
+class ConversionTrace;
+
+// 分卷方式：每卷是独立、完整的 PDF。
+enum class OutputSplit {
+  None = 0,
+  ByPageCount,   // 每卷 splitPageCount 页
+  ByInputSize,   // 按输入文件大小累计，每卷不超过 splitBytes
+  BySubdirectory // 源文件所在目录变化时开始新的一卷
+};
+
+struct ConversionOptions {
+  QString outputFile;
+  int marginMillimeters = 10;
+  bool stretchToPage = false;
+  QPageSize pageSize = QPageSize(QPageSize::A4);
+  bool landscapeOrientation = false;
+  bool convertToGrayscale = false;
+  // 二值化为 1 位黑白页面，适合文字扫描件；开启时隐含灰度转换。
+  BilevelMode bilevelMode = BilevelMode::Off;
+  // JPEG 文件尽量原样嵌入，不解码也不重新压缩。
+  bool jpegPassthrough = true;
+  // 8 位灰度或 RGB 的 PNG 直接嵌入 IDAT 数据，同样不解码。
+  bool pngPassthrough = true;
+  // 无损页面（灰度、黑白与无 JPEG 插件时的彩色）的 zlib 压缩级别 0～9；
+  // 大页面分块在多个线程上同时压缩。
+  int flateLevel = 6;
+  // 按每页内容自动选择编码：先对解码（及缩小）后的图像做一遍采样分析，
+  // 分为黑白、灰度、调色板与彩色四类，各用最小的合适编码与位深。
+  // 指定了黑白二值化时不起作用。reportEncoding 额外按固定编码再编码一次，
+  // 以便报告节省的字节数。
+  bool automaticEncoding = false;
+  bool reportEncoding = false;
+  // 有效分辨率：大于 0 时把图片缩小到目标区域在该 dpi 下的像素尺寸，
+  // 已经足够小的图片不会被放大。
+  int effectiveDpi = 0;
+  ResampleFilter resampleFilter = ResampleFilter::Lanczos3;
+  // 整幅解码超过这么多字节（按每像素 4 字节估算）的图像改为按条带或瓦片
+  // 分段读取并边读边缩小，0 表示始终整幅解码。默认值与 Qt 图像读取的
+  // 默认内存上限相同，超过它的图像原本无法解码。
+  qint64 streamingThresholdBytes = 256LL * 1024 * 1024;
+  // 按文件内容哈希去重，重复的页面共用同一个图像对象；
+  // pixelDeduplication 额外比较解码编码后的图像数据。
+  bool deduplicateImages = true;
+  bool pixelDeduplication = false;
+  // 同时处于解码中的页面上限，0 表示按线程数自动选择。
+  int maxPagesInFlight = 0;
+  // 本任务可用的解码线程数，0 表示使用全部核心；多个任务同时运行时由
+  // 调度器分配。
+  int decodeThreads = 0;
+  // 输入文件以内存映射方式解码；当前页开始解码时，对其后最多
+  // readaheadFiles 个、合计不超过 readaheadBytes 的文件发出预读提示。
+  // 任一项为 0 时关闭预读；分卷同时写入时每卷各自计算。
+  int readaheadFiles = 16;
+  qint64 readaheadBytes = 128LL * 1024 * 1024;
+  // 分卷时输出文件名中的 %d 或 %03d 之类替换为卷号（从 1 开始）；
+  // 没有占位符时在扩展名前追加 -001 这样的编号。只有一卷时不编号。
+  OutputSplit split = OutputSplit::None;
+  int splitPageCount = 500;
+  qint64 splitBytes = 200LL * 1024 * 1024;
+  // 输出文件已存在时以增量更新的方式在末尾追加页面，原有内容保持不动；
+  // 文件不存在时照常新建。追加时不分卷。
+  bool appendToExisting = false;
+};
+
+// 自动编码时一页的分类与结果。
+struct PageEncodingRecord {
+  QString fileName;
+  PageClass pageClass = PageClass::Color;
+  // 例如 "1 位黑白 Flate"、"灰度 JPEG"、"4 位索引色 Flate"。
+  QString encoding;
+  qint64 bytes = 0;
+  // 固定编码时的大小，只在 reportEncoding 时计算，否则为 -1。
+  qint64 baselineBytes = -1;
+};
+
+struct ConversionResult {
+  bool success = false;
+  bool cancelled = false;
+  int convertedPages = 0;
+  int passthroughPages = 0;
+  int resampledPages = 0;
+  int deduplicatedPages = 0;
+  qint64 deduplicatedBytes = 0;
+  QStringList failedFiles;
+  // 实际写出的文件，分卷时按卷号排列。
+  QStringList outputFiles;
+  // 追加模式下输出文件原有的页数。
+  int existingPages = 0;
+  // 自动编码时各类页面的页数（下标为 PageClass）与逐页记录；
+  // encodingSavedBytes 只统计算过固定编码大小的页面。
+  std::array<int, 4> pagesByClass = {};
+  QList<PageEncodingRecord> encodingRecords;
+  qint64 encodingSavedBytes = 0;
+  QString errorText;
+};
+
+// 版面：页面大小以点为单位，内容区域以 300 dpi 的设备像素为单位。
+struct PageGeometry {
+  QSizeF pageSizePoints;
+  QRect pageRect;
+  double pointsPerPixel = 0;
+};
+
+// 一卷包含文件列表中连续的一段。
+struct OutputVolume {
+  int firstFile = 0;
+  int fileCount = 0;
+  QString outputFile;
+};
+
+// 任务可能写入的输出文件，只由选项与文件数推出，不访问文件系统。
+// 路径已规范为绝对路径（大小写不敏感的系统上统一为小写）；可能分卷时
+// 各卷的文件名为 volumePrefix + 卷号 + volumeSuffix，只有一卷时为 single。
+struct PlannedOutputs {
+  QString single;
+  bool mayBeSplit = false;
+  QString volumePrefix;
+  QString volumeSuffix;
+};
+
+PlannedOutputs plannedOutputs(const ConversionOptions &options, int fileCount);
+// 两个任务是否可能写同一个文件。卷数未知，两边都可能分卷时按卷名的
+// 前后缀保守判断。
+bool outputsOverlap(const PlannedOutputs &a, const PlannedOutputs &b);
+
+// 后台转换引擎：解码、灰度化、编码与版面计算在线程池中并行完成，
+// 写入阶段按原始顺序逐页交给 PdfDocument。分卷时各卷由各自的写入线程
+// 同时生成，解码线程在各卷之间平分。
+class PdfConverter : public QObject {
+  Q_OBJECT
+public:
+  PdfConverter(QStringList files, ConversionOptions options,
+               QObject *parent = nullptr);
+
+  // 预检得到的文件大小，与文件列表一一对应，-1 表示未知。大小独一无二的
+  // 文件不可能与其它文件内容相同，去重时无需读入整个文件求哈希。
+  void setKnownFileSizes(QList<qint64> sizes);
+  // 记录各页各阶段的耗时与字节数；trace 须比 run() 活得更久。
+  void setTrace(ConversionTrace *trace);
+
+  // 按分卷选项划分文件列表；需要文件大小时对未知的条目做 stat。
+  QList<OutputVolume> planVolumes() const;
+
+  // 同步执行整个任务，可在任意线程调用。
+  ConversionResult run();
+  void cancel();
+
+signals:
+  // 每写完一页（或跳过一页）后发出，跨线程时应使用排队连接。
+  // 分卷时 index 为全部卷合计已完成的页数减一。
+  void pageProcessed(int index, int total, const QString &fileName);
+
+private:
+  ConversionResult runVolume(const OutputVolume &volume,
+                             const PageGeometry &geometry, int decodeThreads,
+                             const std::atomic_bool *abort);
+
+  QStringList m_files;
+  QList<qint64> m_knownSizes;
+  ConversionTrace *m_trace;
+  ConversionOptions m_options;
+  std::atomic_bool m_cancelRequested;
+  std::atomic_int m_pagesDone;
+};
+
+// 页数事先未知、文件陆续到达的 PDF（监视文件夹时使用）：追加的文件立即
+// 在后台解码，并按追加顺序写入文件；finish() 时补写页面树与交叉引用表。
+// 与 PdfConverter 的单卷相同，内容相同的图片在文档内只写一次。
+// append() 与 finish() 不能同时调用，finish() 之后不能再追加。
+class IncrementalPdfWriter {
+public:
+  explicit IncrementalPdfWriter(ConversionOptions options);
+  // 未调用 finish() 时放弃尚未解码的页面并丢弃输出文件。
+  ~IncrementalPdfWriter();
+  IncrementalPdfWriter(const IncrementalPdfWriter &) = delete;
+  IncrementalPdfWriter &operator=(const IncrementalPdfWriter &) = delete;
+
+  // 须在 open() 之前设置，trace 须比本对象活得更久。
+  void setTrace(ConversionTrace *trace);
+  bool open(QString *error);
+  void append(const QStringList &files);
+  // 已追加的文件数（包括尚未写入的）。
+  int appendedCount() const;
+  // 等待已追加的页面全部写入后提交文件，可在任意线程调用。
+  ConversionResult finish();
+
+private:
+  struct State;
+  void writeLoop();
+
+  ConversionOptions m_options;
+  ConversionTrace *m_trace;
+  int m_appended;
+  std::unique_ptr<State> m_state;
+};
+
+#endif // CONVERTER_H
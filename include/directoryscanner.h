@@ -0,0 +1,26 @@
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+
+class ScanIndex;
+
+// 每收集到一批图片路径就调用一次；调用已串行化，但可能来自任意扫描线程。
+using ScanBatchCallback = std::function<void(const QStringList &)>;
+
+// 并行扫描目录树：子目录分散到各线程的工作队列，空闲线程从其它队列窃取。
+// POSIX 上直接用 readdir 读取 d_type，只有类型未知或符号链接时才 stat；
+// 扩展名按原始字节匹配，命中后才构造 QString。
+// 传入 index 时按目录修改时间增量扫描，并把本次结果记入索引（由调用方保存）。
+// 与 QDir::Files 的语义一致：跳过隐藏项，不跟随指向目录的符号链接，
+// 路径均为 cleanPath 后的绝对路径，同一次扫描中不会重复。
+void streamImageDirectory(const QString &directoryPath,
+                          bool includeSubdirectories,
+                          const std::atomic_bool *cancelFlag,
+                          const ScanBatchCallback &onBatch,
+                          ScanIndex *index = nullptr);
+
+#endif // DIRECTORYSCANNER_H
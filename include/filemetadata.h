@@ -0,0 +1,45 @@
+#ifndef FILEMETADATA_H
+#define FILEMETADATA_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+struct FileMetadata {
+  qint64 size = -1;
+  qint64 modifiedMsecs = 0;
+  // 无效表示尚未读取图片头部。
+  QSize pixelSize;
+};
+
+// 按路径缓存文件大小、修改时间与（按需读取的）像素尺寸，供各种排序方式与
+// 转换前的预检共用。可被多个线程同时读写。
+class FileMetadataCache {
+public:
+  bool lookup(const QString &path, FileMetadata *metadata) const;
+  // 只更新大小与时间；已读到的像素尺寸在文件未变时保留。
+  void insert(const QString &path, qint64 size, qint64 modifiedMsecs);
+  // 只在还没有记录时写入，不覆盖较新的信息（例如复用上次的扫描索引时）。
+  void insertIfAbsent(const QString &path, qint64 size, qint64 modifiedMsecs);
+
+  // 对缓存中没有的路径并行做一轮 stat，之后的 lookup 都能命中。
+  void ensure(const QStringList &paths);
+  // 命中缓存直接返回，否则读取文件信息后存入。
+  FileMetadata metadata(const QString &path);
+  // 不论是否命中都重新 stat 并更新记录；文件没变时保留已读到的像素尺寸。
+  FileMetadata refresh(const QString &path);
+  // 读取图片头部得到像素尺寸并缓存，失败时返回无效尺寸。
+  QSize pixelSize(const QString &path);
+
+  // 目录内容有变化时丢弃其中文件的记录，下次使用时重新读取。
+  void invalidateDirectory(const QString &directoryPath);
+  void clear();
+
+private:
+  mutable QReadWriteLock m_lock;
+  QHash<QString, FileMetadata> m_entries;
+};
+
+#endif // FILEMETADATA_H
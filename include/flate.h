@@ -0,0 +1,15 @@
+#ifndef FLATE_H
+#define FLATE_H
+
+#include <QByteArray>
+
+class QThreadPool;
+
+// 压缩为 zlib 流（/FlateDecode），level 为 0～9。有 zlib 时较大的数据按块
+// 分给 pool（为空时用全局线程池）并行压缩：每块以前一块末尾 32 KB 为预置
+// 字典，块之间用同步刷新对齐到字节边界后直接拼接，校验和由各块的 Adler-32
+// 合并而成，结果仍是一个标准的 zlib 流。没有 zlib 时退回单线程的 qCompress。
+QByteArray flateCompress(const QByteArray &raw, int level,
+                         QThreadPool *pool = nullptr);
+
+#endif // FLATE_H
@@ -0,0 +1,106 @@
+#ifndef HOTFOLDER_H
+#define HOTFOLDER_H
+
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+#include "converter.h"
+
+struct HotFolderOptions {
+  QString directoryPath;
+  bool includeSubdirectories = true;
+  // conversion.outputFile 是文件名模板，实际文件名在扩展名前追加
+  // 开始写入时的时间，例如 scan.pdf -> scan-20240101-093000.pdf。
+  ConversionOptions conversion;
+  // 文件大小与修改时间保持这么久不变才视为写完。
+  int settleMilliseconds = 2000;
+  // 这么久没有新页面时完成当前 PDF；0 表示不按空闲时间完成。
+  int idleSeconds = 60;
+  // 当前 PDF 达到这么多页时完成，其余文件写入下一个；0 表示不限页数。
+  int maxPages = 0;
+  // 启动时已在文件夹中的图片也转换；否则只处理之后出现的文件。
+  bool includeExisting = false;
+};
+
+// 监视文件夹：新出现的图片在写完（大小与修改时间稳定）后立即追加到当前
+// 打开的 PDF，空闲一段时间或达到页数上限时完成该 PDF 并开始下一个。
+// 只在启动时遍历一次目录树；之后只重新列出有变化的目录，变化由
+// QFileSystemWatcher（Linux 上为 inotify）通知，另外定期比较目录的修改
+// 时间，兜底网络共享上收不到通知的情况。
+class HotFolderWatcher : public QObject {
+  Q_OBJECT
+public:
+  explicit HotFolderWatcher(HotFolderOptions options,
+                            QObject *parent = nullptr);
+  // 未完成的 PDF 被丢弃，需要保留时先调用 stop()。
+  ~HotFolderWatcher() override;
+
+  bool start(QString *error);
+  // 停止监视，完成当前 PDF 并等待所有 PDF 写完；尚未写完的输入文件不处理。
+  void stop();
+
+signals:
+  // 一批写完的文件已追加到 outputFile，pageCount 为该 PDF 目前的页数。
+  void filesAppended(const QString &outputFile, int count, int pageCount);
+  // 一个 PDF 完成（或无法创建、写入失败）。
+  void documentFinished(const QString &outputFile,
+                        const ConversionResult &result);
+
+private:
+  struct DirectoryState {
+    QSet<QString> files;
+    qint64 modifiedMsecs = 0;
+  };
+  struct PendingFile {
+    qint64 size = -1;
+    qint64 modifiedMsecs = 0;
+    qint64 stableSinceMsecs = 0;
+  };
+  struct FinishingDocument {
+    QString outputFile;
+    std::unique_ptr<IncrementalPdfWriter> writer;
+    std::unique_ptr<QFutureWatcher<ConversionResult>> watcher;
+  };
+
+  void watchTree(const QString &rootPath, bool filesAreNew);
+  void forgetDirectory(const QString &directoryPath);
+  void markDirectoryDirty(const QString &directoryPath);
+  void processDirtyDirectories();
+  void rescanDirectory(const QString &directoryPath);
+  void pollDirectoryTimes();
+  void pollSettlingFiles();
+  void queueNewFile(const QString &path);
+  void appendSettledFiles(QStringList files);
+  void finishCurrentDocument();
+  void handleDocumentFinished(FinishingDocument *document);
+  QString nextOutputFile();
+
+  HotFolderOptions m_options;
+  QFileSystemWatcher m_watcher;
+  // 每个被监视的目录中已知的图片（完整路径）与目录的修改时间。
+  QHash<QString, DirectoryState> m_directories;
+  QSet<QString> m_dirtyDirectories;
+  // 已发现但可能仍在写入的文件。
+  QHash<QString, PendingFile> m_settling;
+  QElapsedTimer m_clock;
+  QTimer m_dirtyTimer;
+  QTimer m_settleTimer;
+  QTimer m_idleTimer;
+  QTimer m_directoryPollTimer;
+  std::unique_ptr<IncrementalPdfWriter> m_document;
+  QString m_documentFile;
+  // 本次运行中用过的输出文件名，同一秒内开始的 PDF 不会重名。
+  QSet<QString> m_usedOutputFiles;
+  std::vector<std::unique_ptr<FinishingDocument>> m_finishing;
+};
+
+#endif // HOTFOLDER_H
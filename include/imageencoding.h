@@ -0,0 +1,48 @@
+#ifndef IMAGEENCODING_H
+#define IMAGEENCODING_H
+
+#include <QByteArray>
+#include <QImage>
+
+#include "pdfdocument.h"
+#include "pixelops.h"
+
+class QThreadPool;
+
+struct JpegInfo {
+  int width = 0;
+  int height = 0;
+  int components = 0;
+  int precision = 0;
+  int sofMarker = 0;
+  bool hasAdobeMarker = false;
+  int adobeTransform = -1;
+};
+
+// 只解析到 SOF 段为止，获取尺寸、分量数等信息，不解码像素。
+bool parseJpegHeader(const QByteArray &data, JpegInfo *info);
+
+// 尝试把原始 JPEG 字节直接作为 /DCTDecode 图像嵌入。
+// 无法直通的文件（如算术编码、YCCK 等）返回空图像，由调用方回退到解码路径。
+PdfImage jpegPassthroughImage(const QByteArray &data, bool requireGrayscale);
+
+// 尝试把 PNG 的 IDAT 数据直接作为 /FlateDecode 图像嵌入，/DecodeParms 用
+// PNG 预测器还原每行的过滤。只接受 8 位、非隔行的灰度或 RGB 图像，带透明色、
+// 调色板或 EXIF 方向的文件返回空图像，由调用方回退到解码路径。
+PdfImage pngPassthroughImage(const QByteArray &data, bool requireGrayscale);
+
+// 对已解码的图像重新编码：黑白二值图与灰度图使用 Flate（flateLevel 为
+// zlib 压缩级别），彩色图使用 JPEG（质量 94）。大图的 Flate 压缩在 pool
+// 上并行进行，见 flateCompress。
+PdfImage encodeDecodedImage(const QImage &image, int flateLevel = 6,
+                            QThreadPool *pool = nullptr);
+
+// 自动编码：按 analyzeImage 的分类选择最小的合适编码。黑白页面输出 1 位
+// Flate；灰度页面灰阶不超过 16 级时输出 1～4 位索引色，否则输出灰度 JPEG；
+// 调色板页面输出索引色 Flate，整幅图像颜色超过 256 种时退回彩色 JPEG。
+// applied 返回实际采用的分类。
+PdfImage encodeAnalyzedImage(const QImage &image,
+                             const ImageAnalysis &analysis, int flateLevel,
+                             PageClass *applied, QThreadPool *pool = nullptr);
+
+#endif // IMAGEENCODING_H
@@ -0,0 +1,62 @@
+#ifndef IMAGELIST_H
+#define IMAGELIST_H
+
+#include <QCollator>
+#include <QHash>
+#include <QPageSize>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+class FileMetadataCache;
+
+// 图片列表相关的公共逻辑，图形界面与命令行模式共用。
+
+bool hasSupportedExtension(const QString &filePath);
+// 按原始字节判断文件名的扩展名（ASCII 不区分大小写），不分配内存。
+bool hasSupportedExtension(const char *fileName, size_t length);
+
+// 递归（或仅当前层）收集目录中受支持的图片，结果已去重并经过 cleanPath，
+// 按路径排序以保证多线程扫描下顺序稳定。
+QStringList scanImageDirectory(const QString &directoryPath,
+                               bool includeSubdirectories,
+                               const std::atomic_bool *cancelFlag = nullptr);
+
+// 按文件名自然排序所需的排序键缓存：每个路径的文件名与完整路径各算一次
+// QCollatorSortKey，之后的比较只是字节比较。缺少的键会并行计算。
+// 除 prepare() 内部外不加锁，只应在一个线程中使用。
+class NameSortKeyCache {
+public:
+  struct Keys {
+    QCollatorSortKey fileName;
+    QCollatorSortKey path;
+  };
+
+  NameSortKeyCache();
+
+  void prepare(const QStringList &paths);
+  const Keys &keys(const QString &path);
+  void clear();
+
+private:
+  QCollator m_collator;
+  QHash<QString, Keys> m_keys;
+};
+
+// cache 为空时使用临时缓存；结果与逐对调用 QCollator::compare 的稳定排序相同。
+void sortImagesByName(QStringList &entries, bool ascending,
+                      NameSortKeyCache *cache = nullptr);
+// 修改时间取自 metadata；缺少的条目先并行读取一轮。为空时使用临时缓存。
+void sortImagesByTime(QStringList &entries, bool newestFirst,
+                      FileMetadataCache *metadata = nullptr);
+
+// 与上面两个排序函数完全相同的先后规则，用于把新条目合并进已排好序的列表。
+using ImageLessThan = std::function<bool(const QString &, const QString &)>;
+ImageLessThan imageNameLessThan(bool ascending, NameSortKeyCache *cache);
+ImageLessThan imageTimeLessThan(bool newestFirst, FileMetadataCache *metadata);
+
+QPageSize pageSizeFromName(const QString &pageName);
+
+#endif // IMAGELIST_H
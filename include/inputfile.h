@@ -0,0 +1,74 @@
+#ifndef INPUTFILE_H
+#define INPUTFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <deque>
+#include <utility>
+
+class ConversionTrace;
+
+// 以只读映射打开一个输入文件，data() 直接指向映射区域而不复制；映射失败
+// （空文件或不支持 mmap 的文件系统）时退回整体读入。data() 只在对象存活
+// 期间有效，需要保留的部分必须先复制出来。
+class MappedInputFile {
+public:
+  explicit MappedInputFile(const QString &filePath);
+  MappedInputFile(const MappedInputFile &) = delete;
+  MappedInputFile &operator=(const MappedInputFile &) = delete;
+
+  bool open();
+  const QByteArray &data() const { return m_data; }
+  bool isMapped() const { return m_mapped; }
+
+private:
+  QFile m_file;
+  QByteArray m_data;
+  bool m_mapped;
+};
+
+// 请求内核把文件开头最多 maxBytes 字节提前读入页缓存，不等待读取完成。
+// 返回提示的字节数；平台不支持或文件无法打开时返回 0。
+qint64 adviseWillNeed(const QString &filePath, qint64 maxBytes);
+
+// 为即将解码的文件发出预读提示：文件 N 开始解码时，把其后最多 maxFiles 个、
+// 合计不超过 maxBytes 的文件交给内核预读，让机械硬盘与网络存储上的读取和
+// 解码重叠。提示在独立的线程中按顺序发出，打开文件的延迟不会拖慢调用者。
+class InputReadahead {
+public:
+  // 只对 files 中 [firstFile, firstFile + fileCount) 的文件发出提示。
+  InputReadahead(const QStringList &files, int firstFile, int fileCount,
+                 int maxFiles, qint64 maxBytes, ConversionTrace *trace);
+  ~InputReadahead();
+  InputReadahead(const InputReadahead &) = delete;
+  InputReadahead &operator=(const InputReadahead &) = delete;
+
+  // 文件 index 已交给解码线程，它之前的文件不再占用预读额度。
+  void advance(int index);
+
+private:
+  void issue();
+
+  const QStringList m_files;
+  const int m_end;
+  const int m_maxFiles;
+  const qint64 m_maxBytes;
+  ConversionTrace *m_trace;
+
+  QMutex m_mutex;
+  int m_current;
+  int m_nextHint;
+  // 已提示但尚未开始解码的文件及其提示字节数。
+  std::deque<std::pair<int, qint64>> m_hinted;
+  qint64 m_hintedBytes;
+  bool m_running;
+  bool m_stopping;
+  // 最后声明、最先析构：先等提示线程结束，再释放它用到的成员。
+  QThreadPool m_pool;
+};
+
+#endif // INPUTFILE_H
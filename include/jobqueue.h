@@ -0,0 +1,111 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariantMap>
+#include <memory>
+#include <vector>
+
+#include "conversiontrace.h"
+#include "converter.h"
+
+// 转换任务队列：每个任务带有自己的文件列表快照与设置，按先来后到的顺序
+// 在全局的线程与内存预算内同时运行多个任务。作为列表模型暴露给 QML，
+// 每行包含任务名、状态、进度与状态文字。
+class ConversionJobQueue : public QAbstractListModel {
+  Q_OBJECT
+  Q_PROPERTY(int activeCount READ activeCount NOTIFY activeCountChanged)
+  Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+
+public:
+  enum Roles {
+    JobIdRole = Qt::UserRole + 1,
+    TitleRole,
+    StateRole,
+    ProgressRole,
+    StatusRole,
+    PageCountRole,
+    ThreadsRole
+  };
+
+  enum JobState { Queued = 0, Running, Finished, Failed, Cancelled };
+  Q_ENUM(JobState)
+
+  explicit ConversionJobQueue(QObject *parent = nullptr);
+  // 取消所有任务并等待正在运行的任务结束。
+  ~ConversionJobQueue() override;
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  // 加入队列并尽快调度，返回任务编号。knownSizes 与 files 一一对应，
+  // 用于去重预检与内存估计，-1 表示未知。
+  int enqueue(QStringList files, QList<qint64> knownSizes,
+              ConversionOptions options);
+
+  Q_INVOKABLE void cancelJob(int jobId);
+  Q_INVOKABLE void removeFinishedJobs();
+  void cancelAll();
+
+  // 排队中与运行中的任务数。
+  int activeCount() const;
+  // 排队中与运行中的任务按页数加权的总体进度。
+  double progress() const;
+
+  // 同时运行的任务解码时可占用的内存估计上限，超出时后面的任务继续排队。
+  void setMemoryBudget(qint64 bytes);
+
+signals:
+  void activeCountChanged();
+  void progressChanged();
+  // 任务结束（成功、失败或取消）时发出；performance 为该任务的性能摘要。
+  void jobFinished(int jobId, const QString &title,
+                   const ConversionResult &result,
+                   const QVariantMap &performance);
+
+private:
+  struct Job {
+    int id = 0;
+    QString title;
+    QStringList files;
+    QList<qint64> knownSizes;
+    ConversionOptions options;
+    // 可能写入的输出文件，用于避免两个任务同时写同一个文件。
+    PlannedOutputs outputs;
+    JobState state = Queued;
+    int pagesDone = 0;
+    QString status;
+    int threads = 0;
+    qint64 memoryEstimate = 0;
+    std::unique_ptr<ConversionTrace> trace;
+    std::unique_ptr<PdfConverter> converter;
+    std::unique_ptr<QFutureWatcher<ConversionResult>> watcher;
+  };
+
+  int rowOf(int jobId) const;
+  void schedule();
+  bool writesRunningOutput(const Job &job) const;
+  void startJob(Job &job, int threads);
+  void handleJobPageProcessed(int jobId, int index, int total,
+                              const QString &fileName);
+  void handleJobFinished(int jobId);
+  void notifyRow(int row);
+
+  std::vector<std::unique_ptr<Job>> m_jobs;
+  int m_nextJobId;
+  int m_threadBudget;
+  int m_threadsInUse;
+  qint64 m_memoryBudget;
+  qint64 m_memoryInUse;
+  // 各任务的写入线程在这里运行，不占用全局线程池（扫描与元数据读取在用）。
+  QThreadPool m_writerPool;
+};
+
+#endif // JOBQUEUE_H
@@ -0,0 +1,78 @@
+#ifndef PDFDOCUMENT_H
+#define PDFDOCUMENT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QRectF>
+#include <QSaveFile>
+#include <QSizeF>
+#include <QString>
+#include <vector>
+
+#include "pdfreader.h"
+
+// 一个已编码、可直接写入 PDF 的图像 XObject。
+struct PdfImage {
+  int width = 0;
+  int height = 0;
+  int components = 3; // 1 = DeviceGray, 3 = DeviceRGB, 4 = DeviceCMYK
+  int bitsPerComponent = 8;
+  QByteArray filter;      // 例如 "DCTDecode"、"FlateDecode"
+  QByteArray decodeParms; // 可选的 /DecodeParms 字典
+  QByteArray decodeArray; // 可选的 /Decode 数组
+  // 非空时为 /Indexed 色彩空间的查找表，每项 components 个字节，
+  // 样本本身是 bitsPerComponent 位的索引。
+  QByteArray palette;
+  QByteArray data;
+
+  bool isNull() const { return data.isEmpty(); }
+};
+
+// 顺序写出 PDF 对象的最小实现：图像与页面在生成时立即落盘，
+// 页面树、目录与交叉引用表在 finish() 时补写。
+// 追加模式下新对象以增量更新的形式写在现有文件末尾，finish() 只改写页面树
+// 根节点并写出新的交叉引用；未完成时文件截回原来的长度。
+class PdfDocument {
+public:
+  explicit PdfDocument(const QString &filePath);
+  ~PdfDocument();
+
+  bool open();
+  // base 由 readPdfAppendBase 读取自同一个文件。
+  bool openForAppend(const PdfAppendBase &base);
+  // 写入图像 XObject，返回对象编号，失败时返回 0。
+  int addImage(const PdfImage &image);
+  // imageRect 以页面左上角为原点，单位为点（1/72 英寸）。
+  bool addPage(const QSizeF &pageSize, const QRectF &imageRect,
+               int imageObject);
+  bool finish();
+
+  // 本次写入的页数，不含追加前已有的页面。
+  int pageCount() const;
+  // 本次写入的字节数。
+  qint64 bytesWritten() const;
+  QString errorString() const;
+
+private:
+  int allocateObject();
+  bool beginObject(int number, int generation = 0);
+  bool write(const QByteArray &data);
+  bool finishAppend();
+  QFileDevice &output();
+
+  QSaveFile m_file;
+  // 追加模式直接写入现有文件。
+  QFile m_appendFile;
+  bool m_appending;
+  bool m_finished;
+  PdfAppendBase m_base;
+  // 新对象写入的起始位置，追加模式下为原文件的长度。
+  qint64 m_baseOffset;
+  int m_pagesObject;
+  std::vector<qint64> m_offsets;
+  std::vector<int> m_pageObjects;
+  qint64 m_bytesWritten;
+  QString m_errorString;
+};
+
+#endif // PDFDOCUMENT_H
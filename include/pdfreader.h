@@ -0,0 +1,36 @@
+#ifndef PDFREADER_H
+#define PDFREADER_H
+
+#include <QByteArray>
+#include <QString>
+
+// 向现有 PDF 追加页面所需的信息。只从末尾的 startxref 出发解析交叉引用
+// （传统 xref 表与 PDF 1.5 的交叉引用流均可，沿 /Prev 链向前），再读取
+// 目录与页面树根节点；不遍历页面，也不读取图像数据。
+struct PdfAppendBase {
+  qint64 fileSize = 0;
+  qint64 startXref = 0;
+  // 最新一节是交叉引用流时，增量更新也写交叉引用流。
+  bool usesXrefStream = false;
+  // 原 trailer 的 /Size，新对象从这里开始编号。
+  int size = 0;
+  // 原 trailer 中的 /Root、/Info 与 /ID，原样写入新的 trailer。
+  QByteArray rootReference;
+  QByteArray infoReference;
+  QByteArray idArray;
+  int pagesObject = 0;
+  int pagesGeneration = 0;
+  // 页面树根节点的字典 "<< ... >>"，追加时改写其中的 /Kids 与 /Count。
+  QByteArray pagesDictionary;
+  int pageCount = 0;
+};
+
+// 加密或页面树根节点的 /Kids 不是直接数组时返回 false 并说明原因。
+bool readPdfAppendBase(const QString &filePath, PdfAppendBase *base,
+                       QString *error);
+
+// 在页面树根节点的字典中追加子节点，kids 形如 "12 0 R 15 0 R"。
+bool extendPagesDictionary(const QByteArray &dictionary, const QByteArray &kids,
+                           int addedPages, QByteArray *result);
+
+#endif // PDFREADER_H
@@ -0,0 +1,43 @@
+#ifndef PIXELOPS_H
+#define PIXELOPS_H
+
+#include <QImage>
+
+enum class BilevelMode {
+  Off = 0,
+  Global,  // Otsu 全局阈值
+  Adaptive // Sauvola 局部自适应阈值
+};
+
+// 自动编码时的页面分类。
+enum class PageClass {
+  Bilevel = 0, // 几乎只有黑白两色，如文字扫描件
+  Grayscale,   // 无彩色
+  Palette,     // 彩色但不超过 256 种颜色，如图表与截图
+  Color        // 彩色照片等
+};
+
+struct ImageAnalysis {
+  PageClass pageClass = PageClass::Color;
+  // 灰度图在采样中出现的灰阶数，用于选择索引色的位深。
+  int grayLevels = 256;
+};
+
+const char *pageClassName(PageClass pageClass);
+
+// 在最多约一百万个采样像素（整行抽样）上统计色度与亮度直方图并分类，
+// x86 上色度与亮度使用 SSE2 内核，耗时远小于解码。输入应为 RGB32 或
+// Grayscale8，其它格式先与白色背景合成。调色板只是按采样判断，
+// 编码时仍需在整幅图像上确认颜色数。
+ImageAnalysis analyzeImage(const QImage &image);
+
+// 透明像素与白色背景合成，返回 RGB32。
+QImage flattenOnWhite(const QImage &image);
+
+// RGB 转 8 位灰度，x86 上使用 SSE2 内核。透明区域按白色背景处理。
+QImage grayscaleImage(const QImage &image);
+
+// 灰度图二值化，返回颜色表为 {黑, 白} 的 Format_Mono 图像。
+QImage bilevelImage(const QImage &grayscale, BilevelMode mode);
+
+#endif // PIXELOPS_H
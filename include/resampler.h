@@ -0,0 +1,18 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QImage>
+#include <QSize>
+
+class QThreadPool;
+
+enum class ResampleFilter { Box, Lanczos3 };
+
+// 可分离的高质量重采样。支持 Grayscale8、RGB32 与 ARGB32_Premultiplied，
+// 其它格式会先转换；大图按输出行分块在 pool（为空时用全局线程池）上并行
+// 处理，x86 上使用 SSE2/AVX2。
+QImage resampleImage(const QImage &source, const QSize &targetSize,
+                     ResampleFilter filter = ResampleFilter::Lanczos3,
+                     QThreadPool *pool = nullptr);
+
+#endif // RESAMPLER_H
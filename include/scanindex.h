@@ -0,0 +1,66 @@
+#ifndef SCANINDEX_H
+#define SCANINDEX_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+class FileMetadataCache;
+
+struct IndexedFile {
+  QByteArray name;
+  qint64 size = -1;
+  qint64 modifiedMsecs = 0;
+};
+
+struct IndexedDirectory {
+  // 目录自身的修改时间（纳秒），-1 表示下次必须重新读取。
+  qint64 modifiedNsecs = -1;
+  QList<QByteArray> subdirectories;
+  QList<IndexedFile> files;
+};
+
+QDataStream &operator<<(QDataStream &stream, const IndexedFile &file);
+QDataStream &operator>>(QDataStream &stream, IndexedFile &file);
+QDataStream &operator<<(QDataStream &stream, const IndexedDirectory &entry);
+QDataStream &operator>>(QDataStream &stream, IndexedDirectory &entry);
+
+// 按扫描根目录保存在缓存目录下的二进制索引。目录的修改时间没变，
+// 说明其中没有增删条目，再次扫描时直接复用上次的图片列表与子目录列表，
+// 不必重新 readdir；子目录仍会逐个检查。
+// 原地覆盖写入的文件不会改变目录时间，其记录的大小与时间可能滞后；
+// 复用的记录因此不覆盖元数据缓存中已有的条目，列表中的行读取附加信息时
+// 也会重新 stat。
+class ScanIndex {
+public:
+  ScanIndex(const QString &rootPath, bool includeSubdirectories);
+
+  // 读入上次保存的索引；文件不存在或格式不符时按空索引处理。
+  void load();
+  bool save() const;
+  QString filePath() const;
+
+  // 以下两个函数由扫描线程并发调用。路径均为编码后的绝对路径。
+  bool lookup(const QByteArray &directory, qint64 modifiedNsecs,
+              IndexedDirectory *entry) const;
+  // reused 表示 entry 来自上次的索引而非刚读到的目录内容。
+  void record(const QByteArray &directory, IndexedDirectory entry,
+              bool reused = false);
+
+  // 记入索引的图片同时写入 metadata，供排序等使用。须在扫描开始前设置。
+  void setMetadataCache(FileMetadataCache *metadata);
+
+private:
+  QString m_rootPath;
+  bool m_includeSubdirectories;
+  qint64 m_scanStartNsecs;
+  FileMetadataCache *m_metadata = nullptr;
+  QHash<QByteArray, IndexedDirectory> m_previous;
+  mutable QMutex m_mutex;
+  QHash<QByteArray, IndexedDirectory> m_current;
+};
+
+#endif // SCANINDEX_H
@@ -0,0 +1,37 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// x86 SIMD 能力检测，供各像素处理内核共用。SSE2 在 x86-64 上始终可用；
+// AVX2 版本通过 target 属性单独编译，运行时再按 CPU 选择。
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGES2PDF_HAVE_SSE2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define IMAGES2PDF_TARGET_AVX2
+#else
+#define IMAGES2PDF_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+inline bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0;
+  return osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#endif // SIMD_H
@@ -0,0 +1,56 @@
+#ifndef STRIPREADER_H
+#define STRIPREADER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QImageIOHandler>
+#include <QSize>
+
+// 超大图像（大幅面扫描的地图、图纸）的分段读取：整幅解码需要数 GB 内存，
+// 这里按条带、瓦片或行带逐段解码，每读到一行就以面积平均累加进缩小后的
+// 输出，峰值内存只有几个条带加上输出图像，与原图大小无关。
+// 有 libtiff 的构建直接按条带与瓦片读取 TIFF；其它格式要求图像插件支持
+// ClipRect，每个行带单独裁剪解码一次。
+class StripImageReader {
+public:
+  // data 须在读取期间保持有效，通常是映射的文件内容。frame 为多页文件
+  // （多页 TIFF）中的页序号，从 0 开始。
+  explicit StripImageReader(const QByteArray &data, int frame = 0);
+
+  // 识别格式并读取尺寸与方向；不能分段读取的格式返回 false。
+  bool open();
+  // 文件中存储的尺寸，尚未应用方向变换。
+  QSize size() const { return m_size; }
+  QImageIOHandler::Transformations transformation() const {
+    return m_transformation;
+  }
+
+  // 缩小到 targetSize（存储方向下，每一维都不大于 size()），再应用方向
+  // 变换，返回 Grayscale8 或 RGB32 图像；解码失败时返回空图像。
+  QImage read(const QSize &targetSize);
+
+private:
+  enum class Kind { None, Tiff, ClipRect };
+
+  bool openTiff();
+  bool openClipRect();
+  QImage readTiff(const QSize &targetSize);
+  QImage readClipRect(const QSize &targetSize);
+
+  QByteArray m_data;
+  const int m_frame;
+  Kind m_kind;
+  QByteArray m_format;
+  QSize m_size;
+  QImageIOHandler::Transformations m_transformation;
+  bool m_grayscale;
+};
+
+// EXIF 与 TIFF 方向标签（1–8，两者取值相同）对应的变换，与 Qt 的解释一致。
+QImageIOHandler::Transformations orientationTransformation(int orientation);
+
+// 与 QImageReader 的自动变换相同：先水平、垂直翻转，再顺时针旋转 90°。
+QImage applyTransformation(const QImage &image,
+                           QImageIOHandler::Transformations transformation);
+
+#endif // STRIPREADER_H
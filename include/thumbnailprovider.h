@@ -0,0 +1,41 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QString>
+#include <QThreadPool>
+
+class FileMetadataCache;
+
+// 列表缩略图：image://thumbnail/<百分号编码的路径>。
+// 读取顺序为内存 LRU → 磁盘缓存（freedesktop 缩略图规范，按 URI 与修改时间
+// 校验）→ JPEG 内嵌的 EXIF 缩略图 → QImageReader 缩小解码。
+// 解码在独立线程池中进行，滚出视口的请求会被取消。
+class ThumbnailProvider : public QQuickAsyncImageProvider {
+public:
+  explicit ThumbnailProvider(FileMetadataCache *metadata,
+                             qint64 memoryBudgetBytes = 64 * 1024 * 1024);
+  ~ThumbnailProvider() override;
+
+  QQuickImageResponse *requestImageResponse(const QString &id,
+                                            const QSize &requestedSize) override;
+
+  // 以下由工作线程调用。
+  QImage thumbnail(const QString &path, int edge);
+
+private:
+  QImage cachedThumbnail(const QString &key);
+  void storeThumbnail(const QString &key, const QImage &image);
+
+  FileMetadataCache *m_metadata;
+  QMutex m_cacheMutex;
+  // 成本按图像字节数计算，超出预算时淘汰最久未用的缩略图。
+  QCache<QString, QImage> m_memoryCache;
+  // 最后声明，析构时先等待所有工作线程结束。
+  QThreadPool m_pool;
+};
+
+#endif // THUMBNAILPROVIDER_H
@@ -21,7 +21,14 @@ ApplicationWindow {
     property string outputFile: ""
     property bool stretchToPage: false
     property bool forceGrayscale: false
+    property bool jpegPassthrough: true
+    property int effectiveDpi: 0
+    property int bilevelMode: 0
+    property int splitMode: 0
+    property bool appendToExisting: false
+    property bool automaticEncoding: false
     property bool includeSubdirectories: true
+    property bool forceRescan: false
     property string selectedPageSize: "A4"
     property bool landscapeOrientation: false
 
@@ -58,6 +65,7 @@ ApplicationWindow {
                     Button { text: qsTr("添加图片…"); onClicked: imageFileDialog.open() }
                     Button { text: qsTr("导入文件夹…"); onClicked: folderDialog.open() }
                     CheckBox { checked: includeSubdirectories; text: qsTr("包含子文件夹"); onToggled: includeSubdirectories = checked }
+                    CheckBox { checked: forceRescan; text: qsTr("完整重新扫描"); onToggled: forceRescan = checked }
                     Button { text: qsTr("清空列表"); enabled: backend.imageCount > 0; onClicked: backend.clearImages() }
                     Label { Layout.fillWidth: true; horizontalAlignment: Qt.AlignRight; color: Material.color(Material.Grey); text: qsTr("共 %1 张").arg(backend.imageCount) }
                 }
@@ -147,11 +155,43 @@ ApplicationWindow {
                             anchors.margins: 8
                             spacing: 8
 
-                            Label {
+                            Image {
+                                Layout.preferredWidth: 32
+                                Layout.preferredHeight: 32
+                                source: "image://thumbnail/" + encodeURIComponent(path)
+                                sourceSize: Qt.size(32, 32)
+                                asynchronous: true
+                                cache: false
+                                fillMode: Image.PreserveAspectFit
+                            }
+
+                            ColumnLayout {
                                 Layout.fillWidth: true
-                                text: path
-                                elide: Text.ElideMiddle
-                                verticalAlignment: Text.AlignVCenter
+                                spacing: 0
+
+                                Label {
+                                    Layout.fillWidth: true
+                                    text: path
+                                    elide: Text.ElideMiddle
+                                    verticalAlignment: Text.AlignVCenter
+                                }
+                                // 附加信息在后台读取，到达前留空。
+                                Label {
+                                    Layout.fillWidth: true
+                                    visible: detailsLoaded
+                                    font.pixelSize: 11
+                                    elide: Text.ElideRight
+                                    color: decodeError ? Material.color(Material.Red) : Material.color(Material.Grey)
+                                    text: !detailsLoaded ? ""
+                                          : decodeError ? qsTr("无法读取图片")
+                                          : qsTr("%1 · %2×%3 · %4 · 预计 %5")
+                                                .arg(imageFormat)
+                                                .arg(pixelSize.width)
+                                                .arg(pixelSize.height)
+                                                .arg(Qt.locale().formattedDataSize(fileSize))
+                                                .arg(Qt.locale().formattedDataSize(estimatedBytes))
+                                            + (frameCount > 1 ? qsTr(" · %1 页").arg(frameCount) : "")
+                                }
                             }
 
                             ToolButton {
@@ -247,6 +287,17 @@ ApplicationWindow {
                         onCurrentValueChanged: landscapeOrientation = !!currentValue; Component.onCompleted: landscapeOrientation = !!currentValue
                     }
                 }
+                RowLayout {
+                    Layout.fillWidth: true; spacing: 12
+                    Label { text: qsTr("图像分辨率"); font.bold: true }
+                    ComboBox {
+                        id: dpiCombo; Layout.preferredWidth: 180; textRole: "text"; valueRole: "value"
+                        model: [ { text: qsTr("保持原图"), value: 0 }, { text: qsTr("150 dpi"), value: 150 },
+                                 { text: qsTr("200 dpi"), value: 200 }, { text: qsTr("300 dpi"), value: 300 },
+                                 { text: qsTr("600 dpi"), value: 600 } ]
+                        onCurrentValueChanged: effectiveDpi = currentValue || 0; Component.onCompleted: effectiveDpi = currentValue || 0
+                    }
+                }
                 RowLayout {
                     Layout.fillWidth: true
                     Label { Layout.fillWidth: true; text: qsTr("拉伸填满页面（不保留比例）") }
@@ -257,21 +308,74 @@ ApplicationWindow {
                     Label { Layout.fillWidth: true; text: qsTr("强制转换为灰度") }
                     Switch { checked: forceGrayscale; onToggled: forceGrayscale = checked }
                 }
+                RowLayout {
+                    Layout.fillWidth: true; spacing: 12
+                    Label { Layout.fillWidth: true; text: qsTr("黑白二值化（适合文字扫描件）") }
+                    ComboBox {
+                        id: bilevelCombo; Layout.preferredWidth: 180; textRole: "text"; valueRole: "value"
+                        model: [ { text: qsTr("关闭"), value: 0 }, { text: qsTr("全局阈值"), value: 1 }, { text: qsTr("自适应阈值"), value: 2 } ]
+                        onCurrentValueChanged: bilevelMode = currentValue || 0; Component.onCompleted: bilevelMode = currentValue || 0
+                    }
+                }
+                RowLayout {
+                    Layout.fillWidth: true
+                    Label { Layout.fillWidth: true; text: qsTr("按内容自动选择编码（黑白/灰度/调色板/彩色）") }
+                    Switch { checked: automaticEncoding; enabled: bilevelMode === 0; onToggled: automaticEncoding = checked }
+                }
+                RowLayout {
+                    Layout.fillWidth: true; spacing: 12
+                    Label { Layout.fillWidth: true; text: qsTr("分卷输出（各卷同时写入）") }
+                    ComboBox {
+                        id: splitCombo; Layout.preferredWidth: 180; textRole: "text"; valueRole: "value"
+                        model: [ { text: qsTr("不分卷"), value: 0 }, { text: qsTr("按页数"), value: 1 },
+                                 { text: qsTr("按大小 (MB)"), value: 2 }, { text: qsTr("按子文件夹"), value: 3 } ]
+                        onCurrentValueChanged: splitMode = currentValue || 0; Component.onCompleted: splitMode = currentValue || 0
+                    }
+                    SpinBox {
+                        id: splitValueSpin; visible: splitMode === 1 || splitMode === 2; editable: true
+                        from: 1; to: 100000; value: splitMode === 2 ? 200 : 500
+                    }
+                }
+                RowLayout {
+                    Layout.fillWidth: true
+                    Label { Layout.fillWidth: true; text: qsTr("追加到已有 PDF（不分卷）") }
+                    Switch { checked: appendToExisting; onToggled: appendToExisting = checked }
+                }
+                RowLayout {
+                    Layout.fillWidth: true
+                    Label { Layout.fillWidth: true; text: qsTr("JPEG 直接嵌入（不重新压缩）") }
+                    Switch { checked: jpegPassthrough; onToggled: jpegPassthrough = checked }
+                }
                 Item { Layout.fillWidth: true; Layout.preferredHeight: 6 }
             }
         }
 
         ColumnLayout {
             Layout.fillWidth: true; spacing: 8
-            Button {
-                Layout.fillWidth: true; text: backend.conversionRunning ? qsTr("正在转换…") : qsTr("开始转换")
-                enabled: backend.imageCount > 0 && outputFile.length > 0 && !backend.conversionRunning
-                onClicked: backend.convertToPdf(outputFile,
-                                                Math.round(marginSlider.value),
-                                                stretchToPage,
-                                                selectedPageSize,
-                                                landscapeOrientation,
-                                                forceGrayscale)
+            RowLayout {
+                Layout.fillWidth: true; spacing: 8
+                // 转换进行中再次点击会把当前列表与设置作为新任务加入队列。
+                Button {
+                    Layout.fillWidth: true; text: backend.conversionRunning ? qsTr("加入转换队列") : qsTr("开始转换")
+                    enabled: backend.imageCount > 0 && outputFile.length > 0
+                    onClicked: backend.convertToPdf(outputFile,
+                                                    Math.round(marginSlider.value),
+                                                    stretchToPage,
+                                                    selectedPageSize,
+                                                    landscapeOrientation,
+                                                    forceGrayscale,
+                                                    jpegPassthrough,
+                                                    effectiveDpi,
+                                                    bilevelMode,
+                                                    splitMode,
+                                                    splitValueSpin.value,
+                                                    appendToExisting,
+                                                    automaticEncoding)
+                }
+                Button {
+                    text: qsTr("全部取消"); visible: backend.conversionRunning
+                    onClicked: backend.cancelConversion()
+                }
             }
             ProgressBar {
                 Layout.fillWidth: true
@@ -281,9 +385,69 @@ ApplicationWindow {
                 value: backend.conversionProgress
             }
             Label { Layout.fillWidth: true; wrapMode: Text.WordWrap; text: backend.statusText }
+            GroupBox {
+                title: qsTr("转换队列")
+                Layout.fillWidth: true
+                visible: jobList.count > 0
+
+                ColumnLayout {
+                    anchors.fill: parent; spacing: 4
+                    ListView {
+                        id: jobList
+                        Layout.fillWidth: true
+                        Layout.preferredHeight: Math.min(contentHeight, 160)
+                        clip: true
+                        model: backend.jobQueue
+                        delegate: RowLayout {
+                            width: ListView.view.width; spacing: 8
+                            ColumnLayout {
+                                Layout.fillWidth: true; spacing: 2
+                                Label {
+                                    Layout.fillWidth: true; elide: Text.ElideMiddle
+                                    text: qsTr("%1（%2 页）").arg(title).arg(pageCount)
+                                }
+                                ProgressBar {
+                                    Layout.fillWidth: true; from: 0; to: 1; value: progress
+                                    visible: jobState === 1
+                                }
+                                Label {
+                                    Layout.fillWidth: true; elide: Text.ElideRight
+                                    font.pixelSize: 11; color: Material.color(Material.Grey)
+                                    text: status
+                                }
+                            }
+                            ToolButton {
+                                text: "✕"; visible: jobState === 0 || jobState === 1
+                                onClicked: backend.jobQueue.cancelJob(jobId)
+                            }
+                        }
+                    }
+                    Button {
+                        Layout.alignment: Qt.AlignRight; flat: true
+                        text: qsTr("清除已完成")
+                        onClicked: backend.jobQueue.removeFinishedJobs()
+                    }
+                }
+            }
+            // 上次转换的吞吐与最耗时的阶段，便于判断瓶颈在解码、压缩还是写盘。
+            Label {
+                readonly property var stats: backend.performanceSummary.conversion
+                Layout.fillWidth: true
+                visible: !backend.conversionRunning && stats !== undefined && stats.pages > 0
+                wrapMode: Text.WordWrap
+                font.pixelSize: 11
+                color: Material.color(Material.Grey)
+                text: visible ? qsTr("%1 页/秒 · 读入 %2 MB/s · 写出 %3 MB/s · 峰值内存 %4 · 主要耗时：%5")
+                                .arg(stats.pagesPerSecond.toFixed(1))
+                                .arg(stats.inputMBps.toFixed(1))
+                                .arg(stats.outputMBps.toFixed(1))
+                                .arg(Qt.locale().formattedDataSize(stats.peakRssBytes))
+                                .arg(stats.bottleneck.length > 0 ? stats.bottleneck : "-")
+                              : ""
+            }
         }
     }
     FileDialog { id: imageFileDialog; title: qsTr("选择图片文件"); nameFilters: [qsTr("图像文件 (*.png *.jpg *.jpeg *.bmp *.gif *.webp *.tif *.tiff)")]; fileMode: FileDialog.OpenFiles; onAccepted: { const files = []; for (let i = 0; i < selectedFiles.length; ++i) { const localPath = localPathFromUrl(selectedFiles[i]); if (localPath.length > 0) files.push(localPath); } if (files.length > 0) backend.addImages(files); } }
-    FolderDialog { id: folderDialog; title: qsTr("选择图片文件夹"); onAccepted: { const folderPath = localPathFromUrl(selectedFolder); if (folderPath.length > 0) backend.addDirectory(folderPath, includeSubdirectories); } }
-    FileDialog { id: saveDialog; title: qsTr("保存 PDF"); nameFilters: [qsTr("PDF 文件 (*.pdf)")]; fileMode: FileDialog.SaveFile; defaultSuffix: "pdf"; onAccepted: { if (selectedFile) { var filePath = localPathFromUrl(selectedFile); if (!filePath.toLowerCase().endsWith(".pdf")) filePath = filePath + ".pdf"; outputFile = filePath; } } }
+    FolderDialog { id: folderDialog; title: qsTr("选择图片文件夹"); onAccepted: { const folderPath = localPathFromUrl(selectedFolder); if (folderPath.length > 0) backend.addDirectory(folderPath, includeSubdirectories, forceRescan); } }
+    FileDialog { id: saveDialog; title: qsTr("保存 PDF"); nameFilters: [qsTr("PDF 文件 (*.pdf)")]; fileMode: FileDialog.SaveFile; options: appendToExisting ? FileDialog.DontConfirmOverwrite : 0; defaultSuffix: "pdf"; onAccepted: { if (selectedFile) { var filePath = localPathFromUrl(selectedFile); if (!filePath.toLowerCase().endsWith(".pdf")) filePath = filePath + ".pdf"; outputFile = filePath; } } }
 }
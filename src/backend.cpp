@@ -1,27 +1,127 @@
 #include "backend.h"
+#include "directoryscanner.h"
+#include "filemetadata.h"
+#include "imagelist.h"
+#include "scanindex.h"
 
-#include <QCollator>
-#include <QCoreApplication>
-#include <QDateTime>
 #include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
-#include <QImage>
-#include <QMarginsF>
-#include <QPageLayout>
-#include <QPageSize>
-#include <QPainter>
-#include <QPdfWriter>
-#include <QScopeGuard>
+#include <QImageReader>
+#include <QLocale>
+#include <QPromise>
 #include <QSet>
+#include <QThread>
 #include <QtConcurrent>
 #include <QUrl>
 #include <algorithm>
 #include <cmath>
-#include <limits>
-#include <vector>
 
-ImageModel::ImageModel(QObject *parent) : QAbstractListModel(parent) {}
+namespace {
+// 每个后台任务处理的行数，以及排队请求的上限：快速滚动时只保留最近的
+// 请求，滚走的行再次显示时会重新请求。
+constexpr int kDetailBatchSize = 16;
+constexpr size_t kMaxQueuedDetailRequests = 512;
+constexpr int kDetailsChangedIntervalMs = 50;
+
+ImageDetails readImageDetails(const QString &path,
+                              FileMetadataCache *metadata) {
+  ImageDetails details;
+  // 目录监视看不到原地覆盖写入，显示附加信息时重新 stat 一次，缓存中的
+  // 大小与时间（排序、预检与缩略图缓存键都用它们）随之更新。
+  details.fileSize = metadata->refresh(path).size;
+  if (details.fileSize < 0) {
+    details.decodeError = true;
+    return details;
+  }
+
+  // 只解析文件头，不解码像素；头部损坏或格式不受支持都视为无法读取。
+  QImageReader reader(path);
+  details.format = QString::fromLatin1(reader.format()).toUpper();
+  details.pixelSize = metadata->pixelSize(path);
+  details.decodeError = !reader.canRead() || !details.pixelSize.isValid();
+  if (details.decodeError)
+    return details;
+  details.frameCount = std::max(1, reader.imageCount());
+
+  // JPEG 默认原样嵌入，页面大小约等于文件大小；灰度图按无损压缩约 2:1，
+  // 其它图片重新编码为 JPEG，按每像素约 2 位估计。
+  const qint64 pixels =
+      qint64(details.pixelSize.width()) * details.pixelSize.height();
+  const QImage::Format format = reader.imageFormat();
+  if (reader.format() == "jpeg")
+    details.estimatedBytes = details.fileSize;
+  else if (format == QImage::Format_Grayscale8 ||
+           format == QImage::Format_Grayscale16 ||
+           format == QImage::Format_Mono || format == QImage::Format_MonoLSB)
+    details.estimatedBytes = pixels / 2;
+  else
+    details.estimatedBytes = pixels / 4;
+  details.estimatedBytes *= details.frameCount;
+  return details;
+}
+} // namespace
+
+ImageModel::ImageModel(QObject *parent)
+    : QAbstractListModel(parent), m_metadata(nullptr),
+      m_detailBatchesInFlight(0), m_stopDetailLoading(false) {
+  // 读取附加信息以文件 I/O 为主，少量线程即可，避免与扫描和转换争抢。
+  m_detailPool.setMaxThreadCount(
+      std::clamp(QThread::idealThreadCount() / 2, 1, 4));
+  m_detailDispatchTimer.setSingleShot(true);
+  m_detailDispatchTimer.setInterval(0);
+  connect(&m_detailDispatchTimer, &QTimer::timeout, this,
+          &ImageModel::dispatchDetailRequests);
+  m_detailsChangedTimer.setSingleShot(true);
+  m_detailsChangedTimer.setInterval(kDetailsChangedIntervalMs);
+  connect(&m_detailsChangedTimer, &QTimer::timeout, this,
+          &ImageModel::emitDetailsChanged);
+}
+
+ImageModel::~ImageModel() { stopDetailLoading(); }
+
+void ImageModel::setMetadataCache(FileMetadataCache *metadata) {
+  m_metadata = metadata;
+}
+
+void ImageModel::stopDetailLoading() {
+  m_stopDetailLoading.store(true, std::memory_order_relaxed);
+  m_detailDispatchTimer.stop();
+  m_detailQueue.clear();
+  m_detailPool.waitForDone();
+}
+
+void ImageModel::invalidateDirectory(const QString &directoryPath) {
+  QString prefix = directoryPath;
+  if (!prefix.endsWith(QLatin1Char('/')))
+    prefix.append(QLatin1Char('/'));
+
+  int first = -1;
+  int last = -1;
+  for (auto it = m_details.begin(); it != m_details.end();) {
+    if (it.key().startsWith(prefix) &&
+        it.key().indexOf(QLatin1Char('/'), prefix.size()) < 0) {
+      m_detailRequested.remove(it.key());
+      it = m_details.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (int row = 0; row < m_data.size(); ++row) {
+    const QString &path = m_data.at(row);
+    if (path.startsWith(prefix) &&
+        path.indexOf(QLatin1Char('/'), prefix.size()) < 0) {
+      if (first < 0)
+        first = row;
+      last = row;
+    }
+  }
+  // 通知视图重新取数据，可见行会借此再次请求读取。
+  if (first >= 0)
+    emit dataChanged(index(first), index(last),
+                     {DetailsLoadedRole, FileSizeRole, PixelSizeRole,
+                      FormatRole, EstimatedBytesRole, DecodeErrorRole,
+                      FrameCountRole});
+}
 
 int ImageModel::rowCount(const QModelIndex &parent) const {
   if (parent.isValid())
@@ -36,28 +136,215 @@ QVariant ImageModel::data(const QModelIndex &index, int role) const {
   if (role == PathRole || role == Qt::DisplayRole) {
     return m_data.at(index.row());
   }
+  if (role < DetailsLoadedRole || role > FrameCountRole)
+    return QVariant();
+
+  const QString &path = m_data.at(index.row());
+  const auto it = m_details.constFind(path);
+  if (it == m_details.constEnd()) {
+    requestDetails(path, index.row());
+    return role == DetailsLoadedRole ? QVariant(false) : QVariant();
+  }
+  switch (role) {
+  case DetailsLoadedRole:
+    return true;
+  case FileSizeRole:
+    return it->fileSize;
+  case PixelSizeRole:
+    return it->pixelSize;
+  case FormatRole:
+    return it->format;
+  case EstimatedBytesRole:
+    return it->estimatedBytes;
+  case DecodeErrorRole:
+    return it->decodeError;
+  case FrameCountRole:
+    return it->frameCount;
+  }
   return QVariant();
 }
 
 QHash<int, QByteArray> ImageModel::roleNames() const {
   QHash<int, QByteArray> roles;
   roles[PathRole] = "modelData";
+  roles[DetailsLoadedRole] = "detailsLoaded";
+  roles[FileSizeRole] = "fileSize";
+  roles[PixelSizeRole] = "pixelSize";
+  roles[FormatRole] = "imageFormat";
+  roles[EstimatedBytesRole] = "estimatedBytes";
+  roles[DecodeErrorRole] = "decodeError";
+  roles[FrameCountRole] = "frameCount";
   return roles;
 }
 
+void ImageModel::requestDetails(const QString &path, int row) const {
+  if (!m_metadata || m_stopDetailLoading.load(std::memory_order_relaxed) ||
+      m_detailRequested.contains(path))
+    return;
+  m_detailRequested.insert(path);
+  m_detailQueue.push_back({path, row});
+  if (m_detailQueue.size() > kMaxQueuedDetailRequests) {
+    // 最早的请求多半已经滚出视口，丢弃后允许再次请求。
+    const size_t dropped = m_detailQueue.size() - kMaxQueuedDetailRequests;
+    for (size_t i = 0; i < dropped; ++i)
+      m_detailRequested.remove(m_detailQueue[i].path);
+    m_detailQueue.erase(m_detailQueue.begin(),
+                        m_detailQueue.begin() +
+                            static_cast<std::ptrdiff_t>(dropped));
+  }
+  if (!m_detailDispatchTimer.isActive())
+    m_detailDispatchTimer.start();
+}
+
+void ImageModel::dispatchDetailRequests() {
+  // 同时在途的批次不超过线程数，其余请求留在队列中，
+  // 这样视口移动后新的请求总能先于旧的被处理。
+  while (!m_detailQueue.empty() &&
+         m_detailBatchesInFlight < m_detailPool.maxThreadCount()) {
+    const size_t count =
+        std::min<size_t>(kDetailBatchSize, m_detailQueue.size());
+    // 后进先出：最近请求的行最可能仍在视口内。
+    std::vector<DetailRequest> batch(m_detailQueue.end() - count,
+                                     m_detailQueue.end());
+    m_detailQueue.resize(m_detailQueue.size() - count);
+    ++m_detailBatchesInFlight;
+
+    FileMetadataCache *metadata = m_metadata;
+    m_detailPool.start([this, metadata, batch = std::move(batch)]() {
+      std::vector<DetailResult> results;
+      results.reserve(batch.size());
+      for (const DetailRequest &request : batch) {
+        if (m_stopDetailLoading.load(std::memory_order_relaxed))
+          break;
+        results.push_back({request.path, request.rowHint,
+                           readImageDetails(request.path, metadata)});
+      }
+      QMetaObject::invokeMethod(
+          this,
+          [this, results = std::move(results)]() { applyDetails(results); },
+          Qt::QueuedConnection);
+    });
+  }
+}
+
+void ImageModel::applyDetails(const std::vector<DetailResult> &results) {
+  --m_detailBatchesInFlight;
+  for (const DetailResult &result : results) {
+    // 读取期间行已被移除（或列表已清空）时结果作废。
+    if (!m_detailRequested.remove(result.path) || !m_index.contains(result.path))
+      continue;
+    m_details.insert(result.path, result.details);
+    m_changedDetails.push_back({result.path, result.rowHint});
+  }
+  if (!m_changedDetails.empty() && !m_detailsChangedTimer.isActive())
+    m_detailsChangedTimer.start();
+  if (!m_detailQueue.empty())
+    dispatchDetailRequests();
+}
+
+void ImageModel::emitDetailsChanged() {
+  // 行号在发出通知时才确定，期间插入或移动的行不会对错位置。
+  std::vector<int> rows;
+  rows.reserve(m_changedDetails.size());
+  for (const DetailRequest &changed : m_changedDetails) {
+    int row = changed.rowHint;
+    if (row < 0 || row >= m_data.size() || m_data.at(row) != changed.path)
+      row = static_cast<int>(m_data.indexOf(changed.path));
+    if (row >= 0)
+      rows.push_back(row);
+  }
+  m_changedDetails.clear();
+  if (rows.empty())
+    return;
+  std::sort(rows.begin(), rows.end());
+  const QList<int> roles = {DetailsLoadedRole,  FileSizeRole,
+                            PixelSizeRole,      FormatRole,
+                            EstimatedBytesRole, DecodeErrorRole,
+                            FrameCountRole};
+  // 相邻的行合并为一个区间，一批结果通常只产生一两次通知。
+  size_t begin = 0;
+  while (begin < rows.size()) {
+    size_t end = begin + 1;
+    while (end < rows.size() && rows[end] <= rows[end - 1] + 1)
+      ++end;
+    emit dataChanged(index(rows[begin]), index(rows[end - 1]), roles);
+    begin = end;
+  }
+}
+
 void ImageModel::addPaths(const QStringList &paths) {
   if (paths.isEmpty())
     return;
   beginInsertRows(QModelIndex(), m_data.size(),
                   m_data.size() + paths.size() - 1);
   m_data.append(paths);
+  for (const QString &path : paths)
+    m_index.insert(path);
   endInsertRows();
 }
 
+void ImageModel::insertSorted(const QStringList &paths,
+                              const ImageLessThan &lessThan) {
+  if (paths.isEmpty())
+    return;
+
+  // 新条目有序，插入位置单调不减，二分查找的下界可以逐个推进。
+  // upper_bound 让新条目排在相等的旧条目之后，与稳定排序的结果一致。
+  std::vector<int> positions;
+  positions.reserve(paths.size());
+  auto low = m_data.cbegin();
+  int runs = 0;
+  for (const QString &path : paths) {
+    low = std::upper_bound(low, m_data.cend(), path, lessThan);
+    const int position = static_cast<int>(low - m_data.cbegin());
+    if (positions.empty() || positions.back() != position)
+      ++runs;
+    positions.push_back(position);
+  }
+  for (const QString &path : paths)
+    m_index.insert(path);
+
+  // 插入段过多时逐段通知的开销超过一次重置，直接合并后重置模型。
+  constexpr int kMaxInsertRuns = 256;
+  if (runs > kMaxInsertRuns) {
+    QStringList merged;
+    merged.reserve(m_data.size() + paths.size());
+    int next = 0;
+    for (int i = 0; i < paths.size(); ++i) {
+      while (next < positions[i])
+        merged.append(m_data.at(next++));
+      merged.append(paths.at(i));
+    }
+    while (next < m_data.size())
+      merged.append(m_data.at(next++));
+    beginResetModel();
+    m_data = std::move(merged);
+    endResetModel();
+    return;
+  }
+
+  // 从后往前插入，前面各段的位置不受影响。
+  for (int end = static_cast<int>(paths.size()); end > 0;) {
+    int begin = end - 1;
+    while (begin > 0 && positions[begin - 1] == positions[end - 1])
+      --begin;
+    const int row = positions[begin];
+    const int count = end - begin;
+    beginInsertRows(QModelIndex(), row, row + count - 1);
+    m_data.insert(row, count, QString());
+    for (int i = 0; i < count; ++i)
+      m_data[row + i] = paths.at(begin + i);
+    endInsertRows();
+    end = begin;
+  }
+}
+
 void ImageModel::removeAt(int index) {
   if (index < 0 || index >= m_data.size())
     return;
   beginRemoveRows(QModelIndex(), index, index);
+  m_index.remove(m_data.at(index));
+  m_details.remove(m_data.at(index));
   m_data.removeAt(index);
   endRemoveRows();
 }
@@ -80,6 +367,11 @@ void ImageModel::clear() {
     return;
   beginResetModel();
   m_data.clear();
+  m_index.clear();
+  m_details.clear();
+  m_detailQueue.clear();
+  m_detailRequested.clear();
+  m_changedDetails.clear();
   endResetModel();
 }
 
@@ -88,6 +380,7 @@ void ImageModel::replaceAll(const QStringList &paths) {
     return;
   beginResetModel();
   m_data = paths;
+  m_index = QSet<QString>(paths.cbegin(), paths.cend());
   endResetModel();
 }
 
@@ -95,37 +388,49 @@ const QStringList &ImageModel::getList() const { return m_data; }
 
 int ImageModel::count() const { return m_data.size(); }
 
-namespace {
-const QSet<QString> &supportedImageExtensions() {
-  static const QSet<QString> extensions = {
-      QStringLiteral("png"),  QStringLiteral("jpg"),  QStringLiteral("jpeg"),
-      QStringLiteral("bmp"),  QStringLiteral("gif"),  QStringLiteral("webp"),
-      QStringLiteral("tif"),  QStringLiteral("tiff"), QStringLiteral("jfif"),
-      QStringLiteral("heic"), QStringLiteral("heif"), QStringLiteral("avif")};
-  return extensions;
+bool ImageModel::contains(const QString &path) const {
+  return m_index.contains(path);
 }
 
-bool hasSupportedExtension(const QString &filePath) {
-  const QString extension = QFileInfo(filePath).suffix().toLower();
-  return supportedImageExtensions().contains(extension);
-}
-} // namespace
-
 Backend::Backend(QObject *parent)
     : QObject(parent), m_windowTitle(QStringLiteral("批量图片转 PDF")),
       m_statusText(QStringLiteral("请选择需要转换的图片。")),
       m_conversionRunning(false), m_conversionProgress(0.0),
-      m_sortMode(SortNameAscending), m_cancelScan(false) {
+      m_sortMode(SortNameAscending), m_orderDisturbed(false),
+      m_scanFoundCount(0), m_cancelScan(false) {
   m_model = new ImageModel(this);
+  m_model->setMetadataCache(&m_metadata);
+  m_jobs = new ConversionJobQueue(this);
+  connect(m_jobs, &ConversionJobQueue::activeCountChanged, this,
+          [this]() { setConversionRunning(m_jobs->activeCount() > 0); });
+  connect(m_jobs, &ConversionJobQueue::progressChanged, this,
+          [this]() { setConversionProgress(m_jobs->progress()); });
+  connect(m_jobs, &ConversionJobQueue::jobFinished, this,
+          &Backend::handleJobFinished);
   m_batchInsertTimer.setInterval(0);
   m_batchInsertTimer.setSingleShot(false);
   connect(&m_batchInsertTimer, &QTimer::timeout, this,
           &Backend::processBatchInsert);
+  connect(&m_scanWatcher, &QFutureWatcher<QStringList>::resultsReadyAt, this,
+          &Backend::handleScanResultsReady);
   connect(&m_scanWatcher, &QFutureWatcher<QStringList>::finished, this,
           &Backend::handleDirectoryScanFinished);
+  connect(&m_directoryWatcher, &QFileSystemWatcher::directoryChanged, this,
+          &Backend::handleWatchedDirectoryChanged);
+}
+
+Backend::~Backend() {
+  m_cancelScan.store(true, std::memory_order_relaxed);
+  // 队列作为子对象稍后析构，届时取消并等待转换；之后不再通知 Backend。
+  m_jobs->disconnect(this);
+  m_jobs->cancelAll();
+  m_scanWatcher.waitForFinished();
+  // 模型作为子对象晚于 m_metadata 析构，读取任务须在此之前结束。
+  m_model->stopDetailLoading();
 }
 
 QObject *Backend::imageModel() const { return m_model; }
+QObject *Backend::jobQueue() const { return m_jobs; }
 int Backend::imageCount() const { return m_model->count(); }
 
 QString Backend::windowTitle() const { return m_windowTitle; }
@@ -134,6 +439,16 @@ bool Backend::conversionRunning() const { return m_conversionRunning; }
 double Backend::conversionProgress() const { return m_conversionProgress; }
 int Backend::sortMode() const { return static_cast<int>(m_sortMode); }
 
+FileMetadataCache *Backend::metadataCache() { return &m_metadata; }
+
+QVariantMap Backend::performanceSummary() const { return m_performanceSummary; }
+
+void Backend::updatePerformanceSummary(const QString &key,
+                                       const ConversionTrace &trace) {
+  m_performanceSummary.insert(key, trace.summary().toVariantMap());
+  emit performanceSummaryChanged();
+}
+
 void Backend::setSortMode(int mode) {
   const SortMode normalized = normalizeSortMode(mode);
   if (m_sortMode == normalized) {
@@ -159,14 +474,15 @@ void Backend::setSortMode(int mode) {
 void Backend::addImages(const QStringList &paths) {
   QStringList normalized;
   normalized.reserve(paths.size());
-
-  const QStringList &currentFiles = m_model->getList();
+  QSet<QString> seen;
 
   for (const QString &path : paths) {
     const QString cleaned = cleanedPath(path);
-    if (cleaned.isEmpty() || currentFiles.contains(cleaned)) {
+    if (cleaned.isEmpty() || m_model->contains(cleaned) ||
+        seen.contains(cleaned)) {
       continue;
     }
+    seen.insert(cleaned);
     normalized.append(cleaned);
   }
 
@@ -175,12 +491,71 @@ void Backend::addImages(const QStringList &paths) {
     return;
   }
 
-  m_model->addPaths(normalized);
-  applyCurrentSort(false);
+  insertImages(std::move(normalized));
   emit imageCountChanged();
   setStatusText(tr("已选择 %1 张图片。").arg(m_model->count()));
 }
 
+// 列表在非手动模式下始终保持有序，新条目排好后按位置合并进去，
+// 不再对整个列表重新排序。
+void Backend::insertImages(QStringList paths) {
+  watchParentDirectories(paths);
+  if (m_orderDisturbed && m_sortMode != SortManual) {
+    m_model->addPaths(paths);
+    applyCurrentSort(false);
+    return;
+  }
+  switch (m_sortMode) {
+  case SortManual:
+    m_model->addPaths(paths);
+    return;
+  case SortNameAscending:
+  case SortNameDescending: {
+    const bool ascending = m_sortMode == SortNameAscending;
+    sortImagesByName(paths, ascending, &m_nameSortKeys);
+    m_model->insertSorted(paths,
+                          imageNameLessThan(ascending, &m_nameSortKeys));
+    return;
+  }
+  case SortTimeNewestFirst:
+  case SortTimeOldestFirst: {
+    const bool newestFirst = m_sortMode == SortTimeNewestFirst;
+    sortImagesByTime(paths, newestFirst, &m_metadata);
+    m_model->insertSorted(
+        paths, imageTimeLessThan(newestFirst, &m_metadata));
+    return;
+  }
+  }
+}
+
+// 监视图片所在的目录（而非每个文件），目录内容变化时丢弃其中的元数据缓存。
+// inotify 等机制的监视数量有限，超过上限的目录不再监视。目录监视不报告
+// 原地覆盖写入，这类文件要等其所在行读取附加信息时（readImageDetails 重新
+// stat）才会更新；从未显示过的行在此之前仍按旧的大小与时间排序和预检。
+void Backend::watchParentDirectories(const QStringList &paths) {
+  constexpr int kMaxWatchedDirectories = 2048;
+  QStringList added;
+  for (const QString &path : paths) {
+    if (m_watchedDirectories.size() >= kMaxWatchedDirectories)
+      break;
+    const qsizetype slash = path.lastIndexOf(QLatin1Char('/'));
+    if (slash <= 0)
+      continue;
+    const QString directory = path.left(slash);
+    if (m_watchedDirectories.contains(directory))
+      continue;
+    m_watchedDirectories.insert(directory);
+    added.append(directory);
+  }
+  if (!added.isEmpty())
+    m_directoryWatcher.addPaths(added);
+}
+
+void Backend::handleWatchedDirectoryChanged(const QString &directoryPath) {
+  m_metadata.invalidateDirectory(directoryPath);
+  m_model->invalidateDirectory(directoryPath);
+}
+
 void Backend::removeImage(int index) {
   m_model->removeAt(index);
   emit imageCountChanged();
@@ -189,6 +564,9 @@ void Backend::removeImage(int index) {
 
 void Backend::moveImage(int fromIndex, int toIndex) {
   m_model->move(fromIndex, toIndex);
+  // 排序模式下手动调整后列表不再有序，下次添加时整体重排（与原先行为一致）。
+  if (m_sortMode != SortManual)
+    m_orderDisturbed = true;
   setStatusText(QStringLiteral("已更新图片顺序。"));
 }
 
@@ -197,12 +575,18 @@ void Backend::clearImages() {
   m_pendingInsert.clear();
   m_batchInsertTimer.stop();
   m_model->clear();
+  m_metadata.clear();
+  if (!m_watchedDirectories.isEmpty()) {
+    m_directoryWatcher.removePaths(m_watchedDirectories.values());
+    m_watchedDirectories.clear();
+  }
+  m_nameSortKeys.clear();
   emit imageCountChanged();
   setStatusText(QStringLiteral("已清空所有图片。"));
 }
 
 bool Backend::addDirectory(const QString &directoryPath,
-                           bool includeSubdirectories) {
+                           bool includeSubdirectories, bool forceRescan) {
   if (m_scanWatcher.isRunning()) {
     setStatusText(QStringLiteral("正在读取文件夹，请稍候…"));
     return false;
@@ -236,69 +620,92 @@ bool Backend::addDirectory(const QString &directoryPath,
   m_pendingInsert.clear();
   m_batchInsertTimer.stop();
 
+  // 列表中已有的条目由模型的索引判断，这里只记录本次扫描新发现的路径。
+  m_scanKnownPaths.clear();
+  m_scanFoundCount = 0;
+
   const QString targetPath = dir.absolutePath();
-  auto future = QtConcurrent::run([targetPath, includeSubdirectories,
-                                   cancelFlag = &m_cancelScan]() {
-    QStringList foundFiles;
-    QSet<QString> seen;
-    const QDirIterator::IteratorFlags flags =
-        includeSubdirectories ? QDirIterator::Subdirectories
-                              : QDirIterator::NoIteratorFlags;
-    QDirIterator it(targetPath, QDir::Files, flags);
-    while (it.hasNext()) {
-      if (cancelFlag->load(std::memory_order_relaxed))
-        break;
-      const QString filePath = QDir::cleanPath(it.next());
-      if (!hasSupportedExtension(filePath))
-        continue;
-      if (seen.contains(filePath))
-        continue;
-      seen.insert(filePath);
-      foundFiles.append(filePath);
-    }
-    return foundFiles;
-  });
+  m_scanTrace = std::make_shared<ConversionTrace>();
+  auto future = QtConcurrent::run(
+      [targetPath, includeSubdirectories, forceRescan, metadata = &m_metadata,
+       cancelFlag = &m_cancelScan,
+       trace = m_scanTrace](QPromise<QStringList> &promise) {
+        ScanIndex index(targetPath, includeSubdirectories);
+        index.setMetadataCache(metadata);
+        // 强制完整扫描时不读旧索引，但仍保存新的结果供下次使用。
+        if (!forceRescan) {
+          TraceScope scope(trace.get(), TraceStage::IndexLoad);
+          index.load();
+        }
+        int found = 0;
+        {
+          TraceScope scope(trace.get(), TraceStage::Scan);
+          streamImageDirectory(
+              targetPath, includeSubdirectories, cancelFlag,
+              [&promise, &found](const QStringList &batch) {
+                found += static_cast<int>(batch.size());
+                promise.addResult(batch);
+              },
+              &index);
+        }
+        // 扫描的摘要中 pages 即找到的图片数。
+        trace->addPages(found);
+        if (!cancelFlag->load(std::memory_order_relaxed)) {
+          TraceScope scope(trace.get(), TraceStage::IndexSave);
+          index.save();
+        }
+      });
   m_scanWatcher.setFuture(future);
   return true;
 }
 
+void Backend::handleScanResultsReady(int begin, int end) {
+  if (m_cancelScan.load(std::memory_order_relaxed))
+    return;
+
+  const bool wasIdle = m_pendingInsert.isEmpty();
+  for (int i = begin; i < end; ++i) {
+    const QStringList batch = m_scanWatcher.resultAt(i);
+    for (const QString &path : batch) {
+      const QString cleaned = QDir::cleanPath(path);
+      if (cleaned.isEmpty() || m_model->contains(cleaned) ||
+          m_scanKnownPaths.contains(cleaned))
+        continue;
+      m_scanKnownPaths.insert(cleaned);
+      m_pendingInsert.append(cleaned);
+      ++m_scanFoundCount;
+    }
+  }
+
+  setStatusText(tr("正在扫描文件夹，已找到 %1 张图片…").arg(m_scanFoundCount));
+  if (wasIdle && !m_pendingInsert.isEmpty())
+    m_batchInsertTimer.start();
+}
+
 void Backend::handleDirectoryScanFinished() {
+  m_scanKnownPaths.clear();
+  if (m_scanTrace)
+    updatePerformanceSummary(QStringLiteral("scan"), *m_scanTrace);
   if (m_cancelScan.load(std::memory_order_relaxed)) {
     setStatusText(QStringLiteral("扫描已取消。"));
     return;
   }
-  const QStringList files = m_scanWatcher.result();
-  if (files.isEmpty()) {
-    setStatusText(QStringLiteral("该文件夹中没有可用的图片。"));
+  if (m_scanFoundCount == 0) {
+    setStatusText(m_scanWatcher.future().resultCount() == 0
+                      ? QStringLiteral("该文件夹中没有可用的图片。")
+                      : QStringLiteral("没有新的图片被添加。"));
     return;
   }
-  startBatchInsert(files);
-}
-
-void Backend::startBatchInsert(QStringList files) {
-  m_batchInsertTimer.stop();
-  m_pendingInsert.clear();
-
-  QSet<QString> existing;
-  for (const QString &path : m_model->getList()) {
-    existing.insert(path);
-  }
-
-  for (const QString &path : files) {
-    const QString cleaned = QDir::cleanPath(path);
-    if (cleaned.isEmpty() || existing.contains(cleaned))
-      continue;
-    existing.insert(cleaned);
-    m_pendingInsert.append(cleaned);
-  }
-
+  // 剩余的条目仍由定时器分批插入，插完后再排序。
   if (m_pendingInsert.isEmpty()) {
-    setStatusText(QStringLiteral("没有新的图片被添加。"));
-    return;
+    finishBatchInsert();
+  } else {
+    setStatusText(tr("正在导入 %1 张图片…").arg(m_pendingInsert.size()));
   }
+}
 
-  setStatusText(tr("正在导入 %1 张图片…").arg(m_pendingInsert.size()));
-  m_batchInsertTimer.start();
+void Backend::finishBatchInsert() {
+  setStatusText(tr("已选择 %1 张图片。").arg(m_model->count()));
 }
 
 void Backend::processBatchInsert() {
@@ -311,32 +718,37 @@ void Backend::processBatchInsert() {
   const int chunkCount =
       std::min(kBatchSize, static_cast<int>(m_pendingInsert.size()));
 
+  // 排队期间同一文件可能已经通过 addImages 加入列表，插入前再查一次，
+  // insertSorted 要求新路径都不在列表中。
   QStringList chunk;
   chunk.reserve(chunkCount);
   for (int i = 0; i < chunkCount; ++i) {
-    chunk.append(m_pendingInsert.at(i));
+    const QString &path = m_pendingInsert.at(i);
+    if (!m_model->contains(path))
+      chunk.append(path);
   }
   m_pendingInsert.erase(m_pendingInsert.begin(),
                         m_pendingInsert.begin() + chunkCount);
 
-  m_model->addPaths(chunk);
-  emit imageCountChanged();
+  if (!chunk.isEmpty()) {
+    insertImages(std::move(chunk));
+    emit imageCountChanged();
+  }
 
+  // 扫描仍在进行时只是暂时插完，等后续批次或扫描结束再更新状态。
   if (m_pendingInsert.isEmpty()) {
     m_batchInsertTimer.stop();
-    applyCurrentSort(false);
-    setStatusText(tr("已选择 %1 张图片。").arg(m_model->count()));
+    if (!m_scanWatcher.isRunning())
+      finishBatchInsert();
   }
 }
 
 bool Backend::convertToPdf(const QString &outputFile, int marginMillimeters,
                            bool stretchToPage, const QString &pageSizeId,
-                           bool landscapeOrientation, bool convertToGrayscale) {
-  if (m_conversionRunning) {
-    setStatusText(QStringLiteral("正在转换，请稍候…"));
-    return false;
-  }
-
+                           bool landscapeOrientation, bool convertToGrayscale,
+                           bool jpegPassthrough, int effectiveDpi,
+                           int bilevelMode, int splitMode, int splitValue,
+                           bool appendToExisting, bool automaticEncoding) {
   if (m_model->count() == 0) {
     setStatusText(QStringLiteral("请先添加至少一张图片。"));
     return false;
@@ -367,109 +779,110 @@ bool Backend::convertToPdf(const QString &outputFile, int marginMillimeters,
     }
   }
 
-  QPdfWriter writer(outputInfo.absoluteFilePath());
-  writer.setResolution(300);
-
-  marginMillimeters = std::clamp(marginMillimeters, 0, 50);
-  const QPageSize pageSize = pageSizeFromName(pageSizeId);
-  QPageLayout baseLayout(pageSize,
-                         landscapeOrientation ? QPageLayout::Landscape
-                                              : QPageLayout::Portrait,
-                         QMarginsF(0, 0, 0, 0), QPageLayout::Millimeter);
-  writer.setPageLayout(baseLayout);
-
-  QPainter painter(&writer);
-  if (!painter.isActive()) {
-    setStatusText(QStringLiteral("无法创建 PDF 文件。"));
-    return false;
-  }
-
-  const QSize pagePixels =
-      baseLayout.fullRectPixels(writer.resolution()).size();
-  const double pixelsPerMillimeter = writer.resolution() / 25.4;
-  const int marginPixels = std::clamp(
-      static_cast<int>(std::round(marginMillimeters * pixelsPerMillimeter)), 0,
-      std::numeric_limits<int>::max());
-  const int usableWidth = pagePixels.width() - marginPixels * 2;
-  const int usableHeight = pagePixels.height() - marginPixels * 2;
-  if (usableWidth <= 0 || usableHeight <= 0) {
-    setStatusText(QStringLiteral("边距过大，无法绘制内容。"));
-    return false;
+  ConversionOptions options;
+  options.outputFile = outputInfo.absoluteFilePath();
+  options.marginMillimeters = marginMillimeters;
+  options.stretchToPage = stretchToPage;
+  options.pageSize = pageSizeFromName(pageSizeId);
+  options.landscapeOrientation = landscapeOrientation;
+  options.convertToGrayscale = convertToGrayscale;
+  options.jpegPassthrough = jpegPassthrough;
+  options.effectiveDpi = std::max(0, effectiveDpi);
+  options.bilevelMode = static_cast<BilevelMode>(
+      std::clamp(bilevelMode, static_cast<int>(BilevelMode::Off),
+                 static_cast<int>(BilevelMode::Adaptive)));
+  // splitValue 按分卷方式解释为每卷页数或每卷 MB 数。
+  options.split = static_cast<OutputSplit>(
+      std::clamp(splitMode, static_cast<int>(OutputSplit::None),
+                 static_cast<int>(OutputSplit::BySubdirectory)));
+  if (options.split == OutputSplit::ByPageCount && splitValue > 0)
+    options.splitPageCount = splitValue;
+  if (options.split == OutputSplit::ByInputSize && splitValue > 0)
+    options.splitBytes = qint64(splitValue) * 1024 * 1024;
+  options.appendToExisting = appendToExisting;
+  options.automaticEncoding = automaticEncoding;
+
+  // 转换基于列表快照进行，期间对列表的修改不影响本次输出。
+  const QStringList &files = m_model->getList();
+  // 预检只用已缓存的文件大小，不在界面线程上 stat。
+  QList<qint64> knownSizes;
+  knownSizes.reserve(files.size());
+  for (const QString &path : files) {
+    FileMetadata metadata;
+    knownSizes.append(m_metadata.lookup(path, &metadata) ? metadata.size : -1);
   }
-  const QRect pageRect(marginPixels, marginPixels, usableWidth, usableHeight);
-
-  setConversionRunning(true);
-  setConversionProgress(0.0);
-  const auto guard = qScopeGuard([this]() {
-    setConversionRunning(false);
-    setConversionProgress(0.0);
-  });
-
-  int convertedPages = 0;
-  QStringList failedFiles;
-
-  const QStringList &fileList = m_model->getList();
-  const int totalFiles = fileList.size();
-
-  for (int i = 0; i < fileList.size(); ++i) {
-    const QString &path = fileList.at(i);
-    const QString fileName = QFileInfo(path).fileName();
-    setStatusText(tr("正在处理第 %1/%2 张：%3")
-                      .arg(i + 1)
-                      .arg(std::max(1, totalFiles))
-                      .arg(fileName));
-    QImage image(path);
-    if (image.isNull()) {
-      failedFiles << fileName;
-      continue;
-    }
-
-    if (convertToGrayscale) {
-      image = image.convertToFormat(QImage::Format_Grayscale8);
-    }
-
-    if (convertedPages > 0) {
-      if (!writer.newPage()) {
-        setStatusText(QStringLiteral("无法创建 PDF 页面。"));
-        return false;
-      }
-      writer.setPageLayout(baseLayout);
-    }
 
-    QRect targetRect = pageRect;
+  const bool queued = m_jobs->activeCount() > 0;
+  m_jobs->enqueue(files, std::move(knownSizes), std::move(options));
+  setStatusText(queued ? tr("已将 %1 加入转换队列。").arg(outputInfo.fileName())
+                       : QStringLiteral("正在转换…"));
+  return true;
+}
 
-    if (!stretchToPage) {
-      QSize size = image.size();
-      size.scale(pageRect.size(), Qt::KeepAspectRatio);
-      const QPoint offset(pageRect.x() + (pageRect.width() - size.width()) / 2,
-                          pageRect.y() +
-                              (pageRect.height() - size.height()) / 2);
-      targetRect = QRect(offset, size);
-    }
+void Backend::cancelConversion() {
+  if (m_jobs->activeCount() == 0)
+    return;
+  m_jobs->cancelAll();
+  setStatusText(QStringLiteral("正在取消转换…"));
+}
 
-    painter.drawImage(targetRect, image);
-    ++convertedPages;
-    setConversionProgress(static_cast<double>(i + 1) / std::max(1, totalFiles));
-    QCoreApplication::processEvents();
+void Backend::handleJobFinished(int jobId, const QString &title,
+                                const ConversionResult &result,
+                                const QVariantMap &performance) {
+  Q_UNUSED(jobId);
+  if (!performance.isEmpty()) {
+    m_performanceSummary.insert(QStringLiteral("conversion"), performance);
+    emit performanceSummaryChanged();
   }
 
-  if (convertedPages == 0) {
-    setStatusText(QStringLiteral("没有任何图片被写入。"));
-    return false;
+  if (!result.success) {
+    setStatusText(m_jobs->activeCount() > 0
+                      ? tr("%1：%2").arg(title, result.errorText)
+                      : result.errorText);
+    return;
   }
 
-  if (!failedFiles.isEmpty()) {
-    setStatusText(tr("转换完成，但跳过了 %1 个文件：%2")
-                      .arg(failedFiles.size())
-                      .arg(failedFiles.join(", ")));
+  QString summary;
+  if (!result.failedFiles.isEmpty()) {
+    summary = tr("转换完成，但跳过了 %1 个文件：%2")
+                  .arg(result.failedFiles.size())
+                  .arg(result.failedFiles.join(", "));
+  } else if (result.outputFiles.size() > 1) {
+    summary = tr("成功将 %1 张图片分 %2 卷保存（%3 至 %4）")
+                  .arg(result.convertedPages)
+                  .arg(result.outputFiles.size())
+                  .arg(QFileInfo(result.outputFiles.first()).fileName(),
+                       QFileInfo(result.outputFiles.last()).fileName());
+  } else if (result.existingPages > 0) {
+    summary = tr("成功将 %1 张图片追加到 %2（共 %3 页）")
+                  .arg(result.convertedPages)
+                  .arg(title)
+                  .arg(result.existingPages + result.convertedPages);
   } else {
-    setStatusText(tr("成功将 %1 张图片保存到 %2")
-                      .arg(convertedPages)
-                      .arg(outputInfo.fileName()));
-  }
-
-  setConversionProgress(1.0);
-  return true;
+    summary = tr("成功将 %1 张图片保存到 %2")
+                  .arg(result.convertedPages)
+                  .arg(title);
+  }
+  if (result.passthroughPages > 0) {
+    summary += tr("（%1 张 JPEG/PNG 直接嵌入）").arg(result.passthroughPages);
+  }
+  if (result.resampledPages > 0) {
+    summary += tr("（%1 张按有效分辨率缩小）").arg(result.resampledPages);
+  }
+  if (result.deduplicatedPages > 0) {
+    summary += tr("（%1 页重复图片共用，节省 %2）")
+                   .arg(result.deduplicatedPages)
+                   .arg(QLocale().formattedDataSize(result.deduplicatedBytes));
+  }
+  const auto &classes = result.pagesByClass;
+  if (classes[0] + classes[1] + classes[2] + classes[3] > 0) {
+    summary += tr("（自动编码：黑白 %1 页、灰度 %2 页、调色板 %3 页、彩色 %4 页）")
+                   .arg(classes[0])
+                   .arg(classes[1])
+                   .arg(classes[2])
+                   .arg(classes[3]);
+  }
+  setStatusText(summary);
 }
 
 void Backend::setStatusText(const QString &text) {
@@ -520,29 +933,6 @@ QString Backend::cleanedPath(const QString &path) const {
   return QDir::cleanPath(info.absoluteFilePath());
 }
 
-QPageSize Backend::pageSizeFromName(const QString &pageName) const {
-  const QString key = pageName.trimmed().toUpper();
-  if (key == QLatin1String("A3")) {
-    return QPageSize(QPageSize::A3);
-  }
-  if (key == QLatin1String("A5")) {
-    return QPageSize(QPageSize::A5);
-  }
-  if (key == QLatin1String("LETTER")) {
-    return QPageSize(QPageSize::Letter);
-  }
-  if (key == QLatin1String("LEGAL")) {
-    return QPageSize(QPageSize::Legal);
-  }
-  if (key == QLatin1String("B5")) {
-    return QPageSize(QPageSize::B5);
-  }
-  if (key == QLatin1String("TABLOID")) {
-    return QPageSize(QPageSize::Tabloid);
-  }
-  return QPageSize(QPageSize::A4);
-}
-
 void Backend::applyCurrentSort(bool announceChange) {
   const SortMode mode = m_sortMode;
   if (mode == SortManual) {
@@ -552,6 +942,7 @@ void Backend::applyCurrentSort(bool announceChange) {
     return;
   }
 
+  m_orderDisturbed = false;
   const QStringList current = m_model->getList();
   if (current.size() < 2) {
     if (announceChange) {
@@ -564,16 +955,16 @@ void Backend::applyCurrentSort(bool announceChange) {
 
   switch (mode) {
   case SortNameAscending:
-    resortByName(sorted, true);
+    sortImagesByName(sorted, true, &m_nameSortKeys);
     break;
   case SortNameDescending:
-    resortByName(sorted, false);
+    sortImagesByName(sorted, false, &m_nameSortKeys);
     break;
   case SortTimeNewestFirst:
-    resortByTime(sorted, true);
+    sortImagesByTime(sorted, true, &m_metadata);
     break;
   case SortTimeOldestFirst:
-    resortByTime(sorted, false);
+    sortImagesByTime(sorted, false, &m_metadata);
     break;
   case SortManual:
     break;
@@ -600,75 +991,6 @@ Backend::SortMode Backend::normalizeSortMode(int value) {
   return SortManual;
 }
 
-void Backend::resortByName(QStringList &entries, bool ascending) const {
-  if (entries.size() < 2)
-    return;
-
-  struct NameEntry {
-    QString path;
-    QString fileName;
-  };
-
-  std::vector<NameEntry> data;
-  data.reserve(entries.size());
-  for (const QString &path : entries) {
-    data.push_back(NameEntry{path, QFileInfo(path).fileName()});
-  }
-
-  QCollator collator;
-  collator.setCaseSensitivity(Qt::CaseInsensitive);
-  collator.setNumericMode(true);
-
-  std::stable_sort(data.begin(), data.end(),
-                   [ascending, collator](const NameEntry &left,
-                                         const NameEntry &right) mutable {
-                     int cmp = collator.compare(left.fileName, right.fileName);
-                     if (cmp == 0) {
-                       cmp = collator.compare(left.path, right.path);
-                     }
-                     if (cmp == 0)
-                       return false;
-                     return ascending ? cmp < 0 : cmp > 0;
-                   });
-
-  for (int i = 0; i < static_cast<int>(data.size()); ++i) {
-    entries[i] = data.at(i).path;
-  }
-}
-
-void Backend::resortByTime(QStringList &entries, bool newestFirst) const {
-  if (entries.size() < 2)
-    return;
-
-  struct TimeEntry {
-    QString path;
-    qint64 timestamp;
-  };
-
-  std::vector<TimeEntry> data;
-  data.reserve(entries.size());
-  for (const QString &path : entries) {
-    const QFileInfo info(path);
-    const QDateTime modified = info.lastModified();
-    const qint64 stamp = modified.isValid() ? modified.toMSecsSinceEpoch() : 0;
-    data.push_back(TimeEntry{path, stamp});
-  }
-
-  std::stable_sort(
-      data.begin(), data.end(),
-      [newestFirst](const TimeEntry &left, const TimeEntry &right) {
-        if (left.timestamp == right.timestamp) {
-          return left.path < right.path;
-        }
-        return newestFirst ? left.timestamp > right.timestamp
-                           : left.timestamp < right.timestamp;
-      });
-
-  for (int i = 0; i < static_cast<int>(data.size()); ++i) {
-    entries[i] = data.at(i).path;
-  }
-}
-
 QString Backend::sortDescription(SortMode mode) const {
   switch (mode) {
   case SortNameAscending:
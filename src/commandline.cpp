@@ -0,0 +1,780 @@
+#include "commandline.h"
+#include "conversiontrace.h"
+#include "converter.h"
+#include "hotfolder.h"
+#include "imagelist.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QLocale>
+#include <QSet>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <memory>
+
+namespace {
+enum ExitCode { ExitSuccess = 0, ExitJobFailed = 1, ExitUsageError = 2 };
+
+struct CommandLineJob {
+  QStringList inputs;
+  bool includeSubdirectories = true;
+  QString sortMode = QStringLiteral("name");
+  ConversionOptions options;
+};
+
+QTextStream &standardOutput() {
+  static QTextStream stream(stdout);
+  return stream;
+}
+
+QTextStream &standardError() {
+  static QTextStream stream(stderr);
+  return stream;
+}
+
+bool parseResampleFilter(const QString &name, ResampleFilter *filter) {
+  const QString key = name.trimmed().toLower();
+  if (key == QLatin1String("lanczos")) {
+    *filter = ResampleFilter::Lanczos3;
+    return true;
+  }
+  if (key == QLatin1String("box")) {
+    *filter = ResampleFilter::Box;
+    return true;
+  }
+  return false;
+}
+
+bool parseBilevelMode(const QString &name, BilevelMode *mode) {
+  const QString key = name.trimmed().toLower();
+  if (key == QLatin1String("off")) {
+    *mode = BilevelMode::Off;
+    return true;
+  }
+  if (key == QLatin1String("global")) {
+    *mode = BilevelMode::Global;
+    return true;
+  }
+  if (key == QLatin1String("adaptive")) {
+    *mode = BilevelMode::Adaptive;
+    return true;
+  }
+  return false;
+}
+
+bool isKnownSortMode(const QString &mode) {
+  static const QStringList modes = {
+      QStringLiteral("name"), QStringLiteral("name-desc"),
+      QStringLiteral("time-newest"), QStringLiteral("time-oldest"),
+      QStringLiteral("none")};
+  return modes.contains(mode);
+}
+
+void applySort(QStringList &files, const QString &mode) {
+  if (mode == QLatin1String("name")) {
+    sortImagesByName(files, true);
+  } else if (mode == QLatin1String("name-desc")) {
+    sortImagesByName(files, false);
+  } else if (mode == QLatin1String("time-newest")) {
+    sortImagesByTime(files, true);
+  } else if (mode == QLatin1String("time-oldest")) {
+    sortImagesByTime(files, false);
+  }
+}
+
+QStringList collectImages(const CommandLineJob &job, ConversionTrace *trace) {
+  QStringList files;
+  QSet<QString> seen;
+  const auto append = [&](const QString &path) {
+    if (seen.contains(path))
+      return;
+    seen.insert(path);
+    files.append(path);
+  };
+
+  for (const QString &input : job.inputs) {
+    const QFileInfo info(input);
+    if (info.isDir()) {
+      TraceScope scope(trace, TraceStage::Scan);
+      const QStringList found = scanImageDirectory(info.absoluteFilePath(),
+                                                   job.includeSubdirectories);
+      for (const QString &path : found)
+        append(path);
+    } else if (info.isFile()) {
+      append(QDir::cleanPath(info.absoluteFilePath()));
+    } else {
+      standardError() << "找不到输入：" << input << Qt::endl;
+    }
+  }
+  return files;
+}
+
+const char *pageClassLabel(PageClass pageClass) {
+  switch (pageClass) {
+  case PageClass::Bilevel:
+    return "黑白";
+  case PageClass::Grayscale:
+    return "灰度";
+  case PageClass::Palette:
+    return "调色板";
+  case PageClass::Color:
+    break;
+  }
+  return "彩色";
+}
+
+// 自动编码时按内容分类统计页数；report 为真时逐页列出所选编码及其相对
+// 固定编码（--flate-level 下的 JPEG/Flate）的大小。
+void printEncodingSummary(const ConversionResult &result, bool report) {
+  standardOutput() << "自动编码：";
+  for (int i = 0; i < int(result.pagesByClass.size()); ++i) {
+    if (i > 0)
+      standardOutput() << "，";
+    standardOutput() << pageClassLabel(static_cast<PageClass>(i)) << " "
+                     << result.pagesByClass[i] << " 页";
+  }
+  standardOutput() << Qt::endl;
+  if (!report)
+    return;
+  const QLocale locale;
+  for (const PageEncodingRecord &record : result.encodingRecords) {
+    standardOutput() << "  " << record.fileName << "："
+                     << pageClassLabel(record.pageClass) << "，"
+                     << record.encoding << "，"
+                     << locale.formattedDataSize(record.bytes);
+    if (record.baselineBytes >= 0)
+      standardOutput() << "（固定编码 "
+                       << locale.formattedDataSize(record.baselineBytes) << "）";
+    standardOutput() << Qt::endl;
+  }
+  if (result.encodingSavedBytes >= 0)
+    standardOutput() << "自动编码共节省 "
+                     << locale.formattedDataSize(result.encodingSavedBytes)
+                     << Qt::endl;
+  else
+    standardOutput() << "自动编码比固定编码多用 "
+                     << locale.formattedDataSize(-result.encodingSavedBytes)
+                     << Qt::endl;
+}
+
+bool runJob(const CommandLineJob &job, ConversionTrace *trace) {
+  const QString outputName = job.options.outputFile;
+  QStringList files = collectImages(job, trace);
+  if (files.isEmpty()) {
+    standardError() << outputName << "：没有可用的图片。" << Qt::endl;
+    return false;
+  }
+  applySort(files, job.sortMode);
+
+  const QFileInfo outputInfo(outputName);
+  if (!outputInfo.dir().exists() &&
+      !QDir().mkpath(outputInfo.dir().absolutePath())) {
+    standardError() << outputName << "：无法创建输出目录。" << Qt::endl;
+    return false;
+  }
+
+  CommandLineJob resolved = job;
+  resolved.options.outputFile = outputInfo.absoluteFilePath();
+  PdfConverter converter(files, resolved.options);
+  converter.setTrace(trace);
+  const ConversionResult result = converter.run();
+  for (const QString &failed : result.failedFiles) {
+    standardError() << "跳过无法读取的文件：" << failed << Qt::endl;
+  }
+  if (!result.success) {
+    standardError() << outputName << "：" << result.errorText << Qt::endl;
+    return false;
+  }
+
+  if (result.outputFiles.size() > 1) {
+    for (const QString &volume : result.outputFiles)
+      standardOutput() << "分卷：" << volume << Qt::endl;
+  }
+  standardOutput() << outputName << "：已写入 " << result.convertedPages
+                   << " 页";
+  if (result.existingPages > 0)
+    standardOutput() << "（追加，共 "
+                     << result.existingPages + result.convertedPages << " 页）";
+  if (result.passthroughPages > 0)
+    standardOutput() << "（" << result.passthroughPages
+                     << " 张 JPEG/PNG 直接嵌入）";
+  if (result.deduplicatedPages > 0)
+    standardOutput() << "（" << result.deduplicatedPages << " 页重复图片共用，节省 "
+                     << QLocale().formattedDataSize(result.deduplicatedBytes)
+                     << "）";
+  standardOutput() << Qt::endl;
+  if (resolved.options.automaticEncoding)
+    printEncodingSummary(result, resolved.options.reportEncoding);
+  return result.failedFiles.isEmpty();
+}
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+extern "C" void requestStop(int) { stopRequested = 1; }
+
+// 监视模式一直运行到收到 SIGINT 或 SIGTERM，退出前完成当前的 PDF。
+int runWatchMode(const HotFolderOptions &options) {
+  HotFolderWatcher watcher(options);
+  int failedDocuments = 0;
+  QObject::connect(&watcher, &HotFolderWatcher::filesAppended,
+                   [](const QString &outputFile, int count, int pageCount) {
+                     standardOutput()
+                         << QFileInfo(outputFile).fileName() << "：追加 "
+                         << count << " 页，共 " << pageCount << " 页"
+                         << Qt::endl;
+                   });
+  QObject::connect(
+      &watcher, &HotFolderWatcher::documentFinished,
+      [&failedDocuments](const QString &outputFile,
+                         const ConversionResult &result) {
+        for (const QString &failed : result.failedFiles)
+          standardError() << "跳过无法读取的文件：" << failed << Qt::endl;
+        if (!result.success) {
+          ++failedDocuments;
+          standardError() << outputFile << "：" << result.errorText << Qt::endl;
+          return;
+        }
+        standardOutput() << outputFile << "：已写入 " << result.convertedPages
+                         << " 页" << Qt::endl;
+      });
+
+  QString error;
+  if (!watcher.start(&error)) {
+    standardError() << error << Qt::endl;
+    return ExitUsageError;
+  }
+  standardOutput() << "正在监视 " << options.directoryPath
+                   << "，按 Ctrl+C 结束。" << Qt::endl;
+
+  // 信号处理函数里只置标志，由事件循环定期检查后退出。
+  std::signal(SIGINT, requestStop);
+  std::signal(SIGTERM, requestStop);
+  QTimer stopPoll;
+  QObject::connect(&stopPoll, &QTimer::timeout, []() {
+    if (stopRequested)
+      QCoreApplication::quit();
+  });
+  stopPoll.start(200);
+  QCoreApplication::exec();
+
+  standardOutput() << "正在完成当前的 PDF…" << Qt::endl;
+  watcher.stop();
+  return failedDocuments == 0 ? ExitSuccess : ExitJobFailed;
+}
+
+QStringList stringListValue(const QJsonValue &value) {
+  QStringList list;
+  if (value.isString()) {
+    list << value.toString();
+  } else if (value.isArray()) {
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue &entry : array) {
+      if (entry.isString())
+        list << entry.toString();
+    }
+  }
+  return list;
+}
+
+// 作业文件可以是作业数组，也可以是带 "jobs" 数组的对象；
+// 未写明的字段沿用命令行上的设置，相对路径以作业文件所在目录为基准。
+bool loadJobFile(const QString &filePath, const CommandLineJob &defaults,
+                 QList<CommandLineJob> *jobs, QString *error) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    *error = QStringLiteral("无法读取作业文件：%1").arg(filePath);
+    return false;
+  }
+
+  QJsonParseError parseError;
+  const QJsonDocument document =
+      QJsonDocument::fromJson(file.readAll(), &parseError);
+  if (parseError.error != QJsonParseError::NoError) {
+    *error = QStringLiteral("作业文件格式错误：%1").arg(parseError.errorString());
+    return false;
+  }
+
+  const QJsonArray entries = document.isArray()
+                                 ? document.array()
+                                 : document.object().value("jobs").toArray();
+  const QDir baseDir = QFileInfo(filePath).absoluteDir();
+
+  for (int i = 0; i < entries.size(); ++i) {
+    const QJsonObject object = entries.at(i).toObject();
+    CommandLineJob job = defaults;
+
+    QStringList inputs = stringListValue(object.value("inputs"));
+    inputs << stringListValue(object.value("input"));
+    if (!inputs.isEmpty()) {
+      job.inputs.clear();
+      for (const QString &input : inputs)
+        job.inputs << baseDir.absoluteFilePath(input);
+    }
+    if (object.contains("output"))
+      job.options.outputFile =
+          baseDir.absoluteFilePath(object.value("output").toString());
+    if (object.contains("page"))
+      job.options.pageSize = pageSizeFromName(object.value("page").toString());
+    if (object.contains("margin"))
+      job.options.marginMillimeters = object.value("margin").toInt();
+    if (object.contains("landscape"))
+      job.options.landscapeOrientation = object.value("landscape").toBool();
+    if (object.contains("stretch"))
+      job.options.stretchToPage = object.value("stretch").toBool();
+    if (object.contains("gray"))
+      job.options.convertToGrayscale = object.value("gray").toBool();
+    if (object.contains("bilevel") &&
+        !parseBilevelMode(object.value("bilevel").toString(),
+                          &job.options.bilevelMode)) {
+      *error = QStringLiteral("作业 %1 的二值化方式无效。").arg(i + 1);
+      return false;
+    }
+    if (object.contains("jpegPassthrough"))
+      job.options.jpegPassthrough = object.value("jpegPassthrough").toBool();
+    if (object.contains("pngPassthrough"))
+      job.options.pngPassthrough = object.value("pngPassthrough").toBool();
+    if (object.contains("flateLevel"))
+      job.options.flateLevel =
+          std::clamp(object.value("flateLevel").toInt(), 0, 9);
+    if (object.contains("dedup"))
+      job.options.deduplicateImages = object.value("dedup").toBool();
+    if (object.contains("pixelDedup"))
+      job.options.pixelDeduplication = object.value("pixelDedup").toBool();
+    if (object.contains("dpi"))
+      job.options.effectiveDpi = std::max(0, object.value("dpi").toInt());
+    if (object.contains("resample") &&
+        !parseResampleFilter(object.value("resample").toString(),
+                             &job.options.resampleFilter)) {
+      *error = QStringLiteral("作业 %1 的重采样方式无效。").arg(i + 1);
+      return false;
+    }
+    // 与命令行相同：分卷方式只能选一个，每卷的页数与大小必须是正整数。
+    const bool splitDirectories = object.value("splitDirectories").toBool();
+    const int splitModes = int(object.contains("splitPages")) +
+                           int(object.contains("splitSizeMB")) +
+                           int(splitDirectories);
+    if (splitModes > 1) {
+      *error = QStringLiteral("作业 %1 的 splitPages、splitSizeMB 与 "
+                              "splitDirectories 只能选一个。")
+                   .arg(i + 1);
+      return false;
+    }
+    if (object.contains("splitPages")) {
+      job.options.split = OutputSplit::ByPageCount;
+      job.options.splitPageCount = object.value("splitPages").toInt();
+      if (job.options.splitPageCount <= 0) {
+        *error = QStringLiteral("作业 %1 的每卷页数必须是正整数。").arg(i + 1);
+        return false;
+      }
+    } else if (object.contains("splitSizeMB")) {
+      job.options.split = OutputSplit::ByInputSize;
+      const qint64 megabytes = object.value("splitSizeMB").toInteger();
+      if (megabytes <= 0) {
+        *error =
+            QStringLiteral("作业 %1 的每卷大小必须是正整数 MB。").arg(i + 1);
+        return false;
+      }
+      job.options.splitBytes = megabytes * 1024 * 1024;
+    } else if (splitDirectories) {
+      job.options.split = OutputSplit::BySubdirectory;
+    }
+    if (object.contains("streamMB"))
+      job.options.streamingThresholdBytes =
+          std::max<qint64>(0, object.value("streamMB").toInteger()) * 1024 *
+          1024;
+    if (object.contains("autoEncoding"))
+      job.options.automaticEncoding = object.value("autoEncoding").toBool();
+    if (object.contains("encodingReport")) {
+      job.options.reportEncoding = object.value("encodingReport").toBool();
+      if (job.options.reportEncoding)
+        job.options.automaticEncoding = true;
+    }
+    if (object.contains("append"))
+      job.options.appendToExisting = object.value("append").toBool();
+    if (job.options.appendToExisting &&
+        job.options.split != OutputSplit::None) {
+      *error = QStringLiteral("作业 %1 的 append 不能与分卷选项同时使用。")
+                   .arg(i + 1);
+      return false;
+    }
+    if (object.contains("recursive"))
+      job.includeSubdirectories = object.value("recursive").toBool();
+    if (object.contains("sort"))
+      job.sortMode = object.value("sort").toString().trimmed().toLower();
+
+    if (job.inputs.isEmpty() || job.options.outputFile.isEmpty()) {
+      *error = QStringLiteral("作业 %1 缺少 input 或 output。").arg(i + 1);
+      return false;
+    }
+    if (!isKnownSortMode(job.sortMode)) {
+      *error = QStringLiteral("作业 %1 的排序方式无效：%2")
+                   .arg(i + 1)
+                   .arg(job.sortMode);
+      return false;
+    }
+    jobs->append(job);
+  }
+
+  if (jobs->isEmpty()) {
+    *error = QStringLiteral("作业文件中没有任何作业。");
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+bool isCommandLineInvocation(int argc, char *argv[]) {
+  static const char *const triggers[] = {"--input", "-i",     "--output",
+                                         "-o",      "--job",  "--watch",
+                                         "--help",  "-h"};
+  for (int i = 1; i < argc; ++i) {
+    const char *argument = argv[i];
+    for (const char *trigger : triggers) {
+      const size_t length = std::strlen(trigger);
+      if (std::strncmp(argument, trigger, length) == 0 &&
+          (argument[length] == '\0' || argument[length] == '='))
+        return true;
+    }
+  }
+  return false;
+}
+
+int runCommandLine(const QStringList &arguments) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      QStringLiteral("批量把图片转换为 PDF（命令行模式，不启动图形界面）。"));
+  parser.addHelpOption();
+
+  const QCommandLineOption inputOption(
+      {QStringLiteral("i"), QStringLiteral("input")},
+      QStringLiteral("输入的图片或文件夹，可重复指定。"), QStringLiteral("path"));
+  const QCommandLineOption outputOption(
+      {QStringLiteral("o"), QStringLiteral("output")},
+      QStringLiteral("输出的 PDF 文件。"), QStringLiteral("file"));
+  const QCommandLineOption jobOption(
+      QStringLiteral("job"),
+      QStringLiteral("JSON 作业文件，一次执行多个转换任务。"),
+      QStringLiteral("file"));
+  const QCommandLineOption pageOption(
+      QStringLiteral("page"),
+      QStringLiteral("纸张大小：A3、A4、A5、B5、Letter、Legal、Tabloid。"),
+      QStringLiteral("size"), QStringLiteral("A4"));
+  const QCommandLineOption marginOption(QStringLiteral("margin"),
+                                        QStringLiteral("页边距（毫米）。"),
+                                        QStringLiteral("mm"),
+                                        QStringLiteral("10"));
+  const QCommandLineOption sortOption(
+      QStringLiteral("sort"),
+      QStringLiteral(
+          "排序方式：name、name-desc、time-newest、time-oldest、none。"),
+      QStringLiteral("mode"), QStringLiteral("name"));
+  const QCommandLineOption dpiOption(
+      QStringLiteral("dpi"),
+      QStringLiteral("有效分辨率，超出的图片会被缩小；0 表示保持原图。"),
+      QStringLiteral("dpi"), QStringLiteral("0"));
+  const QCommandLineOption resampleOption(
+      QStringLiteral("resample"), QStringLiteral("缩小时使用的滤波器：lanczos、box。"),
+      QStringLiteral("filter"), QStringLiteral("lanczos"));
+  const QCommandLineOption landscapeOption(QStringLiteral("landscape"),
+                                           QStringLiteral("横向页面。"));
+  const QCommandLineOption stretchOption(
+      QStringLiteral("stretch"), QStringLiteral("拉伸填满页面（不保留比例）。"));
+  const QCommandLineOption grayOption(QStringLiteral("gray"),
+                                      QStringLiteral("强制转换为灰度。"));
+  const QCommandLineOption bilevelOption(
+      QStringLiteral("bilevel"),
+      QStringLiteral("黑白二值化：off、global（Otsu）、adaptive（Sauvola）。"),
+      QStringLiteral("mode"), QStringLiteral("off"));
+  const QCommandLineOption noPassthroughOption(
+      QStringLiteral("no-jpeg-passthrough"),
+      QStringLiteral("JPEG 也重新解码压缩，不直接嵌入。"));
+  const QCommandLineOption noPngPassthroughOption(
+      QStringLiteral("no-png-passthrough"),
+      QStringLiteral("PNG 也重新解码压缩，不直接嵌入。"));
+  const QCommandLineOption flateLevelOption(
+      QStringLiteral("flate-level"),
+      QStringLiteral("无损页面的压缩级别 0～9，越大越小也越慢。"),
+      QStringLiteral("level"), QStringLiteral("6"));
+  const QCommandLineOption autoEncodingOption(
+      QStringLiteral("auto-encoding"),
+      QStringLiteral("按页面内容自动选择黑白、灰度、调色板或彩色编码。"));
+  const QCommandLineOption encodingReportOption(
+      QStringLiteral("encoding-report"),
+      QStringLiteral("逐页列出自动选择的编码及节省的大小（隐含 --auto-encoding）。"));
+  const QCommandLineOption streamOption(
+      QStringLiteral("stream-mb"),
+      QStringLiteral("整幅解码超过这么多 MB 的图像按条带分段读取并缩小，0 表示关闭。"),
+      QStringLiteral("mb"), QStringLiteral("256"));
+  const QCommandLineOption noDedupOption(
+      QStringLiteral("no-dedup"),
+      QStringLiteral("不合并内容相同的图片，每页单独写入。"));
+  const QCommandLineOption pixelDedupOption(
+      QStringLiteral("pixel-dedup"),
+      QStringLiteral("额外合并文件不同但编码后数据相同的图片。"));
+  const QCommandLineOption noRecursiveOption(
+      QStringLiteral("no-recursive"), QStringLiteral("不扫描子文件夹。"));
+  const QCommandLineOption splitPagesOption(
+      QStringLiteral("split-pages"),
+      QStringLiteral("每卷的页数，输出多个 PDF 并同时写入。"),
+      QStringLiteral("pages"));
+  const QCommandLineOption splitSizeOption(
+      QStringLiteral("split-size"),
+      QStringLiteral("按输入文件大小分卷，每卷不超过指定的 MB 数。"),
+      QStringLiteral("mb"));
+  const QCommandLineOption splitDirectoriesOption(
+      QStringLiteral("split-dirs"),
+      QStringLiteral("每个源文件夹输出一卷。"));
+  const QCommandLineOption readaheadOption(
+      QStringLiteral("readahead"),
+      QStringLiteral("解码时提前预读后面多少个文件，0 表示关闭。"),
+      QStringLiteral("files"), QStringLiteral("16"));
+  const QCommandLineOption readaheadSizeOption(
+      QStringLiteral("readahead-mb"),
+      QStringLiteral("预读数据的上限（MB）。"), QStringLiteral("mb"),
+      QStringLiteral("128"));
+  const QCommandLineOption appendOption(
+      QStringLiteral("append"),
+      QStringLiteral("输出文件已存在时把页面追加到末尾（增量更新，不改动原有内容）。"));
+  const QCommandLineOption watchOption(
+      QStringLiteral("watch"),
+      QStringLiteral("持续监视文件夹，把新出现的图片陆续写入 PDF。"),
+      QStringLiteral("dir"));
+  const QCommandLineOption watchIdleOption(
+      QStringLiteral("watch-idle"),
+      QStringLiteral("监视模式下这么多秒没有新图片时完成当前 PDF，0 表示不限。"),
+      QStringLiteral("seconds"), QStringLiteral("60"));
+  const QCommandLineOption watchPagesOption(
+      QStringLiteral("watch-pages"),
+      QStringLiteral("监视模式下每个 PDF 的页数上限，0 表示不限。"),
+      QStringLiteral("pages"), QStringLiteral("0"));
+  const QCommandLineOption watchSettleOption(
+      QStringLiteral("watch-settle"),
+      QStringLiteral("文件大小与修改时间保持不变多少秒后视为写完。"),
+      QStringLiteral("seconds"), QStringLiteral("2"));
+  const QCommandLineOption watchExistingOption(
+      QStringLiteral("watch-existing"),
+      QStringLiteral("监视模式下也转换启动时已在文件夹中的图片。"));
+  const QCommandLineOption traceOption(
+      QStringLiteral("trace"),
+      QStringLiteral("把各阶段耗时写入 Chrome Trace 格式的 JSON，可用 Perfetto 查看。"),
+      QStringLiteral("file"));
+
+  parser.addOptions({inputOption, outputOption, jobOption, pageOption,
+                     marginOption, sortOption, dpiOption, resampleOption,
+                     landscapeOption, stretchOption,
+                     grayOption, bilevelOption, noPassthroughOption,
+                     noPngPassthroughOption, flateLevelOption,
+                     autoEncodingOption, encodingReportOption, streamOption,
+                     noDedupOption, pixelDedupOption, noRecursiveOption,
+                     splitPagesOption, splitSizeOption, splitDirectoriesOption,
+                     readaheadOption, readaheadSizeOption, appendOption,
+                     watchOption, watchIdleOption, watchPagesOption,
+                     watchSettleOption, watchExistingOption, traceOption});
+  parser.process(arguments);
+
+  bool marginValid = false;
+  CommandLineJob defaults;
+  defaults.inputs = parser.values(inputOption);
+  defaults.includeSubdirectories = !parser.isSet(noRecursiveOption);
+  defaults.sortMode = parser.value(sortOption).trimmed().toLower();
+  defaults.options.outputFile = parser.value(outputOption);
+  defaults.options.pageSize = pageSizeFromName(parser.value(pageOption));
+  defaults.options.marginMillimeters =
+      parser.value(marginOption).toInt(&marginValid);
+  defaults.options.landscapeOrientation = parser.isSet(landscapeOption);
+  defaults.options.stretchToPage = parser.isSet(stretchOption);
+  defaults.options.convertToGrayscale = parser.isSet(grayOption);
+  defaults.options.jpegPassthrough = !parser.isSet(noPassthroughOption);
+  defaults.options.pngPassthrough = !parser.isSet(noPngPassthroughOption);
+  bool flateLevelValid = false;
+  defaults.options.flateLevel =
+      parser.value(flateLevelOption).toInt(&flateLevelValid);
+  defaults.options.reportEncoding = parser.isSet(encodingReportOption);
+  defaults.options.automaticEncoding =
+      parser.isSet(autoEncodingOption) || defaults.options.reportEncoding;
+  defaults.options.deduplicateImages = !parser.isSet(noDedupOption);
+  defaults.options.pixelDeduplication = parser.isSet(pixelDedupOption);
+  defaults.options.appendToExisting = parser.isSet(appendOption);
+
+  bool dpiValid = false;
+  defaults.options.effectiveDpi = parser.value(dpiOption).toInt(&dpiValid);
+  bool readaheadValid = false;
+  bool readaheadSizeValid = false;
+  defaults.options.readaheadFiles =
+      parser.value(readaheadOption).toInt(&readaheadValid);
+  const qint64 readaheadMegabytes =
+      parser.value(readaheadSizeOption).toLongLong(&readaheadSizeValid);
+  defaults.options.readaheadBytes = readaheadMegabytes * 1024 * 1024;
+  bool streamValid = false;
+  const qint64 streamMegabytes =
+      parser.value(streamOption).toLongLong(&streamValid);
+  defaults.options.streamingThresholdBytes = streamMegabytes * 1024 * 1024;
+
+  const int splitModes = int(parser.isSet(splitPagesOption)) +
+                         int(parser.isSet(splitSizeOption)) +
+                         int(parser.isSet(splitDirectoriesOption));
+  if (splitModes > 0 && parser.isSet(appendOption)) {
+    standardError() << "--append 不能与分卷选项同时使用。" << Qt::endl;
+    return ExitUsageError;
+  }
+  if (splitModes > 1) {
+    standardError() << "--split-pages、--split-size 与 --split-dirs 只能选一个。"
+                    << Qt::endl;
+    return ExitUsageError;
+  }
+  if (parser.isSet(splitPagesOption)) {
+    bool valid = false;
+    defaults.options.split = OutputSplit::ByPageCount;
+    defaults.options.splitPageCount =
+        parser.value(splitPagesOption).toInt(&valid);
+    if (!valid || defaults.options.splitPageCount <= 0) {
+      standardError() << "每卷页数必须是正整数。" << Qt::endl;
+      return ExitUsageError;
+    }
+  } else if (parser.isSet(splitSizeOption)) {
+    bool valid = false;
+    defaults.options.split = OutputSplit::ByInputSize;
+    const qint64 megabytes = parser.value(splitSizeOption).toLongLong(&valid);
+    if (!valid || megabytes <= 0) {
+      standardError() << "每卷大小必须是正整数 MB。" << Qt::endl;
+      return ExitUsageError;
+    }
+    defaults.options.splitBytes = megabytes * 1024 * 1024;
+  } else if (parser.isSet(splitDirectoriesOption)) {
+    defaults.options.split = OutputSplit::BySubdirectory;
+  }
+
+  if (!marginValid) {
+    standardError() << "边距必须是整数毫米。" << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!dpiValid || defaults.options.effectiveDpi < 0) {
+    standardError() << "有效分辨率必须是非负整数。" << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!flateLevelValid || defaults.options.flateLevel < 0 ||
+      defaults.options.flateLevel > 9) {
+    standardError() << "压缩级别必须是 0 到 9 的整数。" << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!readaheadValid || !readaheadSizeValid ||
+      defaults.options.readaheadFiles < 0 || readaheadMegabytes < 0) {
+    standardError() << "预读参数必须是非负整数。" << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!streamValid || streamMegabytes < 0) {
+    standardError() << "--stream-mb 必须是非负整数。" << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!parseResampleFilter(parser.value(resampleOption),
+                           &defaults.options.resampleFilter)) {
+    standardError() << "未知的重采样方式：" << parser.value(resampleOption)
+                    << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!parseBilevelMode(parser.value(bilevelOption),
+                        &defaults.options.bilevelMode)) {
+    standardError() << "未知的二值化方式：" << parser.value(bilevelOption)
+                    << Qt::endl;
+    return ExitUsageError;
+  }
+  if (!isKnownSortMode(defaults.sortMode)) {
+    standardError() << "未知的排序方式：" << defaults.sortMode << Qt::endl;
+    return ExitUsageError;
+  }
+
+  if (parser.isSet(watchOption)) {
+    if (defaults.options.outputFile.isEmpty()) {
+      standardError() << "监视模式需要用 --output 指定输出文件名。" << Qt::endl;
+      return ExitUsageError;
+    }
+    // 监视模式每批各自写一个新的 PDF，既不追加也不分卷。
+    if (parser.isSet(appendOption)) {
+      standardError() << "--append 不能与 --watch 同时使用。" << Qt::endl;
+      return ExitUsageError;
+    }
+    if (splitModes > 0) {
+      standardError() << "分卷选项不能与 --watch 同时使用。" << Qt::endl;
+      return ExitUsageError;
+    }
+    bool idleValid = false;
+    bool pagesValid = false;
+    bool settleValid = false;
+    HotFolderOptions watchOptions;
+    watchOptions.directoryPath = parser.value(watchOption);
+    watchOptions.includeSubdirectories = defaults.includeSubdirectories;
+    watchOptions.conversion = defaults.options;
+    watchOptions.idleSeconds = parser.value(watchIdleOption).toInt(&idleValid);
+    watchOptions.maxPages = parser.value(watchPagesOption).toInt(&pagesValid);
+    const double settleSeconds =
+        parser.value(watchSettleOption).toDouble(&settleValid);
+    watchOptions.includeExisting = parser.isSet(watchExistingOption);
+    if (!idleValid || !pagesValid || !settleValid ||
+        watchOptions.idleSeconds < 0 || watchOptions.maxPages < 0 ||
+        settleSeconds < 0) {
+      standardError() << "监视参数必须是非负数。" << Qt::endl;
+      return ExitUsageError;
+    }
+    watchOptions.settleMilliseconds =
+        static_cast<int>(std::round(settleSeconds * 1000));
+    return runWatchMode(watchOptions);
+  }
+
+  QList<CommandLineJob> jobs;
+  if (parser.isSet(jobOption)) {
+    QString error;
+    if (!loadJobFile(parser.value(jobOption), defaults, &jobs, &error)) {
+      standardError() << error << Qt::endl;
+      return ExitUsageError;
+    }
+  } else {
+    if (defaults.inputs.isEmpty() || defaults.options.outputFile.isEmpty()) {
+      standardError() << "需要同时指定 --input 与 --output，或使用 --job。"
+                      << Qt::endl;
+      return ExitUsageError;
+    }
+    jobs.append(defaults);
+  }
+
+  // 多个作业共用一份记录，按时间先后排在同一条时间线上。
+  std::unique_ptr<ConversionTrace> trace;
+  if (parser.isSet(traceOption))
+    trace = std::make_unique<ConversionTrace>();
+
+  int failedJobs = 0;
+  for (const CommandLineJob &job : jobs) {
+    if (!runJob(job, trace.get()))
+      ++failedJobs;
+  }
+
+  if (trace) {
+    const TraceSummary summary = trace->summary();
+    const double seconds = summary.elapsedNsecs / 1e9;
+    standardOutput() << "共 " << summary.pages << " 页，用时 "
+                     << QString::number(seconds, 'f', 2) << " 秒（"
+                     << QString::number(seconds > 0 ? summary.pages / seconds
+                                                    : 0.0,
+                                        'f', 1)
+                     << " 页/秒），峰值内存 "
+                     << QLocale().formattedDataSize(summary.peakRssBytes)
+                     << Qt::endl;
+    QString error;
+    if (!trace->writeChromeTrace(parser.value(traceOption), &error)) {
+      standardError() << "无法写入跟踪文件：" << error << Qt::endl;
+      return ExitJobFailed;
+    }
+  }
+  return failedJobs == 0 ? ExitSuccess : ExitJobFailed;
+}
@@ -0,0 +1,96 @@
+#include "contenthash.h"
+
+#include <cstring>
+
+namespace {
+constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+inline uint64_t rotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// XXH64 规范按小端读取；大端平台上逐字节拼装。
+inline uint64_t read64(const unsigned char *p) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+inline uint32_t read32(const unsigned char *p) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+inline uint64_t round(uint64_t accumulator, uint64_t input) {
+  accumulator += input * kPrime2;
+  accumulator = rotateLeft(accumulator, 31);
+  return accumulator * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+  accumulator ^= round(0, value);
+  return accumulator * kPrime1 + kPrime4;
+}
+} // namespace
+
+uint64_t xxHash64(const void *data, size_t length, uint64_t seed) {
+  const auto *p = static_cast<const unsigned char *>(data);
+  const unsigned char *const end = p + length;
+  uint64_t hash;
+
+  if (length >= 32) {
+    const unsigned char *const limit = end - 32;
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    do {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) +
+           rotateLeft(v4, 18);
+    hash = mergeRound(hash, v1);
+    hash = mergeRound(hash, v2);
+    hash = mergeRound(hash, v3);
+    hash = mergeRound(hash, v4);
+  } else {
+    hash = seed + kPrime5;
+  }
+
+  hash += static_cast<uint64_t>(length);
+
+  while (p + 8 <= end) {
+    hash ^= round(0, read64(p));
+    hash = rotateLeft(hash, 27) * kPrime1 + kPrime4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    hash ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+    hash = rotateLeft(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    hash ^= (*p) * kPrime5;
+    hash = rotateLeft(hash, 11) * kPrime1;
+    ++p;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
@@ -0,0 +1,248 @@
+#include "conversiontrace.h"
+
+#include <QHash>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVariantList>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace {
+constexpr double kMegabyte = 1024.0 * 1024.0;
+
+quint64 currentThreadId() {
+  return static_cast<quint64>(
+      reinterpret_cast<quintptr>(QThread::currentThreadId()));
+}
+
+QByteArray microseconds(qint64 nsecs) {
+  // Chrome 跟踪格式以微秒为单位，保留三位小数即纳秒精度。
+  return QByteArray::number(double(nsecs) / 1000.0, 'f', 3);
+}
+} // namespace
+
+const char *traceStageName(TraceStage stage) {
+  switch (stage) {
+  case TraceStage::Read:
+    return "read";
+  case TraceStage::Readahead:
+    return "readahead";
+  case TraceStage::Hash:
+    return "hash";
+  case TraceStage::Decode:
+    return "decode";
+  case TraceStage::Grayscale:
+    return "grayscale";
+  case TraceStage::Resample:
+    return "resample";
+  case TraceStage::Bilevel:
+    return "bilevel";
+  case TraceStage::Analyze:
+    return "analyze";
+  case TraceStage::Encode:
+    return "encode";
+  case TraceStage::Wait:
+    return "wait";
+  case TraceStage::Write:
+    return "write";
+  case TraceStage::Finish:
+    return "finish";
+  case TraceStage::Scan:
+    return "scan";
+  case TraceStage::IndexLoad:
+    return "index-load";
+  case TraceStage::IndexSave:
+    return "index-save";
+  case TraceStage::Count:
+    break;
+  }
+  return "unknown";
+}
+
+QVariantMap TraceSummary::toVariantMap() const {
+  QVariantMap map;
+  const double seconds = double(elapsedNsecs) / 1e9;
+  map.insert(QStringLiteral("pages"), pages);
+  map.insert(QStringLiteral("seconds"), seconds);
+  map.insert(QStringLiteral("pagesPerSecond"),
+             seconds > 0 ? pages / seconds : 0.0);
+  map.insert(QStringLiteral("inputBytes"), inputBytes);
+  map.insert(QStringLiteral("outputBytes"), outputBytes);
+  map.insert(QStringLiteral("inputMBps"),
+             seconds > 0 ? inputBytes / kMegabyte / seconds : 0.0);
+  map.insert(QStringLiteral("outputMBps"),
+             seconds > 0 ? outputBytes / kMegabyte / seconds : 0.0);
+  map.insert(QStringLiteral("peakRssBytes"), peakRssBytes);
+
+  // 各阶段按累计耗时从多到少排列，第一项即最可能的瓶颈。
+  std::vector<size_t> order;
+  for (size_t i = 0; i < stages.size(); ++i) {
+    if (stages[i].count > 0)
+      order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return stages[a].nsecs > stages[b].nsecs;
+  });
+  // 写入线程的等待只说明解码跟不上，后台的预读提示与其它阶段重叠，
+  // 两者都不算瓶颈本身。
+  const auto bottleneck =
+      std::find_if(order.begin(), order.end(), [](size_t i) {
+        const TraceStage stage = static_cast<TraceStage>(i);
+        return stage != TraceStage::Wait && stage != TraceStage::Readahead;
+      });
+  map.insert(QStringLiteral("bottleneck"),
+             bottleneck == order.end()
+                 ? QString()
+                 : QString::fromLatin1(
+                       traceStageName(static_cast<TraceStage>(*bottleneck))));
+
+  QVariantList stageList;
+  for (size_t i : order) {
+    QVariantMap stage;
+    stage.insert(QStringLiteral("name"),
+                 QString::fromLatin1(traceStageName(static_cast<TraceStage>(i))));
+    stage.insert(QStringLiteral("seconds"), double(stages[i].nsecs) / 1e9);
+    stage.insert(QStringLiteral("bytes"), stages[i].bytes);
+    stage.insert(QStringLiteral("count"), stages[i].count);
+    stageList.append(stage);
+  }
+  map.insert(QStringLiteral("stages"), stageList);
+  return map;
+}
+
+ConversionTrace::ConversionTrace()
+    : m_pages(0), m_inputBytes(0), m_outputBytes(0) {
+  m_clock.start();
+}
+
+qint64 ConversionTrace::now() const { return m_clock.nsecsElapsed(); }
+
+void ConversionTrace::record(TraceStage stage, int page, qint64 startNsecs,
+                             qint64 bytes) {
+  const qint64 end = now();
+  const TraceEvent event{stage, page, startNsecs, end - startNsecs, bytes,
+                         currentThreadId()};
+  QMutexLocker locker(&m_mutex);
+  m_events.push_back(event);
+}
+
+void ConversionTrace::addPages(int pages) {
+  QMutexLocker locker(&m_mutex);
+  m_pages += pages;
+}
+
+void ConversionTrace::addInputBytes(qint64 bytes) {
+  QMutexLocker locker(&m_mutex);
+  m_inputBytes += bytes;
+}
+
+void ConversionTrace::addOutputBytes(qint64 bytes) {
+  QMutexLocker locker(&m_mutex);
+  m_outputBytes += bytes;
+}
+
+TraceSummary ConversionTrace::summary() const {
+  TraceSummary summary;
+  summary.elapsedNsecs = now();
+  summary.peakRssBytes = peakResidentSetBytes();
+  QMutexLocker locker(&m_mutex);
+  summary.pages = m_pages;
+  summary.inputBytes = m_inputBytes;
+  summary.outputBytes = m_outputBytes;
+  for (const TraceEvent &event : m_events) {
+    TraceSummary::StageTotals &totals =
+        summary.stages[static_cast<size_t>(event.stage)];
+    totals.nsecs += event.durationNsecs;
+    totals.bytes += event.bytes;
+    ++totals.count;
+  }
+  return summary;
+}
+
+bool ConversionTrace::writeChromeTrace(const QString &filePath,
+                                       QString *error) const {
+  std::vector<TraceEvent> events;
+  {
+    QMutexLocker locker(&m_mutex);
+    events = m_events;
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent &a, const TraceEvent &b) {
+                     return a.startNsecs < b.startNsecs;
+                   });
+
+  // 线程按首次出现的顺序编号，比原始线程句柄易读。
+  QHash<quint64, int> threadNumbers;
+  for (const TraceEvent &event : events) {
+    if (!threadNumbers.contains(event.threadId))
+      threadNumbers.insert(event.threadId, int(threadNumbers.size()) + 1);
+  }
+
+  QByteArray json;
+  json.reserve(qsizetype(events.size()) * 128 + 1024);
+  json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+          "\"args\":{\"name\":\"images2pdf\"}}";
+  for (auto it = threadNumbers.cbegin(); it != threadNumbers.cend(); ++it) {
+    json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+    json += QByteArray::number(it.value());
+    json += ",\"args\":{\"name\":\"thread-";
+    json += QByteArray::number(it.value());
+    json += "\"}}";
+  }
+  for (const TraceEvent &event : events) {
+    json += ",\n{\"name\":\"";
+    json += traceStageName(event.stage);
+    json += "\",\"cat\":\"";
+    json += event.stage >= TraceStage::Scan ? "scan" : "convert";
+    json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+    json += QByteArray::number(threadNumbers.value(event.threadId));
+    json += ",\"ts\":";
+    json += microseconds(event.startNsecs);
+    json += ",\"dur\":";
+    json += microseconds(event.durationNsecs);
+    json += ",\"args\":{\"page\":";
+    json += QByteArray::number(event.page);
+    json += ",\"bytes\":";
+    json += QByteArray::number(event.bytes);
+    json += "}}";
+  }
+  json += "\n]}\n";
+
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() ||
+      !file.commit()) {
+    *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+qint64 peakResidentSetBytes() {
+#if defined(Q_OS_WIN)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return qint64(counters.PeakWorkingSetSize);
+  return 0;
+#elif defined(Q_OS_UNIX)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(Q_OS_DARWIN)
+  return qint64(usage.ru_maxrss);
+#else
+  // Linux 与 BSD 以 KB 为单位。
+  return qint64(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
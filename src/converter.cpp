@@ -0,0 +1,1109 @@
+#include "converter.h"
+#include "contenthash.h"
+#include "conversiontrace.h"
+#include "imageencoding.h"
+#include "inputfile.h"
+#include "pdfdocument.h"
+#include "pdfreader.h"
+#include "pixelops.h"
+#include "resampler.h"
+#include "stripreader.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QFuture>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QMarginsF>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPageLayout>
+#include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr int kOutputResolution = 300;
+
+struct PreparedPage {
+  QString fileName;
+  PdfImage image;
+  QRect targetRect;
+  bool passthrough = false;
+  bool resampled = false;
+  // 自动编码时的分类；baselineBytes 为固定编码的大小，未计算时为 -1。
+  bool analyzed = false;
+  PageClass pageClass = PageClass::Color;
+  qint64 baselineBytes = -1;
+  // 文件内容哈希；duplicate 为 true 时本页未解码，沿用更早页面的图像。
+  quint64 contentHash = 0;
+  bool hasContentHash = false;
+  bool duplicate = false;
+  // 编码后图像数据的哈希，用于识别不同文件中像素完全相同的图片。
+  quint64 pixelHash = 0;
+  bool hasPixelHash = false;
+  // 多帧文件（多页 TIFF、动画 GIF/WebP）第二帧起的各页，紧接本页写入。
+  std::vector<PreparedPage> frames;
+};
+
+struct WrittenImage {
+  int imageObject = 0;
+  QRect targetRect;
+  qint64 bytes = 0;
+};
+
+QRect placeImage(const QSize &imageSize, const QRect &pageRect,
+                 bool stretchToPage) {
+  if (stretchToPage)
+    return pageRect;
+  QSize size = imageSize;
+  size.scale(pageRect.size(), Qt::KeepAspectRatio);
+  const QPoint offset(pageRect.x() + (pageRect.width() - size.width()) / 2,
+                      pageRect.y() + (pageRect.height() - size.height()) / 2);
+  return QRect(offset, size);
+}
+
+// targetRect 以输出设备像素（kOutputResolution）为单位，换算成 dpi 下的像素数。
+QSize targetPixelSize(const QRect &targetRect, int dpi) {
+  if (dpi <= 0)
+    return QSize();
+  const double factor = static_cast<double>(dpi) / kOutputResolution;
+  return QSize(std::max(1, static_cast<int>(std::round(targetRect.width() *
+                                                       factor))),
+               std::max(1, static_cast<int>(std::round(targetRect.height() *
+                                                       factor))));
+}
+
+bool exceedsTarget(const QSize &imageSize, const QSize &limit) {
+  return !limit.isEmpty() && (imageSize.width() > limit.width() ||
+                              imageSize.height() > limit.height());
+}
+
+// 选出不小于 limit 的最小 1/2、1/4、1/8 缩小尺寸；JPEG 插件可以直接在 DCT
+// 域完成这类缩放，之后再由 resampleImage 精确缩放到目标尺寸。
+QSize reducedDecodeSize(const QSize &sourceSize, const QSize &limit) {
+  QSize best = sourceSize;
+  for (int factor = 2; factor <= 8; factor *= 2) {
+    const QSize candidate((sourceSize.width() + factor - 1) / factor,
+                          (sourceSize.height() + factor - 1) / factor);
+    if (candidate.width() < limit.width() ||
+        candidate.height() < limit.height())
+      break;
+    best = candidate;
+  }
+  return best;
+}
+
+qint64 decodedImageBytes(const QSize &size) {
+  return static_cast<qint64>(size.width()) * size.height() * 4;
+}
+
+// 分段读取超大图像，按存储方向的尺寸计算版面，边读边缩小到目标尺寸。
+// 原图分辨率放不进内存，没有设定有效分辨率时按版面的 300 dpi 缩小。
+QImage readInStrips(StripImageReader *strips, const QRect &pageRect,
+                    const ConversionOptions &options, PreparedPage *page) {
+  const QSize storedSize = strips->size();
+  const bool transposed = strips->transformation().testFlag(
+      QImageIOHandler::TransformationRotate90);
+  const QSize orientedSize = transposed ? storedSize.transposed() : storedSize;
+  page->targetRect = placeImage(orientedSize, pageRect, options.stretchToPage);
+  QSize limit = targetPixelSize(page->targetRect, options.effectiveDpi);
+  if (limit.isEmpty())
+    limit = page->targetRect.size();
+  QSize size(std::min(orientedSize.width(), limit.width()),
+             std::min(orientedSize.height(), limit.height()));
+  if (transposed)
+    size.transpose();
+  page->resampled = size != storedSize;
+  return strips->read(size);
+}
+
+// 同一任务内按文件内容认领解码工作：内容相同的页面只由序号最小的那页解码，
+// 其余页面在写入阶段直接引用已写出的图像对象。
+class ContentClaims {
+public:
+  // 返回 true 表示序号更小的页面已认领同一内容，本页可以跳过解码。
+  bool claim(quint64 hash, int index) {
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_firstIndex.constFind(hash);
+    if (it != m_firstIndex.constEnd() && it.value() < index)
+      return true;
+    m_firstIndex.insert(hash, index);
+    return false;
+  }
+
+private:
+  QMutex m_mutex;
+  QHash<quint64, int> m_firstIndex;
+};
+
+quint64 encodedImageHash(const PdfImage &image) {
+  const QByteArray header =
+      QByteArray::number(image.width) + 'x' + QByteArray::number(image.height) +
+      '/' + QByteArray::number(image.components) + '/' +
+      QByteArray::number(image.bitsPerComponent) + image.filter +
+      image.decodeParms + image.decodeArray + image.palette;
+  const quint64 seed =
+      xxHash64(header.constData(), static_cast<size_t>(header.size()));
+  return xxHash64(image.data.constData(),
+                  static_cast<size_t>(image.data.size()), seed);
+}
+
+QString describeEncoding(const PdfImage &image) {
+  const QString filter = image.filter == "DCTDecode" ? QStringLiteral("JPEG")
+                                                     : QStringLiteral("Flate");
+  if (!image.palette.isEmpty())
+    return QStringLiteral("%1 位索引色 %2")
+        .arg(image.bitsPerComponent)
+        .arg(filter);
+  if (image.components == 1)
+    return image.bitsPerComponent == 1
+               ? QStringLiteral("1 位黑白 %1").arg(filter)
+               : QStringLiteral("灰度 %1").arg(filter);
+  return QStringLiteral("%1 %2").arg(
+      image.components == 4 ? QStringLiteral("CMYK") : QStringLiteral("RGB"),
+      filter);
+}
+
+QString frameFileName(const QString &fileName, int frame) {
+  return QStringLiteral("%1（第 %2 页）").arg(fileName).arg(frame + 1);
+}
+
+// 多帧文件的各帧按文件哈希与帧号区分，内容相同的文件可以逐帧共用图像。
+quint64 frameContentHash(quint64 fileHash, int frame) {
+  const qint32 number = frame;
+  return xxHash64(&number, sizeof(number), fileHash);
+}
+
+// 解码之后的处理：灰度、缩小、二值化与编码。image 已按方向变换；placed 为
+// false 时按图像本身的尺寸计算版面与 limit。大图的重采样与 Flate 压缩在
+// workPool 上并行进行。
+void processDecodedImage(QImage image, const QRect &pageRect, bool placed,
+                         QSize limit, const ConversionOptions &options,
+                         int index, ConversionTrace *trace,
+                         QThreadPool *workPool, PreparedPage *page) {
+  const bool bilevel = options.bilevelMode != BilevelMode::Off;
+  if (options.convertToGrayscale || bilevel) {
+    TraceScope scope(trace, TraceStage::Grayscale, index);
+    image = grayscaleImage(image);
+    scope.setBytes(image.sizeInBytes());
+  }
+
+  if (!placed) {
+    page->targetRect =
+        placeImage(image.size(), pageRect, options.stretchToPage);
+    limit = targetPixelSize(page->targetRect, options.effectiveDpi);
+  }
+  if (exceedsTarget(image.size(), limit)) {
+    TraceScope scope(trace, TraceStage::Resample, index);
+    const QSize size(std::min(image.width(), limit.width()),
+                     std::min(image.height(), limit.height()));
+    image = resampleImage(image, size, options.resampleFilter, workPool);
+    page->resampled = true;
+    scope.setBytes(image.sizeInBytes());
+  }
+
+  if (bilevel) {
+    TraceScope scope(trace, TraceStage::Bilevel, index);
+    image = bilevelImage(image, options.bilevelMode);
+    scope.setBytes(image.sizeInBytes());
+  }
+
+  if (options.automaticEncoding && !bilevel) {
+    ImageAnalysis analysis;
+    {
+      TraceScope scope(trace, TraceStage::Analyze, index);
+      analysis = analyzeImage(image);
+      scope.setBytes(image.sizeInBytes());
+    }
+    {
+      TraceScope scope(trace, TraceStage::Encode, index);
+      page->image = encodeAnalyzedImage(image, analysis, options.flateLevel,
+                                        &page->pageClass, workPool);
+      scope.setBytes(page->image.data.size());
+    }
+    page->analyzed = true;
+    if (options.reportEncoding)
+      page->baselineBytes =
+          encodeDecodedImage(image, options.flateLevel, workPool).data.size();
+  } else {
+    TraceScope scope(trace, TraceStage::Encode, index);
+    page->image = encodeDecodedImage(image, options.flateLevel, workPool);
+    scope.setBytes(page->image.data.size());
+  }
+  if (options.pixelDeduplication && !page->image.isNull()) {
+    page->pixelHash = encodedImageHash(page->image);
+    page->hasPixelHash = true;
+  }
+}
+
+// 解码 reader 的当前帧并完成处理，结果写入 page；解码失败时 page->image
+// 为空。先从文件头取得尺寸，按解码后的方向计算版面与目标像素数；整幅解码
+// 所需的内存超过 streamingThresholdBytes（或 Qt 无法识别尺寸）时改为分段
+// 读取，峰值内存只有几个条带，与原图大小无关。
+void decodeFrame(QImageReader *reader, const QByteArray &fileData, int frame,
+                 bool allowStreaming, const QRect &pageRect,
+                 const ConversionOptions &options, int index,
+                 ConversionTrace *trace, QThreadPool *workPool,
+                 PreparedPage *page) {
+  const QSize sourceSize = reader->size();
+  const bool transposed =
+      reader->autoTransform() &&
+      reader->transformation().testFlag(
+          QImageIOHandler::TransformationRotate90);
+  QSize limit;
+  reader->setScaledSize(QSize());
+  if (sourceSize.isValid()) {
+    const QSize orientedSize =
+        transposed ? sourceSize.transposed() : sourceSize;
+    page->targetRect =
+        placeImage(orientedSize, pageRect, options.stretchToPage);
+    limit = targetPixelSize(page->targetRect, options.effectiveDpi);
+    if (exceedsTarget(orientedSize, limit) &&
+        reader->supportsOption(QImageIOHandler::ScaledSize)) {
+      const QSize reduced = reducedDecodeSize(
+          sourceSize, transposed ? limit.transposed() : limit);
+      if (reduced != sourceSize) {
+        reader->setScaledSize(reduced);
+        page->resampled = true;
+      }
+    }
+  }
+
+  QImage image;
+  bool streamed = false;
+  const QSize decodeSize =
+      reader->scaledSize().isValid() ? reader->scaledSize() : sourceSize;
+  if (allowStreaming && options.streamingThresholdBytes > 0 &&
+      !fileData.isEmpty() &&
+      (!sourceSize.isValid() ||
+       decodedImageBytes(decodeSize) > options.streamingThresholdBytes)) {
+    StripImageReader strips(fileData, frame);
+    if (strips.open() && decodedImageBytes(strips.size()) >
+                             options.streamingThresholdBytes) {
+      TraceScope scope(trace, TraceStage::Decode, index);
+      image = readInStrips(&strips, pageRect, options, page);
+      scope.setBytes(image.sizeInBytes());
+      streamed = true;
+    }
+  }
+  if (!streamed) {
+    TraceScope scope(trace, TraceStage::Decode, index);
+    image = reader->read();
+    scope.setBytes(image.sizeInBytes());
+  }
+  if (image.isNull())
+    return;
+  processDecodedImage(std::move(image), pageRect,
+                      sourceSize.isValid() || streamed, limit, options, index,
+                      trace, workPool, page);
+}
+
+PreparedPage preparePage(const QString &path, int index,
+                         const QRect &pageRect,
+                         const ConversionOptions &options,
+                         bool mayHaveDuplicate, ContentClaims *claims,
+                         ConversionTrace *trace, QThreadPool *workPool) {
+  PreparedPage page;
+  page.fileName = QFileInfo(path).fileName();
+
+  // 文件映射到内存后，哈希、JPEG 直通与解码都直接读取映射区域，不再复制。
+  // 映射本身几乎不花时间，实际的磁盘读取发生在首次访问时（通常是解码），
+  // 预读提示已经把数据读进页缓存时这部分等待就会消失。
+  const bool bilevelOff = options.bilevelMode == BilevelMode::Off;
+  const bool tryJpeg = options.jpegPassthrough && bilevelOff;
+  const bool tryPng = options.pngPassthrough && bilevelOff;
+  const bool hashContent = options.deduplicateImages && mayHaveDuplicate;
+  MappedInputFile input(path);
+  QByteArray fileData;
+  {
+    TraceScope scope(trace, TraceStage::Read, index);
+    if (input.open())
+      fileData = input.data();
+    scope.setBytes(fileData.size());
+  }
+  if (trace && !fileData.isEmpty())
+    trace->addInputBytes(fileData.size());
+
+  if (hashContent && !fileData.isEmpty()) {
+    TraceScope scope(trace, TraceStage::Hash, index);
+    scope.setBytes(fileData.size());
+    page.contentHash =
+        xxHash64(fileData.constData(), static_cast<size_t>(fileData.size()),
+                 static_cast<quint64>(fileData.size()));
+    page.hasContentHash = true;
+    if (claims->claim(page.contentHash, index)) {
+      page.duplicate = true;
+      return page;
+    }
+  }
+
+  if ((tryJpeg || tryPng) && !fileData.isEmpty()) {
+    PdfImage original =
+        tryJpeg ? jpegPassthroughImage(fileData, options.convertToGrayscale)
+                : PdfImage();
+    if (original.isNull() && tryPng)
+      original = pngPassthroughImage(fileData, options.convertToGrayscale);
+    if (!original.isNull()) {
+      const QSize originalSize(original.width, original.height);
+      const QRect targetRect =
+          placeImage(originalSize, pageRect, options.stretchToPage);
+      // 超出有效分辨率的 JPEG 需要解码后缩小，不能原样嵌入。
+      if (!exceedsTarget(originalSize,
+                         targetPixelSize(targetRect, options.effectiveDpi))) {
+        // 映射在本函数返回时解除；仍指向映射区域的数据（JPEG）在这里
+        // 复制出来，PNG 拼接好的 IDAT 本来就是独立的副本，detach 不做事。
+        original.data.detach();
+        page.image = std::move(original);
+        page.targetRect = targetRect;
+        page.passthrough = true;
+        return page;
+      }
+    }
+  }
+
+  QBuffer buffer(&fileData);
+  QImageReader reader;
+  if (fileData.isEmpty()) {
+    reader.setFileName(path);
+  } else if (buffer.open(QIODevice::ReadOnly)) {
+    reader.setDevice(&buffer);
+  }
+
+  // 动画格式（GIF、WebP）每次 read() 自动前进一帧，分段读取无法跟随，
+  // 只用于按页跳转的格式（多页 TIFF）。
+  const bool animated = reader.supportsAnimation();
+  decodeFrame(&reader, fileData, 0, !animated, pageRect, options, index, trace,
+              workPool, &page);
+  // 未整体读入内存的文件由 QImageReader 自己打开，解码后按文件大小计入。
+  if (trace && fileData.isEmpty() && reader.device())
+    trace->addInputBytes(reader.device()->size());
+
+  // 多页 TIFF 与动画 GIF/WebP 的其余各帧依次解码为后续页面，尺寸、缩小
+  // 解码与分段读取的判断都与第一帧相同；每帧编码后即释放，同一时刻只保留
+  // 一帧解码后的图像。无法定位或解码的帧照常记入 failedFiles。
+  const int frameCount = reader.imageCount();
+  for (int frame = 1; frame < frameCount; ++frame) {
+    PreparedPage next;
+    next.fileName = frameFileName(page.fileName, frame);
+    if (page.hasContentHash) {
+      next.contentHash = frameContentHash(page.contentHash, frame);
+      next.hasContentHash = true;
+    }
+    if (animated || reader.jumpToImage(frame))
+      decodeFrame(&reader, fileData, frame, !animated, pageRect, options,
+                  index, trace, workPool, &next);
+    page.frames.push_back(std::move(next));
+  }
+  return page;
+}
+
+// 版面仍按 300 dpi 的设备像素计算，写入时再换算为 PDF 的点。
+bool computePageGeometry(const ConversionOptions &options,
+                         PageGeometry *geometry) {
+  const int marginMillimeters = std::clamp(options.marginMillimeters, 0, 50);
+  const QPageLayout baseLayout(options.pageSize,
+                               options.landscapeOrientation
+                                   ? QPageLayout::Landscape
+                                   : QPageLayout::Portrait,
+                               QMarginsF(0, 0, 0, 0), QPageLayout::Millimeter);
+  const QSize pagePixels = baseLayout.fullRectPixels(kOutputResolution).size();
+  const double pixelsPerMillimeter = kOutputResolution / 25.4;
+  const int marginPixels = std::clamp(
+      static_cast<int>(std::round(marginMillimeters * pixelsPerMillimeter)), 0,
+      std::numeric_limits<int>::max());
+  const int usableWidth = pagePixels.width() - marginPixels * 2;
+  const int usableHeight = pagePixels.height() - marginPixels * 2;
+  if (usableWidth <= 0 || usableHeight <= 0)
+    return false;
+  geometry->pageSizePoints = baseLayout.fullRect(QPageLayout::Point).size();
+  geometry->pageRect =
+      QRect(marginPixels, marginPixels, usableWidth, usableHeight);
+  geometry->pointsPerPixel = 72.0 / kOutputResolution;
+  return true;
+}
+
+// 写入阶段：按顺序把准备好的页面交给 PdfDocument，内容或像素相同的页面
+// 引用已写出的图像对象。只在写入线程中使用。
+class PageWriter {
+public:
+  PageWriter(PdfDocument *document, const PageGeometry &geometry,
+             ConversionTrace *trace)
+      : m_document(document), m_geometry(geometry), m_trace(trace) {}
+
+  // 写入一个文件的全部页面。无法解码的页面记入 failedFiles；只有 PDF
+  // 写入失败时返回 false。
+  bool write(const PreparedPage &page, int index, ConversionResult *result) {
+    if (!writePage(page, index, result))
+      return false;
+    for (const PreparedPage &frame : page.frames) {
+      if (!writePage(frame, index, result))
+        return false;
+    }
+    if (page.duplicate) {
+      // 重复的多帧文件没有解码，其余各帧沿用较早文件对应帧的图像。
+      const int frameCount = m_frameCounts.value(page.contentHash, 1);
+      for (int frame = 1; frame < frameCount; ++frame) {
+        PreparedPage copy;
+        copy.fileName = frameFileName(page.fileName, frame);
+        copy.contentHash = frameContentHash(page.contentHash, frame);
+        copy.hasContentHash = true;
+        copy.duplicate = true;
+        if (!writePage(copy, index, result))
+          return false;
+      }
+    } else if (page.hasContentHash && !page.frames.empty()) {
+      m_frameCounts.insert(page.contentHash,
+                           1 + static_cast<int>(page.frames.size()));
+    }
+    return true;
+  }
+
+private:
+  bool writePage(const PreparedPage &page, int index,
+                 ConversionResult *result) {
+    WrittenImage written;
+    bool reused = false;
+    if (page.hasContentHash) {
+      const auto it = m_writtenByContent.constFind(page.contentHash);
+      if (it != m_writtenByContent.constEnd()) {
+        written = it.value();
+        reused = true;
+      }
+    }
+    if (!reused && page.hasPixelHash) {
+      const auto it = m_writtenByPixels.constFind(page.pixelHash);
+      if (it != m_writtenByPixels.constEnd()) {
+        written = it.value();
+        written.targetRect = page.targetRect;
+        reused = true;
+      }
+    }
+
+    if (!reused && page.image.isNull()) {
+      if (page.hasContentHash)
+        m_writtenByContent.insert(page.contentHash, WrittenImage());
+      result->failedFiles << page.fileName;
+      return true;
+    }
+    if (reused && written.imageObject == 0) {
+      // 内容相同的较早页面解码失败，本页同样无法写入。
+      result->failedFiles << page.fileName;
+      return true;
+    }
+
+    TraceScope writeScope(m_trace, TraceStage::Write, index);
+    const qint64 bytesBefore = m_document->bytesWritten();
+    if (!reused) {
+      written.imageObject = m_document->addImage(page.image);
+      written.targetRect = page.targetRect;
+      written.bytes = page.image.data.size();
+      if (written.imageObject == 0)
+        return false;
+      if (page.hasContentHash)
+        m_writtenByContent.insert(page.contentHash, written);
+      if (page.hasPixelHash)
+        m_writtenByPixels.insert(page.pixelHash, written);
+    }
+
+    const double pointsPerPixel = m_geometry.pointsPerPixel;
+    const QRect &rect = written.targetRect;
+    const QRectF targetPoints(rect.x() * pointsPerPixel,
+                              rect.y() * pointsPerPixel,
+                              rect.width() * pointsPerPixel,
+                              rect.height() * pointsPerPixel);
+    if (!m_document->addPage(m_geometry.pageSizePoints, targetPoints,
+                             written.imageObject))
+      return false;
+    writeScope.setBytes(m_document->bytesWritten() - bytesBefore);
+    ++result->convertedPages;
+    if (reused) {
+      ++result->deduplicatedPages;
+      result->deduplicatedBytes += written.bytes;
+    } else {
+      if (page.passthrough)
+        ++result->passthroughPages;
+      if (page.resampled)
+        ++result->resampledPages;
+      if (page.analyzed)
+        recordEncoding(page, result);
+    }
+    return true;
+  }
+
+  static void recordEncoding(const PreparedPage &page,
+                             ConversionResult *result) {
+    ++result->pagesByClass[static_cast<size_t>(page.pageClass)];
+    PageEncodingRecord record;
+    record.fileName = page.fileName;
+    record.pageClass = page.pageClass;
+    record.encoding = describeEncoding(page.image);
+    record.bytes = page.image.data.size();
+    record.baselineBytes = page.baselineBytes;
+    if (record.baselineBytes >= 0)
+      result->encodingSavedBytes += record.baselineBytes - record.bytes;
+    result->encodingRecords.append(record);
+  }
+
+  PdfDocument *m_document;
+  PageGeometry m_geometry;
+  ConversionTrace *m_trace;
+  // 已写出的图像；文件内容失败的记录为 imageObject == 0。
+  QHash<quint64, WrittenImage> m_writtenByContent;
+  QHash<quint64, WrittenImage> m_writtenByPixels;
+  // 多帧文件的帧数，按文件内容哈希记录。
+  QHash<quint64, int> m_frameCounts;
+};
+
+// 补写页面树并提交文件，同时把页数与输出大小计入 trace。
+void finishDocument(PdfDocument *document, const QString &outputFile,
+                    ConversionTrace *trace, ConversionResult *result) {
+  if (result->convertedPages == 0) {
+    result->errorText = QStringLiteral("没有任何图片被写入。");
+    return;
+  }
+
+  {
+    TraceScope scope(trace, TraceStage::Finish);
+    const qint64 bytesBefore = document->bytesWritten();
+    result->success = document->finish();
+    scope.setBytes(document->bytesWritten() - bytesBefore);
+  }
+  if (trace) {
+    trace->addPages(result->convertedPages);
+    trace->addOutputBytes(document->bytesWritten());
+  }
+  if (!result->success) {
+    result->errorText = QStringLiteral("无法写入 PDF 文件。");
+    return;
+  }
+  result->outputFiles << outputFile;
+}
+
+// 分卷文件名中卷号前后的部分（不含目录）与卷号的格式。
+struct VolumeNamePattern {
+  QString prefix;
+  QString suffix;
+  int width = 3;
+  QChar fill = QLatin1Char('0');
+};
+
+// 替换 %d / %03d 占位符，没有占位符时在扩展名前追加 -001 这样的编号。
+VolumeNamePattern volumeNamePattern(const QFileInfo &info) {
+  static const QRegularExpression placeholder(QStringLiteral("%(0?)(\\d*)d"));
+  const QString name = info.fileName();
+  const QRegularExpressionMatch match = placeholder.match(name);
+  VolumeNamePattern pattern;
+  if (match.hasMatch()) {
+    pattern.prefix = name.left(match.capturedStart());
+    pattern.suffix = name.mid(match.capturedEnd());
+    pattern.width = match.captured(2).toInt();
+    pattern.fill = match.captured(1).isEmpty() ? QLatin1Char(' ')
+                                               : QLatin1Char('0');
+  } else {
+    const QString suffix = info.suffix();
+    pattern.prefix =
+        (suffix.isEmpty() ? name : name.left(name.size() - suffix.size() - 1)) +
+        QLatin1Char('-');
+    if (!suffix.isEmpty())
+      pattern.suffix = QLatin1Char('.') + suffix;
+  }
+  return pattern;
+}
+
+QString volumeFileName(const QString &pattern, int number) {
+  const QFileInfo info(pattern);
+  const VolumeNamePattern parts = volumeNamePattern(info);
+  return info.dir().filePath(
+      parts.prefix +
+      QStringLiteral("%1").arg(number, parts.width, 10, parts.fill) +
+      parts.suffix);
+}
+
+// 比较输出路径用的键：绝对路径，大小写不敏感的文件系统上再统一大小写。
+QString outputPathKey(const QString &path) {
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+  return path.toCaseFolded();
+#else
+  return path;
+#endif
+}
+
+// name 是否为按 outputs 的卷名格式生成的某一卷。
+bool isVolumeName(const PlannedOutputs &outputs, const QString &name) {
+  const qsizetype affixes =
+      outputs.volumePrefix.size() + outputs.volumeSuffix.size();
+  if (!outputs.mayBeSplit || name.size() <= affixes ||
+      !name.startsWith(outputs.volumePrefix) ||
+      !name.endsWith(outputs.volumeSuffix))
+    return false;
+  bool ok = false;
+  const int number = name.mid(outputs.volumePrefix.size(), name.size() - affixes)
+                         .trimmed()
+                         .toInt(&ok);
+  return ok && number >= 1;
+}
+
+QString parentDirectory(const QString &path) {
+  const qsizetype slash = path.lastIndexOf(QLatin1Char('/'));
+  return slash < 0 ? QString() : path.left(slash);
+}
+} // namespace
+
+PlannedOutputs plannedOutputs(const ConversionOptions &options,
+                              int fileCount) {
+  const QFileInfo info(options.outputFile);
+  const QString directory = QDir::cleanPath(info.absolutePath());
+  PlannedOutputs outputs;
+  outputs.single = outputPathKey(QDir::cleanPath(info.absoluteFilePath()));
+  // 与 planVolumes 相同：追加时不分卷，按页数分卷时卷数可以直接算出；
+  // 按大小或目录分卷时卷数要看文件，这里按可能分卷处理。
+  switch (options.appendToExisting ? OutputSplit::None : options.split) {
+  case OutputSplit::None:
+    break;
+  case OutputSplit::ByPageCount:
+    outputs.mayBeSplit = fileCount > std::max(1, options.splitPageCount);
+    break;
+  case OutputSplit::ByInputSize:
+  case OutputSplit::BySubdirectory:
+    outputs.mayBeSplit = fileCount > 1;
+    break;
+  }
+  if (outputs.mayBeSplit) {
+    const VolumeNamePattern pattern = volumeNamePattern(info);
+    outputs.volumePrefix =
+        outputPathKey(directory + QLatin1Char('/') + pattern.prefix);
+    outputs.volumeSuffix = outputPathKey(pattern.suffix);
+  }
+  return outputs;
+}
+
+bool outputsOverlap(const PlannedOutputs &a, const PlannedOutputs &b) {
+  if (a.single == b.single || isVolumeName(a, b.single) ||
+      isVolumeName(b, a.single))
+    return true;
+  if (!a.mayBeSplit || !b.mayBeSplit)
+    return false;
+  // 两边的卷号都可能任意大：前缀与后缀互相包含时就可能生成同一个文件名。
+  const auto nested = [](const QString &x, const QString &y, bool atStart) {
+    return atStart ? x.startsWith(y) || y.startsWith(x)
+                   : x.endsWith(y) || y.endsWith(x);
+  };
+  return nested(a.volumePrefix, b.volumePrefix, true) &&
+         nested(a.volumeSuffix, b.volumeSuffix, false);
+}
+
+PdfConverter::PdfConverter(QStringList files, ConversionOptions options,
+                           QObject *parent)
+    : QObject(parent), m_files(std::move(files)), m_trace(nullptr),
+      m_options(std::move(options)), m_cancelRequested(false),
+      m_pagesDone(0) {}
+
+void PdfConverter::setKnownFileSizes(QList<qint64> sizes) {
+  m_knownSizes = std::move(sizes);
+}
+
+void PdfConverter::setTrace(ConversionTrace *trace) { m_trace = trace; }
+
+void PdfConverter::cancel() {
+  m_cancelRequested.store(true, std::memory_order_relaxed);
+}
+
+QList<OutputVolume> PdfConverter::planVolumes() const {
+  const int totalFiles = m_files.size();
+  const bool hasKnownSizes = m_knownSizes.size() == totalFiles;
+  const auto fileSize = [&](int index) -> qint64 {
+    const qint64 known = hasKnownSizes ? m_knownSizes.at(index) : -1;
+    return known >= 0 ? known : QFileInfo(m_files.at(index)).size();
+  };
+
+  // 先按选项找出每卷的起点，再统一命名。
+  std::vector<int> starts = {0};
+  int pagesInVolume = 0;
+  qint64 bytesInVolume = 0;
+  for (int i = 0; i < totalFiles; ++i) {
+    bool startsVolume = false;
+    const OutputSplit split =
+        m_options.appendToExisting ? OutputSplit::None : m_options.split;
+    switch (split) {
+    case OutputSplit::None:
+      break;
+    case OutputSplit::ByPageCount:
+      startsVolume = pagesInVolume >= std::max(1, m_options.splitPageCount);
+      break;
+    case OutputSplit::ByInputSize: {
+      // 输出大小无法事先知道，以输入大小估计：JPEG 原样嵌入时两者相当。
+      const qint64 size = fileSize(i);
+      const qint64 limit = std::max<qint64>(1, m_options.splitBytes);
+      startsVolume = pagesInVolume > 0 && bytesInVolume + size > limit;
+      bytesInVolume = startsVolume ? size : bytesInVolume + size;
+      break;
+    }
+    case OutputSplit::BySubdirectory:
+      startsVolume = i > 0 && parentDirectory(m_files.at(i)) !=
+                                  parentDirectory(m_files.at(i - 1));
+      break;
+    }
+    if (startsVolume && i > 0) {
+      starts.push_back(i);
+      pagesInVolume = 0;
+    }
+    ++pagesInVolume;
+  }
+
+  QList<OutputVolume> volumes;
+  for (size_t v = 0; v < starts.size(); ++v) {
+    OutputVolume volume;
+    volume.firstFile = starts[v];
+    volume.fileCount =
+        (v + 1 < starts.size() ? starts[v + 1] : totalFiles) - starts[v];
+    volume.outputFile =
+        starts.size() == 1
+            ? m_options.outputFile
+            : volumeFileName(m_options.outputFile, static_cast<int>(v) + 1);
+    volumes.append(volume);
+  }
+  return volumes;
+}
+
+ConversionResult PdfConverter::run() {
+  ConversionResult result;
+
+  PageGeometry geometry;
+  if (!computePageGeometry(m_options, &geometry)) {
+    result.errorText = QStringLiteral("边距过大，无法绘制内容。");
+    return result;
+  }
+
+  m_pagesDone.store(0, std::memory_order_relaxed);
+  const QList<OutputVolume> volumes = planVolumes();
+  const int threads = m_options.decodeThreads > 0
+                          ? m_options.decodeThreads
+                          : std::max(1, QThread::idealThreadCount());
+  if (volumes.size() == 1)
+    return runVolume(volumes.first(), geometry, threads, nullptr);
+
+  // 每卷占一个写入线程，解码线程在同时进行的各卷之间平分；
+  // 卷数多于并发数时，先完成的卷让出位置给后面的卷。
+  const int concurrentVolumes =
+      std::min<int>(volumes.size(), std::max(1, threads / 2));
+  const int decodeThreads = std::max(1, threads / concurrentVolumes);
+  std::atomic_bool abort(false);
+  QThreadPool volumePool;
+  volumePool.setMaxThreadCount(concurrentVolumes);
+  QList<QFuture<ConversionResult>> futures;
+  for (const OutputVolume &volume : volumes) {
+    futures.append(QtConcurrent::run(&volumePool, [&, volume]() {
+      ConversionResult volumeResult =
+          runVolume(volume, geometry, decodeThreads, &abort);
+      // 任何一卷失败都没有必要继续写其余各卷。
+      if (!volumeResult.success)
+        abort.store(true, std::memory_order_relaxed);
+      return volumeResult;
+    }));
+  }
+
+  // 已经写完的卷即使整体失败也会保留，失败或中止的卷不会留下文件。
+  result.success = true;
+  for (int v = 0; v < futures.size(); ++v) {
+    const ConversionResult volumeResult = futures[v].result();
+    result.convertedPages += volumeResult.convertedPages;
+    result.passthroughPages += volumeResult.passthroughPages;
+    result.resampledPages += volumeResult.resampledPages;
+    result.deduplicatedPages += volumeResult.deduplicatedPages;
+    result.deduplicatedBytes += volumeResult.deduplicatedBytes;
+    for (size_t c = 0; c < result.pagesByClass.size(); ++c)
+      result.pagesByClass[c] += volumeResult.pagesByClass[c];
+    result.encodingRecords << volumeResult.encodingRecords;
+    result.encodingSavedBytes += volumeResult.encodingSavedBytes;
+    result.failedFiles << volumeResult.failedFiles;
+    result.outputFiles << volumeResult.outputFiles;
+    if (volumeResult.success)
+      continue;
+    result.success = false;
+    // 因别的卷失败而中止的卷不报告错误，只保留真正失败的原因。
+    if (!volumeResult.cancelled && result.errorText.isEmpty())
+      result.errorText = QStringLiteral("%1：%2")
+                             .arg(QFileInfo(volumes[v].outputFile).fileName(),
+                                  volumeResult.errorText);
+  }
+  if (m_cancelRequested.load(std::memory_order_relaxed)) {
+    result.success = false;
+    result.cancelled = true;
+    result.errorText = QStringLiteral("转换已取消。");
+  }
+  return result;
+}
+
+ConversionResult PdfConverter::runVolume(const OutputVolume &volume,
+                                         const PageGeometry &geometry,
+                                         int decodeThreads,
+                                         const std::atomic_bool *abort) {
+  ConversionResult result;
+  const QRect pageRect = geometry.pageRect;
+
+  PdfDocument document(volume.outputFile);
+  if (m_options.appendToExisting && QFileInfo::exists(volume.outputFile)) {
+    PdfAppendBase base;
+    QString error;
+    if (!readPdfAppendBase(volume.outputFile, &base, &error)) {
+      result.errorText = QStringLiteral("无法读取现有 PDF：%1").arg(error);
+      return result;
+    }
+    if (!document.openForAppend(base)) {
+      result.errorText = QStringLiteral("无法打开现有 PDF：%1")
+                             .arg(document.errorString());
+      return result;
+    }
+    result.existingPages = base.pageCount;
+  } else if (!document.open()) {
+    result.errorText = QStringLiteral("无法创建 PDF 文件。");
+    return result;
+  }
+
+  // 认领表与 workPool 须比解码线程池活得更久，所以先于 decodePool 声明。
+  ContentClaims claims;
+  // 解码线程里大图的重采样与分块压缩交给 workPool，线程数与解码相同：
+  // 等待它们的解码线程并不占用核心，整个任务用到的核心不超过分到的线程数。
+  QThreadPool workPool;
+  workPool.setMaxThreadCount(decodeThreads);
+  // 解码使用独立线程池，写入线程本身占用的全局线程池不会被解码任务挤占。
+  QThreadPool decodePool;
+  decodePool.setMaxThreadCount(decodeThreads);
+  const int window = m_options.maxPagesInFlight > 0
+                         ? m_options.maxPagesInFlight
+                         : decodePool.maxThreadCount() * 2;
+
+  // 文件序号（index）在整个任务中唯一，i 是本卷内的序号。
+  const int firstFile = volume.firstFile;
+  const int totalFiles = volume.fileCount;
+  const int allFiles = m_files.size();
+
+  // 已知大小且大小唯一的文件跳过内容哈希；未知大小的一律按可能重复处理。
+  // 各卷是独立的文件，去重只在卷内进行。
+  std::vector<bool> mayHaveDuplicate(totalFiles, true);
+  if (m_options.deduplicateImages && m_knownSizes.size() == allFiles) {
+    QHash<qint64, int> sizeCounts;
+    for (int i = 0; i < totalFiles; ++i) {
+      const qint64 size = m_knownSizes.at(firstFile + i);
+      if (size >= 0)
+        ++sizeCounts[size];
+    }
+    for (int i = 0; i < totalFiles; ++i) {
+      const qint64 size = m_knownSizes.at(firstFile + i);
+      mayHaveDuplicate[i] = size < 0 || sizeCounts.value(size) > 1;
+    }
+  }
+
+  // 文件交给解码线程时，为它之后的文件发出预读提示。
+  InputReadahead readahead(m_files, firstFile, totalFiles,
+                           m_options.readaheadFiles, m_options.readaheadBytes,
+                           m_trace);
+  std::deque<QFuture<PreparedPage>> inFlight;
+  int nextToSubmit = 0;
+
+  auto fillWindow = [&]() {
+    while (nextToSubmit < totalFiles &&
+           static_cast<int>(inFlight.size()) < window) {
+      const int index = firstFile + nextToSubmit;
+      const bool mayDuplicate = mayHaveDuplicate[nextToSubmit];
+      ++nextToSubmit;
+      readahead.advance(index);
+      const QString path = m_files.at(index);
+      inFlight.push_back(QtConcurrent::run(
+          &decodePool,
+          [this, path, index, pageRect, mayDuplicate, claims = &claims,
+           workPool = &workPool]() {
+            return preparePage(path, index, pageRect, m_options, mayDuplicate,
+                               claims, m_trace, workPool);
+          }));
+    }
+  };
+
+  PageWriter writer(&document, geometry, m_trace);
+  // 进度按全部卷合计，分卷同时写入时也单调地推进到总页数。
+  const auto reportProgress = [&](const QString &fileName) {
+    const int done = m_pagesDone.fetch_add(1, std::memory_order_relaxed);
+    emit pageProcessed(done, allFiles, fileName);
+  };
+
+  fillWindow();
+  for (int i = 0; i < totalFiles; ++i) {
+    if (m_cancelRequested.load(std::memory_order_relaxed) ||
+        (abort && abort->load(std::memory_order_relaxed))) {
+      result.cancelled = true;
+      break;
+    }
+
+    PreparedPage page;
+    {
+      // 写入线程在这里等得越久，说明解码越跟不上。
+      TraceScope scope(m_trace, TraceStage::Wait, firstFile + i);
+      page = inFlight.front().result();
+    }
+    inFlight.pop_front();
+    fillWindow();
+
+    if (!writer.write(page, firstFile + i, &result)) {
+      result.errorText = QStringLiteral("无法创建 PDF 页面。");
+      return result;
+    }
+    reportProgress(page.fileName);
+  }
+
+  // 取消时仍在解码的页面会在 decodePool 析构时等待结束；
+  // 未提交的输出文件由 QSaveFile 自动丢弃。
+  if (result.cancelled) {
+    result.errorText = QStringLiteral("转换已取消。");
+    return result;
+  }
+
+  finishDocument(&document, volume.outputFile, m_trace, &result);
+  return result;
+}
+
+// 成员的声明顺序即析构的逆序：写入线程先结束，再等解码线程，
+// 最后才析构它们引用的认领表与文档。
+struct IncrementalPdfWriter::State {
+  explicit State(const QString &outputFile) : document(outputFile) {}
+
+  PdfDocument document;
+  PageGeometry geometry;
+  std::unique_ptr<PageWriter> writer;
+  ContentClaims claims;
+  QMutex mutex;
+  // 已追加但尚未提交解码的文件，以及下一页的序号。
+  std::deque<QString> pending;
+  int nextIndex = 0;
+  bool writerRunning = false;
+  bool writeFailed = false;
+  std::atomic_bool abandon{false};
+  ConversionResult result;
+  // 与 runVolume 相同，重采样与分块压缩在 workPool 上进行。
+  QThreadPool workPool;
+  QThreadPool decodePool;
+  QThreadPool writerPool;
+};
+
+IncrementalPdfWriter::IncrementalPdfWriter(ConversionOptions options)
+    : m_options(std::move(options)), m_trace(nullptr), m_appended(0) {}
+
+IncrementalPdfWriter::~IncrementalPdfWriter() {
+  if (m_state)
+    m_state->abandon.store(true, std::memory_order_relaxed);
+}
+
+void IncrementalPdfWriter::setTrace(ConversionTrace *trace) {
+  m_trace = trace;
+}
+
+bool IncrementalPdfWriter::open(QString *error) {
+  m_state = std::make_unique<State>(m_options.outputFile);
+  if (!computePageGeometry(m_options, &m_state->geometry)) {
+    *error = QStringLiteral("边距过大，无法绘制内容。");
+    m_state.reset();
+    return false;
+  }
+  if (!m_state->document.open()) {
+    *error = QStringLiteral("无法创建 PDF 文件。");
+    m_state.reset();
+    return false;
+  }
+  m_state->writer = std::make_unique<PageWriter>(&m_state->document,
+                                                 m_state->geometry, m_trace);
+  m_state->decodePool.setMaxThreadCount(
+      m_options.decodeThreads > 0 ? m_options.decodeThreads
+                                  : std::max(1, QThread::idealThreadCount()));
+  m_state->workPool.setMaxThreadCount(m_state->decodePool.maxThreadCount());
+  m_state->writerPool.setMaxThreadCount(1);
+  return true;
+}
+
+void IncrementalPdfWriter::append(const QStringList &files) {
+  if (!m_state || files.isEmpty())
+    return;
+  m_appended += files.size();
+  QMutexLocker locker(&m_state->mutex);
+  m_state->pending.insert(m_state->pending.end(), files.cbegin(),
+                          files.cend());
+  // 写入线程在队列取空后退出，有新文件时再启动一个。
+  if (!m_state->writerRunning) {
+    m_state->writerRunning = true;
+    m_state->writerPool.start([this]() { writeLoop(); });
+  }
+}
+
+int IncrementalPdfWriter::appendedCount() const { return m_appended; }
+
+// 与 PdfConverter::runVolume 相同的窗口：解码中的页面不超过线程数的两倍，
+// 一次追加大量文件时内存占用也有上限。
+void IncrementalPdfWriter::writeLoop() {
+  State &state = *m_state;
+  const int window = m_options.maxPagesInFlight > 0
+                         ? m_options.maxPagesInFlight
+                         : state.decodePool.maxThreadCount() * 2;
+  const QRect pageRect = state.geometry.pageRect;
+  std::deque<std::pair<int, QFuture<PreparedPage>>> inFlight;
+  for (;;) {
+    {
+      QMutexLocker locker(&state.mutex);
+      while (!state.pending.empty() &&
+             static_cast<int>(inFlight.size()) < window &&
+             !state.abandon.load(std::memory_order_relaxed)) {
+        const QString path = state.pending.front();
+        state.pending.pop_front();
+        const int index = state.nextIndex++;
+        // 文件陆续到达，无法事先按大小排除重复，开启去重时一律求哈希。
+        inFlight.emplace_back(
+            index, QtConcurrent::run(&state.decodePool, [this, path, index,
+                                                         pageRect,
+                                                         &state]() {
+              return preparePage(path, index, pageRect, m_options, true,
+                                 &state.claims, m_trace, &state.workPool);
+            }));
+      }
+      if (inFlight.empty()) {
+        state.writerRunning = false;
+        return;
+      }
+    }
+
+    const int index = inFlight.front().first;
+    PreparedPage page;
+    {
+      TraceScope scope(m_trace, TraceStage::Wait, index);
+      page = inFlight.front().second.result();
+    }
+    inFlight.pop_front();
+    // 放弃或写入失败后只等待已提交的解码结束，不再写入。
+    if (state.writeFailed || state.abandon.load(std::memory_order_relaxed))
+      continue;
+    if (!state.writer->write(page, index, &state.result)) {
+      state.writeFailed = true;
+      state.result.errorText = QStringLiteral("无法创建 PDF 页面。");
+    }
+  }
+}
+
+ConversionResult IncrementalPdfWriter::finish() {
+  if (!m_state) {
+    ConversionResult result;
+    result.errorText = QStringLiteral("无法创建 PDF 文件。");
+    return result;
+  }
+  m_state->writerPool.waitForDone();
+  ConversionResult result = m_state->result;
+  if (!m_state->writeFailed)
+    finishDocument(&m_state->document, m_options.outputFile, m_trace, &result);
+  m_state.reset();
+  return result;
+}
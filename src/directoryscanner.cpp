@@ -0,0 +1,364 @@
+#include "directoryscanner.h"
+#include "imagelist.h"
+#include "scanindex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(Q_OS_UNIX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileInfo>
+#endif
+
+namespace {
+// 每个线程攒够这么多条结果再交给回调，减少跨线程投递次数。
+constexpr int kBatchSize = 512;
+// 网络文件系统上目录读取主要耗在往返延迟，线程数可以多于 CPU 核数。
+constexpr int kMaxScanThreads = 32;
+
+#if defined(Q_OS_UNIX)
+using DirectoryPath = QByteArray;
+
+DirectoryPath toDirectoryPath(const QString &path) {
+  return QFile::encodeName(path);
+}
+const QByteArray &indexKey(const DirectoryPath &path) { return path; }
+DirectoryPath fromIndexKey(const QByteArray &key) { return key; }
+QString decodeChildPath(const QByteArray &path) {
+  return QFile::decodeName(path);
+}
+
+qint64 modifiedNsecs(const struct stat &info) {
+#if defined(Q_OS_DARWIN)
+  const struct timespec &time = info.st_mtimespec;
+#else
+  const struct timespec &time = info.st_mtim;
+#endif
+  return static_cast<qint64>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+#else
+using DirectoryPath = QString;
+
+DirectoryPath toDirectoryPath(const QString &path) { return path; }
+QByteArray indexKey(const DirectoryPath &path) { return path.toUtf8(); }
+DirectoryPath fromIndexKey(const QByteArray &key) {
+  return QString::fromUtf8(key);
+}
+QString decodeChildPath(const QByteArray &path) {
+  return QString::fromUtf8(path);
+}
+#endif
+
+// 单个线程的工作队列：自己从尾部取（深度优先，局部性更好），
+// 其它线程从头部窃取（较浅的目录通常包含更多子树）。
+struct WorkQueue {
+  std::mutex mutex;
+  std::deque<DirectoryPath> directories;
+};
+
+class ScanState {
+public:
+  ScanState(int workerCount, bool recursive,
+            const std::atomic_bool *cancelFlag, ScanIndex *index,
+            const ScanBatchCallback &onBatch)
+      : m_recursive(recursive), m_cancelFlag(cancelFlag), m_index(index),
+        m_onBatch(onBatch) {
+    for (int i = 0; i < workerCount; ++i)
+      m_queues.push_back(std::make_unique<WorkQueue>());
+  }
+
+  void push(int worker, DirectoryPath path) {
+    m_outstanding.fetch_add(1, std::memory_order_relaxed);
+    WorkQueue &queue = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.directories.push_back(std::move(path));
+  }
+
+  bool cancelled() const {
+    return m_cancelFlag && m_cancelFlag->load(std::memory_order_relaxed);
+  }
+
+  void runWorker(int worker);
+
+private:
+  bool take(int worker, DirectoryPath *path);
+  void scanDirectory(int worker, const DirectoryPath &path,
+                     QStringList *batch);
+  bool reuseIndexedDirectory(int worker, const DirectoryPath &path,
+                             qint64 modifiedNsecs, QStringList *batch);
+  void flush(QStringList *batch);
+
+  const bool m_recursive;
+  const std::atomic_bool *m_cancelFlag;
+  ScanIndex *m_index;
+  const ScanBatchCallback &m_onBatch;
+  std::mutex m_callbackMutex;
+  std::vector<std::unique_ptr<WorkQueue>> m_queues;
+  // 已入队但尚未扫描完成的目录数，归零即表示整棵树已遍历完。
+  std::atomic_int m_outstanding{0};
+};
+
+bool ScanState::take(int worker, DirectoryPath *path) {
+  {
+    WorkQueue &own = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.directories.empty()) {
+      *path = std::move(own.directories.back());
+      own.directories.pop_back();
+      return true;
+    }
+  }
+  const int count = static_cast<int>(m_queues.size());
+  for (int offset = 1; offset < count; ++offset) {
+    WorkQueue &victim = *m_queues[(worker + offset) % count];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.directories.empty()) {
+      *path = std::move(victim.directories.front());
+      victim.directories.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+// 目录时间与索引一致时沿用上次的结果，并照常检查各个子目录。
+bool ScanState::reuseIndexedDirectory(int worker, const DirectoryPath &path,
+                                      qint64 modifiedNsecs,
+                                      QStringList *batch) {
+  const QByteArray key = indexKey(path);
+  IndexedDirectory entry;
+  if (!m_index->lookup(key, modifiedNsecs, &entry))
+    return false;
+
+  // 先记入索引（同时写入元数据缓存），再把文件交给调用方。
+  const QList<IndexedFile> files = entry.files;
+  const QList<QByteArray> subdirectories = entry.subdirectories;
+  m_index->record(key, std::move(entry), true);
+
+  QByteArray childPath = key;
+  if (!childPath.endsWith('/'))
+    childPath.append('/');
+  const qsizetype prefixLength = childPath.size();
+  for (const IndexedFile &file : files) {
+    childPath.truncate(prefixLength);
+    childPath.append(file.name);
+    batch->append(decodeChildPath(childPath));
+    if (batch->size() >= kBatchSize)
+      flush(batch);
+  }
+  if (m_recursive) {
+    for (const QByteArray &name : subdirectories) {
+      childPath.truncate(prefixLength);
+      childPath.append(name);
+      push(worker, fromIndexKey(childPath));
+    }
+  }
+  return true;
+}
+
+void ScanState::flush(QStringList *batch) {
+  if (batch->isEmpty())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    m_onBatch(*batch);
+  }
+  batch->clear();
+}
+
+void ScanState::runWorker(int worker) {
+  QStringList batch;
+  DirectoryPath path;
+  while (!cancelled()) {
+    if (take(worker, &path)) {
+      scanDirectory(worker, path, &batch);
+      m_outstanding.fetch_sub(1, std::memory_order_acq_rel);
+      continue;
+    }
+    if (m_outstanding.load(std::memory_order_acquire) == 0)
+      break;
+    // 其它线程手上还有目录，先把已有结果交出去，再稍候重试窃取。
+    flush(&batch);
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  if (!cancelled())
+    flush(&batch);
+}
+
+#if defined(Q_OS_UNIX)
+void ScanState::scanDirectory(int worker, const DirectoryPath &path,
+                              QStringList *batch) {
+  // 先取目录时间再读取条目：读取过程中发生的改动会在下次扫描时被发现。
+  IndexedDirectory fresh;
+  if (m_index) {
+    struct stat info;
+    if (::stat(path.constData(), &info) != 0)
+      return;
+    fresh.modifiedNsecs = modifiedNsecs(info);
+    if (reuseIndexedDirectory(worker, path, fresh.modifiedNsecs, batch))
+      return;
+  }
+
+  DIR *dir = ::opendir(path.constData());
+  if (!dir)
+    return;
+  const int dirFd = ::dirfd(dir);
+
+  QByteArray childPath = path;
+  if (!childPath.endsWith('/'))
+    childPath.append('/');
+  const qsizetype prefixLength = childPath.size();
+
+  bool complete = true;
+  while (const dirent *entry = ::readdir(dir)) {
+    if (cancelled()) {
+      complete = false;
+      break;
+    }
+    const char *name = entry->d_name;
+    // 与 QDir::Files 默认行为一致：不含隐藏项，也就跳过了 . 与 ..。
+    if (name[0] == '.')
+      continue;
+    const size_t nameLength = std::strlen(name);
+
+    unsigned char type = DT_UNKNOWN;
+#ifdef _DIRENT_HAVE_D_TYPE
+    type = entry->d_type;
+#endif
+    const bool imageName = hasSupportedExtension(name, nameLength);
+    if (type == DT_UNKNOWN) {
+      // 部分文件系统不填 d_type，此时才需要一次 lstat。
+      struct stat info;
+      if (::fstatat(dirFd, name, &info, AT_SYMLINK_NOFOLLOW) != 0)
+        continue;
+      type = S_ISDIR(info.st_mode)   ? DT_DIR
+             : S_ISREG(info.st_mode) ? DT_REG
+             : S_ISLNK(info.st_mode) ? DT_LNK
+                                     : DT_UNKNOWN;
+    }
+
+    if (type == DT_DIR) {
+      if (m_recursive) {
+        childPath.truncate(prefixLength);
+        childPath.append(name, static_cast<qsizetype>(nameLength));
+        push(worker, childPath);
+        if (m_index)
+          fresh.subdirectories.append(QByteArray(name, nameLength));
+      }
+      continue;
+    }
+    if (!imageName)
+      continue;
+
+    // 建索引时才需要每张图片的大小与时间；链接本来就要 stat 确认目标类型。
+    struct stat info;
+    if (type == DT_LNK || m_index) {
+      // 指向普通文件的链接算作文件；指向目录的链接不跟随。
+      if (::fstatat(dirFd, name, &info, 0) != 0 || !S_ISREG(info.st_mode))
+        continue;
+    } else if (type != DT_REG) {
+      continue;
+    }
+    if (m_index) {
+      fresh.files.append(IndexedFile{QByteArray(name, nameLength),
+                                     static_cast<qint64>(info.st_size),
+                                     modifiedNsecs(info) / 1000000});
+    }
+
+    childPath.truncate(prefixLength);
+    childPath.append(name, static_cast<qsizetype>(nameLength));
+    batch->append(QFile::decodeName(childPath));
+    if (batch->size() >= kBatchSize)
+      flush(batch);
+  }
+  ::closedir(dir);
+
+  if (m_index && complete)
+    m_index->record(path, std::move(fresh));
+}
+#else
+void ScanState::scanDirectory(int worker, const DirectoryPath &path,
+                              QStringList *batch) {
+  IndexedDirectory fresh;
+  if (m_index) {
+    const QDateTime modified = QFileInfo(path).lastModified();
+    if (!modified.isValid())
+      return;
+    fresh.modifiedNsecs = modified.toMSecsSinceEpoch() * 1000000LL;
+    if (reuseIndexedDirectory(worker, path, fresh.modifiedNsecs, batch))
+      return;
+  }
+
+  // Windows 上 FindFirstFile 已经带回了属性，QDirIterator 不会额外 stat。
+  QDirIterator it(path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+  bool complete = true;
+  while (it.hasNext()) {
+    if (cancelled()) {
+      complete = false;
+      break;
+    }
+    const QString childPath = it.next();
+    const QFileInfo info = it.fileInfo();
+    if (info.isDir()) {
+      if (m_recursive && !info.isSymLink()) {
+        push(worker, childPath);
+        if (m_index)
+          fresh.subdirectories.append(info.fileName().toUtf8());
+      }
+      continue;
+    }
+    if (!hasSupportedExtension(childPath))
+      continue;
+    if (m_index) {
+      fresh.files.append(IndexedFile{info.fileName().toUtf8(), info.size(),
+                                     info.lastModified().toMSecsSinceEpoch()});
+    }
+    batch->append(childPath);
+    if (batch->size() >= kBatchSize)
+      flush(batch);
+  }
+
+  if (m_index && complete)
+    m_index->record(indexKey(path), std::move(fresh));
+}
+#endif
+} // namespace
+
+void streamImageDirectory(const QString &directoryPath,
+                          bool includeSubdirectories,
+                          const std::atomic_bool *cancelFlag,
+                          const ScanBatchCallback &onBatch,
+                          ScanIndex *index) {
+  const QString root = QDir::cleanPath(QDir(directoryPath).absolutePath());
+  const int workerCount =
+      includeSubdirectories
+          ? std::clamp(QThread::idealThreadCount() * 2, 1, kMaxScanThreads)
+          : 1;
+
+  ScanState state(workerCount, includeSubdirectories, cancelFlag, index,
+                  onBatch);
+  state.push(0, toDirectoryPath(root));
+
+  // 调用线程本身充当 0 号工作线程。
+  std::vector<std::thread> helpers;
+  helpers.reserve(static_cast<size_t>(workerCount - 1));
+  for (int i = 1; i < workerCount; ++i)
+    helpers.emplace_back([&state, i]() { state.runWorker(i); });
+  state.runWorker(0);
+  for (std::thread &helper : helpers)
+    helper.join();
+}
@@ -0,0 +1,156 @@
+#include "filemetadata.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QReadLocker>
+#include <QThread>
+#include <QWriteLocker>
+#include <QtConcurrent>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+// 少于这么多条时直接在当前线程 stat。
+constexpr qsizetype kParallelStatThreshold = 256;
+
+FileMetadata readFileMetadata(const QString &path) {
+  FileMetadata metadata;
+  const QFileInfo info(path);
+  if (!info.exists())
+    return metadata;
+  metadata.size = info.size();
+  const QDateTime modified = info.lastModified();
+  metadata.modifiedMsecs = modified.isValid() ? modified.toMSecsSinceEpoch() : 0;
+  return metadata;
+}
+} // namespace
+
+bool FileMetadataCache::lookup(const QString &path,
+                               FileMetadata *metadata) const {
+  QReadLocker locker(&m_lock);
+  const auto it = m_entries.constFind(path);
+  if (it == m_entries.constEnd())
+    return false;
+  *metadata = it.value();
+  return true;
+}
+
+void FileMetadataCache::insert(const QString &path, qint64 size,
+                               qint64 modifiedMsecs) {
+  QWriteLocker locker(&m_lock);
+  FileMetadata &entry = m_entries[path];
+  if (entry.size != size || entry.modifiedMsecs != modifiedMsecs)
+    entry.pixelSize = QSize();
+  entry.size = size;
+  entry.modifiedMsecs = modifiedMsecs;
+}
+
+void FileMetadataCache::insertIfAbsent(const QString &path, qint64 size,
+                                       qint64 modifiedMsecs) {
+  QWriteLocker locker(&m_lock);
+  if (m_entries.contains(path))
+    return;
+  FileMetadata &entry = m_entries[path];
+  entry.size = size;
+  entry.modifiedMsecs = modifiedMsecs;
+}
+
+void FileMetadataCache::ensure(const QStringList &paths) {
+  QStringList missing;
+  {
+    QReadLocker locker(&m_lock);
+    for (const QString &path : paths) {
+      if (!m_entries.contains(path))
+        missing.append(path);
+    }
+  }
+  if (missing.isEmpty())
+    return;
+
+  // 网络文件系统上 stat 主要是等待往返，多个请求并行发出可以重叠延迟。
+  std::vector<FileMetadata> results(missing.size());
+  const int threads = std::max(1, QThread::idealThreadCount());
+  if (missing.size() < kParallelStatThreshold || threads == 1) {
+    for (qsizetype i = 0; i < missing.size(); ++i)
+      results[i] = readFileMetadata(missing.at(i));
+  } else {
+    std::vector<std::pair<qsizetype, qsizetype>> ranges;
+    const qsizetype chunks = std::min<qsizetype>(
+        threads * 4, missing.size() / (kParallelStatThreshold / 4));
+    for (qsizetype i = 0; i < chunks; ++i)
+      ranges.emplace_back(missing.size() * i / chunks,
+                          missing.size() * (i + 1) / chunks);
+    QtConcurrent::blockingMap(
+        ranges, [&](const std::pair<qsizetype, qsizetype> &range) {
+          for (qsizetype i = range.first; i < range.second; ++i)
+            results[i] = readFileMetadata(missing.at(i));
+        });
+  }
+
+  QWriteLocker locker(&m_lock);
+  m_entries.reserve(m_entries.size() + missing.size());
+  for (qsizetype i = 0; i < missing.size(); ++i)
+    m_entries.insert(missing.at(i), results[i]);
+}
+
+FileMetadata FileMetadataCache::metadata(const QString &path) {
+  FileMetadata cached;
+  if (lookup(path, &cached))
+    return cached;
+  const FileMetadata fresh = readFileMetadata(path);
+  QWriteLocker locker(&m_lock);
+  m_entries.insert(path, fresh);
+  return fresh;
+}
+
+FileMetadata FileMetadataCache::refresh(const QString &path) {
+  const FileMetadata fresh = readFileMetadata(path);
+  insert(path, fresh.size, fresh.modifiedMsecs);
+  return fresh;
+}
+
+QSize FileMetadataCache::pixelSize(const QString &path) {
+  FileMetadata cached = metadata(path);
+  if (cached.pixelSize.isValid())
+    return cached.pixelSize;
+
+  // 只解析文件头；按 EXIF 方向旋转 90° 的图片交换宽高，与解码后的尺寸一致。
+  QImageReader reader(path);
+  QSize size = reader.size();
+  if (size.isValid() && reader.autoTransform() &&
+      reader.transformation().testFlag(QImageIOHandler::TransformationRotate90))
+    size.transpose();
+  if (!size.isValid())
+    return size;
+
+  QWriteLocker locker(&m_lock);
+  const auto it = m_entries.find(path);
+  if (it != m_entries.end() && it->size == cached.size &&
+      it->modifiedMsecs == cached.modifiedMsecs)
+    it->pixelSize = size;
+  return size;
+}
+
+void FileMetadataCache::invalidateDirectory(const QString &directoryPath) {
+  QString prefix = directoryPath;
+  if (!prefix.endsWith(QLatin1Char('/')))
+    prefix.append(QLatin1Char('/'));
+
+  QWriteLocker locker(&m_lock);
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    // 只处理直接位于该目录下的文件，子目录有自己的通知。
+    if (it.key().startsWith(prefix) &&
+        it.key().indexOf(QLatin1Char('/'), prefix.size()) < 0) {
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void FileMetadataCache::clear() {
+  QWriteLocker locker(&m_lock);
+  m_entries.clear();
+}
@@ -0,0 +1,124 @@
+#include "flate.h"
+
+#include <algorithm>
+
+#if defined(IMAGES2PDF_HAVE_ZLIB)
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <vector>
+#include <zlib.h>
+#endif
+
+namespace {
+#if defined(IMAGES2PDF_HAVE_ZLIB)
+// 块越小并行度越高，但每块都要重新预热字典并多出几个字节的刷新标记。
+constexpr qsizetype kChunkBytes = 256 * 1024;
+constexpr qsizetype kWindowBytes = 32 * 1024;
+
+struct FlateChunk {
+  qsizetype offset = 0;
+  qsizetype length = 0;
+  QByteArray compressed;
+  uLong adler = 1;
+  bool ok = false;
+};
+
+// 原始 deflate（不带 zlib 头尾），最后一块用 Z_FINISH 结束整个流。
+void compressChunk(const QByteArray &raw, int level, bool last,
+                   FlateChunk *chunk) {
+  z_stream stream = {};
+  if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return;
+  const auto *input = reinterpret_cast<const Bytef *>(raw.constData());
+  const qsizetype dictionaryLength = std::min(chunk->offset, kWindowBytes);
+  if (dictionaryLength > 0)
+    deflateSetDictionary(&stream, input + chunk->offset - dictionaryLength,
+                         static_cast<uInt>(dictionaryLength));
+
+  // 同步刷新最多再多出几个字节的空存储块。
+  chunk->compressed.resize(
+      static_cast<qsizetype>(
+          deflateBound(&stream, static_cast<uLong>(chunk->length))) +
+      16);
+  stream.next_in = const_cast<Bytef *>(input + chunk->offset);
+  stream.avail_in = static_cast<uInt>(chunk->length);
+  stream.next_out = reinterpret_cast<Bytef *>(chunk->compressed.data());
+  stream.avail_out = static_cast<uInt>(chunk->compressed.size());
+  const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  chunk->ok = last ? result == Z_STREAM_END
+                   : result == Z_OK && stream.avail_in == 0;
+  chunk->compressed.resize(chunk->compressed.size() - stream.avail_out);
+  deflateEnd(&stream);
+  chunk->adler = adler32(1L, input + chunk->offset,
+                         static_cast<uInt>(chunk->length));
+}
+
+QByteArray parallelCompress(const QByteArray &raw, int level,
+                            QThreadPool *pool) {
+  std::vector<FlateChunk> chunks;
+  for (qsizetype offset = 0; offset < raw.size(); offset += kChunkBytes) {
+    FlateChunk chunk;
+    chunk.offset = offset;
+    chunk.length = std::min(kChunkBytes, raw.size() - offset);
+    chunks.push_back(chunk);
+  }
+  // 调用方多在解码线程池中，压缩任务交给另一个线程池，不会互相等待。
+  const FlateChunk *lastChunk = &chunks.back();
+  QtConcurrent::blockingMap(pool ? pool : QThreadPool::globalInstance(),
+                            chunks,
+                            [&raw, level, lastChunk](FlateChunk &chunk) {
+                              compressChunk(raw, level, &chunk == lastChunk,
+                                            &chunk);
+                            });
+
+  // zlib 头：CMF = 0x78（32 KB 窗口），FLG 的压缩级别提示须与 level 对应，
+  // 且 CMF * 256 + FLG 能被 31 整除。
+  const char flags = level >= 7   ? '\xDA'
+                     : level == 6 ? '\x9C'
+                     : level >= 2 ? '\x5E'
+                                  : '\x01';
+  QByteArray stream;
+  qsizetype total = 6;
+  for (const FlateChunk &chunk : chunks)
+    total += chunk.compressed.size();
+  stream.reserve(total);
+  stream.append('\x78');
+  stream.append(flags);
+  uLong adler = 1;
+  for (const FlateChunk &chunk : chunks) {
+    if (!chunk.ok)
+      return QByteArray();
+    stream.append(chunk.compressed);
+    adler = adler32_combine(adler, chunk.adler,
+                            static_cast<z_off_t>(chunk.length));
+  }
+  for (int shift = 24; shift >= 0; shift -= 8)
+    stream.append(static_cast<char>((adler >> shift) & 0xFF));
+  return stream;
+}
+#endif
+
+QByteArray serialCompress(const QByteArray &raw, int level) {
+  // qCompress 在 zlib 流之前附加 4 字节长度，PDF 只需要 zlib 流本身。
+  QByteArray compressed = qCompress(raw, level);
+  if (compressed.size() > 4)
+    compressed.remove(0, 4);
+  return compressed;
+}
+} // namespace
+
+QByteArray flateCompress(const QByteArray &raw, int level,
+                         QThreadPool *pool) {
+  level = std::clamp(level, 0, 9);
+#if defined(IMAGES2PDF_HAVE_ZLIB)
+  if (raw.size() >= 2 * kChunkBytes) {
+    const QByteArray compressed = parallelCompress(raw, level, pool);
+    if (!compressed.isEmpty())
+      return compressed;
+  }
+#else
+  Q_UNUSED(pool);
+#endif
+  return serialCompress(raw, level);
+}
@@ -0,0 +1,338 @@
+#include "hotfolder.h"
+#include "directoryscanner.h"
+#include "imagelist.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <algorithm>
+#include <utility>
+
+namespace {
+// 目录变化的通知往往成串到达（每写一块数据都可能触发），攒一会儿再统一
+// 重新列出。
+constexpr int kDirtyDelayMs = 200;
+// 兜底检查目录修改时间的间隔，每个目录只需一次 stat。
+constexpr int kDirectoryPollIntervalMs = 10000;
+
+qint64 modifiedMsecs(const QFileInfo &info) {
+  return info.lastModified().toMSecsSinceEpoch();
+}
+
+bool isInsideDirectory(const QString &path, const QString &directoryPath) {
+  return path.size() > directoryPath.size() &&
+         path.startsWith(directoryPath) &&
+         path.at(directoryPath.size()) == QLatin1Char('/');
+}
+} // namespace
+
+HotFolderWatcher::HotFolderWatcher(HotFolderOptions options, QObject *parent)
+    : QObject(parent), m_options(std::move(options)) {
+  m_dirtyTimer.setSingleShot(true);
+  m_dirtyTimer.setInterval(kDirtyDelayMs);
+  connect(&m_dirtyTimer, &QTimer::timeout, this,
+          &HotFolderWatcher::processDirtyDirectories);
+  m_settleTimer.setInterval(
+      std::max(250, m_options.settleMilliseconds / 2));
+  connect(&m_settleTimer, &QTimer::timeout, this,
+          &HotFolderWatcher::pollSettlingFiles);
+  m_idleTimer.setSingleShot(true);
+  connect(&m_idleTimer, &QTimer::timeout, this,
+          &HotFolderWatcher::finishCurrentDocument);
+  m_directoryPollTimer.setInterval(kDirectoryPollIntervalMs);
+  connect(&m_directoryPollTimer, &QTimer::timeout, this,
+          &HotFolderWatcher::pollDirectoryTimes);
+  connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this,
+          &HotFolderWatcher::markDirectoryDirty);
+}
+
+HotFolderWatcher::~HotFolderWatcher() {
+  m_document.reset();
+  for (const auto &document : m_finishing)
+    document->watcher->waitForFinished();
+}
+
+bool HotFolderWatcher::start(QString *error) {
+  const QFileInfo root(m_options.directoryPath);
+  if (!root.isDir()) {
+    *error = QStringLiteral("找不到要监视的文件夹：%1")
+                 .arg(m_options.directoryPath);
+    return false;
+  }
+  const QFileInfo output(m_options.conversion.outputFile);
+  if (!output.dir().exists() && !QDir().mkpath(output.dir().absolutePath())) {
+    *error = QStringLiteral("无法创建输出目录。");
+    return false;
+  }
+  m_options.conversion.outputFile = output.absoluteFilePath();
+  m_options.directoryPath = QDir::cleanPath(root.absoluteFilePath());
+
+  m_clock.start();
+  watchTree(m_options.directoryPath, m_options.includeExisting);
+  m_directoryPollTimer.start();
+  return true;
+}
+
+void HotFolderWatcher::stop() {
+  m_dirtyTimer.stop();
+  m_settleTimer.stop();
+  m_directoryPollTimer.stop();
+  const QStringList watched = m_watcher.directories();
+  if (!watched.isEmpty())
+    m_watcher.removePaths(watched);
+  m_settling.clear();
+
+  finishCurrentDocument();
+  // 逐个等待后台完成的 PDF，按开始的顺序报告。
+  std::vector<std::unique_ptr<FinishingDocument>> finishing;
+  finishing.swap(m_finishing);
+  for (const auto &document : finishing) {
+    document->watcher->disconnect(this);
+    const ConversionResult result = document->watcher->future().result();
+    emit documentFinished(document->outputFile, result);
+  }
+}
+
+// 目录只在这里整体遍历一次：启动时的根目录，以及之后新出现的子目录。
+void HotFolderWatcher::watchTree(const QString &rootPath, bool filesAreNew) {
+  QStringList directories = {rootPath};
+  if (m_options.includeSubdirectories) {
+    // 与扫描器一致：跳过隐藏目录，不跟随符号链接。
+    QDirIterator it(rootPath, QDir::Dirs | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext())
+      directories << QDir::cleanPath(it.next());
+  }
+  for (const QString &directory : directories) {
+    if (m_directories.contains(directory))
+      continue;
+    m_directories[directory].modifiedMsecs =
+        modifiedMsecs(QFileInfo(directory));
+  }
+  m_watcher.addPaths(directories);
+
+  QStringList found;
+  streamImageDirectory(rootPath, m_options.includeSubdirectories, nullptr,
+                       [&found](const QStringList &batch) { found << batch; });
+  for (const QString &path : found) {
+    const QString directory = QFileInfo(path).path();
+    m_directories[directory].files.insert(path);
+    if (filesAreNew)
+      queueNewFile(path);
+  }
+}
+
+void HotFolderWatcher::forgetDirectory(const QString &directoryPath) {
+  for (auto it = m_directories.begin(); it != m_directories.end();) {
+    if (it.key() == directoryPath || isInsideDirectory(it.key(), directoryPath))
+      it = m_directories.erase(it);
+    else
+      ++it;
+  }
+  for (auto it = m_settling.begin(); it != m_settling.end();) {
+    if (isInsideDirectory(it.key(), directoryPath))
+      it = m_settling.erase(it);
+    else
+      ++it;
+  }
+}
+
+void HotFolderWatcher::markDirectoryDirty(const QString &directoryPath) {
+  m_dirtyDirectories.insert(QDir::cleanPath(directoryPath));
+  if (!m_dirtyTimer.isActive())
+    m_dirtyTimer.start();
+}
+
+void HotFolderWatcher::processDirtyDirectories() {
+  const QSet<QString> dirty = std::exchange(m_dirtyDirectories, {});
+  for (const QString &directory : dirty) {
+    if (m_directories.contains(directory))
+      rescanDirectory(directory);
+  }
+}
+
+// 只列出这一层：新文件进入等待稳定的队列，消失的文件从记录中删除，
+// 同名文件再次出现时会被当作新文件处理。
+void HotFolderWatcher::rescanDirectory(const QString &directoryPath) {
+  const QFileInfo info(directoryPath);
+  if (!info.isDir()) {
+    forgetDirectory(directoryPath);
+    return;
+  }
+
+  QSet<QString> current;
+  streamImageDirectory(directoryPath, false, nullptr,
+                       [&current](const QStringList &batch) {
+                         for (const QString &path : batch)
+                           current.insert(path);
+                       });
+  DirectoryState &state = m_directories[directoryPath];
+  state.modifiedMsecs = modifiedMsecs(info);
+  for (const QString &path : current) {
+    if (!state.files.contains(path))
+      queueNewFile(path);
+  }
+  for (const QString &path : std::as_const(state.files)) {
+    if (!current.contains(path))
+      m_settling.remove(path);
+  }
+  state.files = std::move(current);
+
+  if (!m_options.includeSubdirectories)
+    return;
+  const QStringList children =
+      QDir(directoryPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for (const QString &child : children) {
+    const QString childPath = directoryPath + QLatin1Char('/') + child;
+    if (!m_directories.contains(childPath))
+      watchTree(childPath, true);
+  }
+}
+
+void HotFolderWatcher::pollDirectoryTimes() {
+  for (auto it = m_directories.cbegin(); it != m_directories.cend(); ++it) {
+    const QFileInfo info(it.key());
+    if (!info.exists() || modifiedMsecs(info) != it.value().modifiedMsecs)
+      markDirectoryDirty(it.key());
+  }
+}
+
+void HotFolderWatcher::queueNewFile(const QString &path) {
+  if (m_settling.contains(path))
+    return;
+  PendingFile pending;
+  pending.stableSinceMsecs = m_clock.elapsed();
+  m_settling.insert(path, pending);
+  if (!m_settleTimer.isActive())
+    m_settleTimer.start();
+}
+
+// 扫描仪与网络复制通常边写边增大文件，大小与修改时间在整个稳定期内都
+// 不变才交给转换；空文件一直等待。
+void HotFolderWatcher::pollSettlingFiles() {
+  const qint64 now = m_clock.elapsed();
+  QStringList settled;
+  for (auto it = m_settling.begin(); it != m_settling.end();) {
+    const QFileInfo info(it.key());
+    if (!info.exists()) {
+      it = m_settling.erase(it);
+      continue;
+    }
+    PendingFile &pending = it.value();
+    const qint64 size = info.size();
+    const qint64 modified = modifiedMsecs(info);
+    if (size <= 0 || size != pending.size ||
+        modified != pending.modifiedMsecs) {
+      pending.size = size;
+      pending.modifiedMsecs = modified;
+      pending.stableSinceMsecs = now;
+    } else if (now - pending.stableSinceMsecs >=
+               m_options.settleMilliseconds) {
+      settled << it.key();
+      it = m_settling.erase(it);
+      continue;
+    }
+    ++it;
+  }
+  if (m_settling.isEmpty())
+    m_settleTimer.stop();
+  if (!settled.isEmpty()) {
+    // 同一批写完的文件按文件名排列，扫描仪的流水号即页序。
+    sortImagesByName(settled, true);
+    appendSettledFiles(std::move(settled));
+  }
+}
+
+void HotFolderWatcher::appendSettledFiles(QStringList files) {
+  while (!files.isEmpty()) {
+    if (!m_document) {
+      ConversionOptions options = m_options.conversion;
+      options.outputFile = nextOutputFile();
+      auto document = std::make_unique<IncrementalPdfWriter>(options);
+      QString error;
+      if (!document->open(&error)) {
+        ConversionResult result;
+        result.errorText = error;
+        result.failedFiles = files;
+        emit documentFinished(options.outputFile, result);
+        return;
+      }
+      m_document = std::move(document);
+      m_documentFile = options.outputFile;
+    }
+
+    const int room = m_options.maxPages > 0
+                         ? m_options.maxPages - m_document->appendedCount()
+                         : static_cast<int>(files.size());
+    const QStringList batch = files.mid(0, room);
+    files.remove(0, batch.size());
+    m_document->append(batch);
+    emit filesAppended(m_documentFile, batch.size(),
+                       m_document->appendedCount());
+    if (m_options.maxPages > 0 &&
+        m_document->appendedCount() >= m_options.maxPages)
+      finishCurrentDocument();
+  }
+  if (m_document && m_options.idleSeconds > 0)
+    m_idleTimer.start(m_options.idleSeconds * 1000);
+}
+
+// 补写页面树前须等已追加的页面全部解码写入，放到后台进行，
+// 期间新到的文件写入下一个 PDF。
+void HotFolderWatcher::finishCurrentDocument() {
+  m_idleTimer.stop();
+  if (!m_document)
+    return;
+
+  auto finishing = std::make_unique<FinishingDocument>();
+  finishing->outputFile = m_documentFile;
+  finishing->writer = std::move(m_document);
+  finishing->watcher = std::make_unique<QFutureWatcher<ConversionResult>>();
+  FinishingDocument *document = finishing.get();
+  connect(document->watcher.get(), &QFutureWatcher<ConversionResult>::finished,
+          this, [this, document]() { handleDocumentFinished(document); });
+  IncrementalPdfWriter *writer = document->writer.get();
+  document->watcher->setFuture(
+      QtConcurrent::run([writer]() { return writer->finish(); }));
+  m_finishing.push_back(std::move(finishing));
+  m_documentFile.clear();
+}
+
+void HotFolderWatcher::handleDocumentFinished(FinishingDocument *document) {
+  const auto it = std::find_if(
+      m_finishing.begin(), m_finishing.end(),
+      [document](const auto &entry) { return entry.get() == document; });
+  if (it == m_finishing.end())
+    return;
+  const ConversionResult result = document->watcher->result();
+  const QString outputFile = document->outputFile;
+  // 正处于观察器的 finished 信号中，稍后再删除。
+  (*it)->watcher.release()->deleteLater();
+  m_finishing.erase(it);
+  emit documentFinished(outputFile, result);
+}
+
+QString HotFolderWatcher::nextOutputFile() {
+  const QFileInfo pattern(m_options.conversion.outputFile);
+  const QString suffix = pattern.suffix();
+  const QString name = pattern.fileName();
+  const QString base =
+      suffix.isEmpty() ? name : name.left(name.size() - suffix.size() - 1);
+  const QString stamp =
+      QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss"));
+  for (int attempt = 1;; ++attempt) {
+    QString fileName = base + QLatin1Char('-') + stamp;
+    if (attempt > 1)
+      fileName += QLatin1Char('-') + QString::number(attempt);
+    if (!suffix.isEmpty())
+      fileName += QLatin1Char('.') + suffix;
+    const QString path = pattern.dir().filePath(fileName);
+    if (!m_usedOutputFiles.contains(path) && !QFile::exists(path)) {
+      m_usedOutputFiles.insert(path);
+      return path;
+    }
+  }
+}
@@ -0,0 +1,405 @@
+#include "imageencoding.h"
+#include "flate.h"
+#include "pixelops.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QImageWriter>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr int kJpegQuality = 94;
+
+bool isSofMarker(int marker) {
+  return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+         marker != 0xC8 && marker != 0xCC;
+}
+
+// 只接受 PDF 阅读器普遍支持的 Huffman 基线、扩展与渐进式编码。
+bool isPassthroughSofMarker(int marker) {
+  return marker == 0xC0 || marker == 0xC1 || marker == 0xC2;
+}
+
+QByteArray packPixels(const QImage &image, int bytesPerRow) {
+  QByteArray raw;
+  raw.resize(static_cast<qsizetype>(bytesPerRow) * image.height());
+  char *out = raw.data();
+  for (int y = 0; y < image.height(); ++y) {
+    std::memcpy(out, image.constScanLine(y), bytesPerRow);
+    out += bytesPerRow;
+  }
+  return raw;
+}
+
+// 1 位图像：PDF 的 DeviceGray 中 0 为黑、1 为白，位序与 Format_Mono 相同。
+PdfImage bilevelFlateImage(const QImage &image, bool inverted, int level,
+                           QThreadPool *pool) {
+  PdfImage result;
+  result.width = image.width();
+  result.height = image.height();
+  result.components = 1;
+  result.bitsPerComponent = 1;
+  result.filter = QByteArrayLiteral("FlateDecode");
+  if (inverted)
+    result.decodeArray = QByteArrayLiteral("[1 0]");
+  result.data =
+      flateCompress(packPixels(image, (image.width() + 7) / 8), level, pool);
+  return result;
+}
+
+PdfImage flateImage(const QImage &image, int components, int level,
+                    QThreadPool *pool) {
+  PdfImage result;
+  result.width = image.width();
+  result.height = image.height();
+  result.components = components;
+  result.bitsPerComponent = 8;
+  result.filter = QByteArrayLiteral("FlateDecode");
+  result.data =
+      flateCompress(packPixels(image, image.width() * components), level,
+                    pool);
+  return result;
+}
+
+quint32 readBigEndian32(const uchar *bytes) {
+  return (quint32(bytes[0]) << 24) | (quint32(bytes[1]) << 16) |
+         (quint32(bytes[2]) << 8) | quint32(bytes[3]);
+}
+
+// 以 JPEG（质量 94）编码，没有 JPEG 编码插件时返回空图像。
+// 灰度图写出单分量的 JPEG。
+PdfImage jpegImage(const QImage &image) {
+  QByteArray encoded;
+  QBuffer buffer(&encoded);
+  if (!buffer.open(QIODevice::WriteOnly))
+    return PdfImage();
+  QImageWriter writer(&buffer, "jpeg");
+  writer.setQuality(kJpegQuality);
+  JpegInfo info;
+  if (!writer.write(image) || !parseJpegHeader(encoded, &info))
+    return PdfImage();
+  PdfImage result;
+  result.width = image.width();
+  result.height = image.height();
+  result.components = info.components;
+  result.bitsPerComponent = 8;
+  result.filter = QByteArrayLiteral("DCTDecode");
+  result.data = encoded;
+  return result;
+}
+
+// 整幅 RGB32 或 Grayscale8 图像的颜色不超过 256 种时编码为 /Indexed，
+// 位深按颜色数取 1、2、4 或 8；颜色过多时返回空图像。
+PdfImage indexedFlateImage(const QImage &image, int level,
+                           QThreadPool *pool) {
+  constexpr int kMaxColors = 256;
+  constexpr size_t kSlots = 4 * kMaxColors;
+  const bool gray = image.format() == QImage::Format_Grayscale8;
+  const int width = image.width();
+  const int height = image.height();
+
+  // 开放寻址的颜色表；相邻像素多为同色，先比较上一个像素。
+  std::array<QRgb, kSlots> slotColors{};
+  std::array<int, kSlots> slotIndex;
+  slotIndex.fill(-1);
+  std::vector<QRgb> palette;
+  QByteArray indices(static_cast<qsizetype>(width) * height, '\0');
+  uchar *out = reinterpret_cast<uchar *>(indices.data());
+  QRgb lastColor = 0;
+  int lastIndex = -1;
+  for (int y = 0; y < height; ++y) {
+    const uchar *line = image.constScanLine(y);
+    for (int x = 0; x < width; ++x) {
+      const QRgb color =
+          gray ? qRgb(line[x], line[x], line[x])
+               : reinterpret_cast<const QRgb *>(line)[x] | 0xFF000000u;
+      if (lastIndex < 0 || color != lastColor) {
+        size_t slot = (color * 2654435761u) % kSlots;
+        while (slotIndex[slot] >= 0 && slotColors[slot] != color)
+          slot = (slot + 1) % kSlots;
+        if (slotIndex[slot] < 0) {
+          if (static_cast<int>(palette.size()) == kMaxColors)
+            return PdfImage();
+          slotIndex[slot] = static_cast<int>(palette.size());
+          slotColors[slot] = color;
+          palette.push_back(color);
+        }
+        lastColor = color;
+        lastIndex = slotIndex[slot];
+      }
+      *out++ = static_cast<uchar>(lastIndex);
+    }
+  }
+
+  const int colors = static_cast<int>(palette.size());
+  const int bits = colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8;
+  QByteArray packed = indices;
+  if (bits < 8) {
+    const int bytesPerRow = (width * bits + 7) / 8;
+    const int perByte = 8 / bits;
+    packed = QByteArray(static_cast<qsizetype>(bytesPerRow) * height, '\0');
+    const auto *in = reinterpret_cast<const uchar *>(indices.constData());
+    auto *row = reinterpret_cast<uchar *>(packed.data());
+    for (int y = 0; y < height; ++y, row += bytesPerRow) {
+      for (int x = 0; x < width; ++x) {
+        const int shift = 8 - bits * (x % perByte + 1);
+        row[x / perByte] |= static_cast<uchar>(*in++ << shift);
+      }
+    }
+  }
+
+  const bool grayPalette =
+      std::all_of(palette.begin(), palette.end(), [](QRgb color) {
+        return qRed(color) == qGreen(color) && qGreen(color) == qBlue(color);
+      });
+  PdfImage result;
+  result.width = width;
+  result.height = height;
+  result.components = grayPalette ? 1 : 3;
+  result.bitsPerComponent = bits;
+  result.filter = QByteArrayLiteral("FlateDecode");
+  for (QRgb color : palette) {
+    if (grayPalette) {
+      result.palette.append(static_cast<char>(qRed(color)));
+    } else {
+      result.palette.append(static_cast<char>(qRed(color)));
+      result.palette.append(static_cast<char>(qGreen(color)));
+      result.palette.append(static_cast<char>(qBlue(color)));
+    }
+  }
+  result.data = flateCompress(packed, level, pool);
+  return result;
+}
+} // namespace
+
+bool parseJpegHeader(const QByteArray &data, JpegInfo *info) {
+  const auto *bytes = reinterpret_cast<const uchar *>(data.constData());
+  const qsizetype size = data.size();
+  if (size < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8)
+    return false;
+
+  JpegInfo result;
+  qsizetype pos = 2;
+  while (pos + 4 <= size) {
+    if (bytes[pos] != 0xFF)
+      return false;
+    const int marker = bytes[pos + 1];
+    if (marker == 0xFF) {
+      ++pos; // 填充字节
+      continue;
+    }
+    pos += 2;
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+      continue; // 无长度字段的独立标记
+    if (marker == 0xD9 || marker == 0xDA)
+      return false; // 在 SOF 之前就遇到了扫描数据或结束标记
+
+    const int length = (bytes[pos] << 8) | bytes[pos + 1];
+    if (length < 2 || pos + length > size)
+      return false;
+    const uchar *segment = bytes + pos + 2;
+    const int segmentLength = length - 2;
+
+    if (marker == 0xEE && segmentLength >= 12 &&
+        std::memcmp(segment, "Adobe", 5) == 0) {
+      result.hasAdobeMarker = true;
+      result.adobeTransform = segment[11];
+    } else if (isSofMarker(marker)) {
+      if (segmentLength < 6)
+        return false;
+      result.sofMarker = marker;
+      result.precision = segment[0];
+      result.height = (segment[1] << 8) | segment[2];
+      result.width = (segment[3] << 8) | segment[4];
+      result.components = segment[5];
+      if (info)
+        *info = result;
+      return true;
+    }
+    pos += length;
+  }
+  return false;
+}
+
+PdfImage jpegPassthroughImage(const QByteArray &data, bool requireGrayscale) {
+  JpegInfo info;
+  if (!parseJpegHeader(data, &info))
+    return PdfImage();
+  if (!isPassthroughSofMarker(info.sofMarker) || info.precision != 8 ||
+      info.width <= 0 || info.height <= 0)
+    return PdfImage();
+  if (requireGrayscale && info.components != 1)
+    return PdfImage();
+
+  PdfImage result;
+  switch (info.components) {
+  case 1:
+  case 3:
+    break;
+  case 4:
+    // Photoshop 写出的 CMYK 带 Adobe 标记且数值取反；YCCK 等其它变换交给解码路径。
+    if (info.hasAdobeMarker) {
+      if (info.adobeTransform != 0)
+        return PdfImage();
+      result.decodeArray = QByteArrayLiteral("[1 0 1 0 1 0 1 0]");
+    }
+    break;
+  default:
+    return PdfImage();
+  }
+
+  // 带有 EXIF 方向信息的图片需要旋转，无法原样嵌入。
+  QByteArray copy = data;
+  QBuffer buffer(&copy);
+  if (!buffer.open(QIODevice::ReadOnly))
+    return PdfImage();
+  QImageReader reader(&buffer, "jpeg");
+  if (reader.transformation() != QImageIOHandler::TransformationNone)
+    return PdfImage();
+
+  result.width = info.width;
+  result.height = info.height;
+  result.components = info.components;
+  result.bitsPerComponent = 8;
+  result.filter = QByteArrayLiteral("DCTDecode");
+  result.data = data;
+  return result;
+}
+
+PdfImage pngPassthroughImage(const QByteArray &data, bool requireGrayscale) {
+  const auto *bytes = reinterpret_cast<const uchar *>(data.constData());
+  const qsizetype size = data.size();
+  static const char signature[] = "\x89PNG\r\n\x1A\n";
+  if (size < 33 || std::memcmp(bytes, signature, 8) != 0 ||
+      readBigEndian32(bytes + 8) != 13 ||
+      std::memcmp(bytes + 12, "IHDR", 4) != 0)
+    return PdfImage();
+
+  const quint32 width = readBigEndian32(bytes + 16);
+  const quint32 height = readBigEndian32(bytes + 20);
+  const int bitDepth = bytes[24];
+  const int colorType = bytes[25];
+  const int interlace = bytes[28];
+  // 0 = 灰度，2 = RGB；带 alpha 的类型需要软蒙版，调色板需要 /Indexed。
+  if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF ||
+      bitDepth != 8 || (colorType != 0 && colorType != 2) || interlace != 0 ||
+      bytes[26] != 0 || bytes[27] != 0)
+    return PdfImage();
+  if (requireGrayscale && colorType != 0)
+    return PdfImage();
+
+  QByteArray idat;
+  qsizetype pos = 33;
+  for (;;) {
+    if (pos + 12 > size)
+      return PdfImage();
+    const quint32 length = readBigEndian32(bytes + pos);
+    const uchar *type = bytes + pos + 4;
+    if (length > quint32(size - pos - 12))
+      return PdfImage();
+    if (std::memcmp(type, "IDAT", 4) == 0) {
+      idat.append(reinterpret_cast<const char *>(bytes + pos + 8),
+                  static_cast<qsizetype>(length));
+    } else if (std::memcmp(type, "IEND", 4) == 0) {
+      break;
+    } else if (std::memcmp(type, "tRNS", 4) == 0 ||
+               std::memcmp(type, "eXIf", 4) == 0) {
+      // 透明色在解码路径中会铺到白底上，EXIF 方向需要旋转，都不能原样嵌入。
+      return PdfImage();
+    }
+    pos += 12 + static_cast<qsizetype>(length);
+  }
+  // zlib 头：压缩方式 8，且前两个字节组成的数能被 31 整除。
+  if (idat.size() < 2)
+    return PdfImage();
+  const int cmf = static_cast<uchar>(idat.at(0));
+  const int flags = static_cast<uchar>(idat.at(1));
+  if ((cmf & 0x0F) != 8 || ((cmf << 8) | flags) % 31 != 0)
+    return PdfImage();
+
+  PdfImage result;
+  result.width = static_cast<int>(width);
+  result.height = static_cast<int>(height);
+  result.components = colorType == 2 ? 3 : 1;
+  result.bitsPerComponent = 8;
+  result.filter = QByteArrayLiteral("FlateDecode");
+  result.decodeParms = "<< /Predictor 15 /Colors " +
+                       QByteArray::number(result.components) +
+                       " /BitsPerComponent 8 /Columns " +
+                       QByteArray::number(result.width) + " >>";
+  result.data = std::move(idat);
+  return result;
+}
+
+PdfImage encodeDecodedImage(const QImage &source, int flateLevel,
+                            QThreadPool *pool) {
+  if (source.isNull())
+    return PdfImage();
+
+  if (source.format() == QImage::Format_Mono) {
+    const QList<QRgb> colors = source.colorTable();
+    const QRgb black = qRgb(0, 0, 0);
+    const QRgb white = qRgb(255, 255, 255);
+    if (colors.size() == 2 && qGray(colors.at(0)) == qGray(black) &&
+        qGray(colors.at(1)) == qGray(white))
+      return bilevelFlateImage(source, false, flateLevel, pool);
+    if (colors.size() == 2 && qGray(colors.at(0)) == qGray(white) &&
+        qGray(colors.at(1)) == qGray(black))
+      return bilevelFlateImage(source, true, flateLevel, pool);
+  }
+
+  if (source.format() == QImage::Format_Grayscale8)
+    return flateImage(source, 1, flateLevel, pool);
+  if (source.format() == QImage::Format_Grayscale16)
+    return flateImage(source.convertToFormat(QImage::Format_Grayscale8), 1,
+                      flateLevel, pool);
+
+  const QImage image = flattenOnWhite(source);
+  PdfImage result = jpegImage(image);
+  if (!result.isNull())
+    return result;
+  // 没有 JPEG 编码插件时退回无损压缩。
+  return flateImage(image.convertToFormat(QImage::Format_RGB888), 3,
+                    flateLevel, pool);
+}
+
+PdfImage encodeAnalyzedImage(const QImage &source,
+                             const ImageAnalysis &analysis, int flateLevel,
+                             PageClass *applied, QThreadPool *pool) {
+  *applied = analysis.pageClass;
+  if (source.isNull())
+    return PdfImage();
+
+  switch (analysis.pageClass) {
+  case PageClass::Bilevel:
+    return bilevelFlateImage(
+        bilevelImage(grayscaleImage(source), BilevelMode::Global), false,
+        flateLevel, pool);
+  case PageClass::Grayscale: {
+    const QImage gray = grayscaleImage(source);
+    // 灰阶很少（如只有几级灰的图表）时索引色更小，否则 JPEG 远小于 Flate。
+    if (analysis.grayLevels <= 16) {
+      PdfImage indexed = indexedFlateImage(gray, flateLevel, pool);
+      if (!indexed.isNull() && indexed.bitsPerComponent <= 4)
+        return indexed;
+    }
+    PdfImage result = jpegImage(gray);
+    return result.isNull() ? flateImage(gray, 1, flateLevel, pool) : result;
+  }
+  case PageClass::Palette: {
+    PdfImage indexed =
+        indexedFlateImage(flattenOnWhite(source), flateLevel, pool);
+    if (!indexed.isNull())
+      return indexed;
+    // 采样之外还有更多颜色，按彩色处理。
+    *applied = PageClass::Color;
+    break;
+  }
+  case PageClass::Color:
+    break;
+  }
+  return encodeDecodedImage(source, flateLevel, pool);
+}
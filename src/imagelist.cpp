@@ -0,0 +1,328 @@
+#include "imagelist.h"
+#include "directoryscanner.h"
+#include "filemetadata.h"
+
+#include <QCollator>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr const char *kSupportedExtensions[] = {
+    "png", "jpg", "jpeg", "bmp",  "gif",  "webp",
+    "tif", "tiff", "jfif", "heic", "heif", "avif"};
+
+inline char asciiLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+QCollator makeNameCollator() {
+  QCollator collator;
+  collator.setCaseSensitivity(Qt::CaseInsensitive);
+  collator.setNumericMode(true);
+  return collator;
+}
+
+// 少于这么多条时单线程处理，线程调度的开销不划算。
+constexpr qsizetype kParallelSortThreshold = 8192;
+
+int sortChunkCount(qsizetype size) {
+  if (size < kParallelSortThreshold)
+    return 1;
+  const int threads = std::max(1, QThread::idealThreadCount());
+  return static_cast<int>(
+      std::min<qsizetype>(threads, size / (kParallelSortThreshold / 2)));
+}
+
+template <typename Fn>
+void parallelForRanges(qsizetype size, Fn &&fn) {
+  const int chunks = sortChunkCount(size);
+  if (chunks <= 1) {
+    fn(qsizetype(0), size);
+    return;
+  }
+  std::vector<std::pair<qsizetype, qsizetype>> ranges;
+  for (int i = 0; i < chunks; ++i)
+    ranges.emplace_back(size * i / chunks, size * (i + 1) / chunks);
+  QtConcurrent::blockingMap(
+      ranges, [&fn](const std::pair<qsizetype, qsizetype> &range) {
+        fn(range.first, range.second);
+      });
+}
+
+// 分块并行 stable_sort 后逐轮两两归并。std::merge 在相等时优先取左段，
+// 因此整体结果与对整个序列做 std::stable_sort 完全相同。
+template <typename T, typename Less>
+void parallelStableSort(std::vector<T> &data, Less less) {
+  const int chunks = sortChunkCount(static_cast<qsizetype>(data.size()));
+  if (chunks <= 1) {
+    std::stable_sort(data.begin(), data.end(), less);
+    return;
+  }
+
+  std::vector<size_t> bounds;
+  for (int i = 0; i <= chunks; ++i)
+    bounds.push_back(data.size() * i / chunks);
+
+  std::vector<int> chunkIndexes(chunks);
+  std::iota(chunkIndexes.begin(), chunkIndexes.end(), 0);
+  QtConcurrent::blockingMap(chunkIndexes, [&](int chunk) {
+    std::stable_sort(data.begin() + bounds[chunk],
+                     data.begin() + bounds[chunk + 1], less);
+  });
+
+  std::vector<T> buffer(data.size());
+  std::vector<T> *source = &data;
+  std::vector<T> *target = &buffer;
+  while (bounds.size() > 2) {
+    std::vector<size_t> merged;
+    std::vector<int> pairs;
+    for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+      merged.push_back(bounds[i]);
+      pairs.push_back(static_cast<int>(i));
+    }
+    merged.push_back(bounds.back());
+    QtConcurrent::blockingMap(pairs, [&](int i) {
+      const auto begin = source->begin();
+      if (static_cast<size_t>(i) + 2 < bounds.size()) {
+        std::merge(std::make_move_iterator(begin + bounds[i]),
+                   std::make_move_iterator(begin + bounds[i + 1]),
+                   std::make_move_iterator(begin + bounds[i + 1]),
+                   std::make_move_iterator(begin + bounds[i + 2]),
+                   target->begin() + bounds[i], less);
+      } else {
+        // 落单的最后一段原样搬过去。
+        std::move(begin + bounds[i], begin + bounds[i + 1],
+                  target->begin() + bounds[i]);
+      }
+    });
+    bounds = std::move(merged);
+    std::swap(source, target);
+  }
+  if (source != &data)
+    data = std::move(*source);
+}
+
+bool isSupportedSuffix(const char *suffix, size_t length) {
+  for (const char *extension : kSupportedExtensions) {
+    size_t i = 0;
+    while (i < length && extension[i] != '\0' &&
+           asciiLower(suffix[i]) == extension[i])
+      ++i;
+    if (i == length && extension[i] == '\0')
+      return true;
+  }
+  return false;
+}
+} // namespace
+
+bool hasSupportedExtension(const char *fileName, size_t length) {
+  for (size_t i = length; i > 0; --i) {
+    if (fileName[i - 1] == '.')
+      return isSupportedSuffix(fileName + i, length - i);
+    if (fileName[i - 1] == '/')
+      return false;
+  }
+  return false;
+}
+
+bool hasSupportedExtension(const QString &filePath) {
+  const qsizetype dot = filePath.lastIndexOf(QLatin1Char('.'));
+  if (dot < 0 || filePath.indexOf(QLatin1Char('/'), dot) >= 0 ||
+      filePath.indexOf(QLatin1Char('\\'), dot) >= 0)
+    return false;
+  // 扩展名都是 ASCII，非 ASCII 后缀直接判定为不支持。
+  const qsizetype length = filePath.size() - dot - 1;
+  char suffix[8];
+  if (length <= 0 || length > static_cast<qsizetype>(sizeof(suffix)))
+    return false;
+  for (qsizetype i = 0; i < length; ++i) {
+    const char16_t c = filePath.at(dot + 1 + i).unicode();
+    if (c > 0x7f)
+      return false;
+    suffix[i] = static_cast<char>(c);
+  }
+  return isSupportedSuffix(suffix, static_cast<size_t>(length));
+}
+
+QStringList scanImageDirectory(const QString &directoryPath,
+                               bool includeSubdirectories,
+                               const std::atomic_bool *cancelFlag) {
+  QStringList foundFiles;
+  streamImageDirectory(directoryPath, includeSubdirectories, cancelFlag,
+                       [&foundFiles](const QStringList &batch) {
+                         foundFiles.append(batch);
+                       });
+  std::sort(foundFiles.begin(), foundFiles.end());
+  return foundFiles;
+}
+
+NameSortKeyCache::NameSortKeyCache() : m_collator(makeNameCollator()) {}
+
+void NameSortKeyCache::prepare(const QStringList &paths) {
+  QStringList missing;
+  for (const QString &path : paths) {
+    if (!m_keys.contains(path))
+      missing.append(path);
+  }
+  missing.removeDuplicates();
+  if (missing.isEmpty())
+    return;
+
+  // QCollator 的副本共享内部状态，不能跨线程使用，每个分块各建一个。
+  std::vector<std::optional<Keys>> computed(missing.size());
+  parallelForRanges(missing.size(), [&](qsizetype first, qsizetype last) {
+    QCollator collator = makeNameCollator();
+    for (qsizetype i = first; i < last; ++i) {
+      const QString &path = missing.at(i);
+      computed[i].emplace(Keys{collator.sortKey(QFileInfo(path).fileName()),
+                               collator.sortKey(path)});
+    }
+  });
+
+  m_keys.reserve(m_keys.size() + missing.size());
+  for (qsizetype i = 0; i < missing.size(); ++i)
+    m_keys.emplace(missing.at(i), std::move(*computed[i]));
+}
+
+const NameSortKeyCache::Keys &NameSortKeyCache::keys(const QString &path) {
+  auto it = m_keys.constFind(path);
+  if (it == m_keys.constEnd()) {
+    it = m_keys.emplace(path,
+                        Keys{m_collator.sortKey(QFileInfo(path).fileName()),
+                             m_collator.sortKey(path)});
+  }
+  return it.value();
+}
+
+void NameSortKeyCache::clear() { m_keys.clear(); }
+
+void sortImagesByName(QStringList &entries, bool ascending,
+                      NameSortKeyCache *cache) {
+  if (entries.size() < 2)
+    return;
+
+  NameSortKeyCache localCache;
+  NameSortKeyCache &keyCache = cache ? *cache : localCache;
+  keyCache.prepare(entries);
+
+  struct NameEntry {
+    QString path;
+    const NameSortKeyCache::Keys *keys;
+  };
+
+  std::vector<NameEntry> data;
+  data.reserve(entries.size());
+  for (const QString &path : entries) {
+    data.push_back(NameEntry{path, &keyCache.keys(path)});
+  }
+
+  parallelStableSort(data, [ascending](const NameEntry &left,
+                                       const NameEntry &right) {
+    int cmp = left.keys->fileName.compare(right.keys->fileName);
+    if (cmp == 0) {
+      cmp = left.keys->path.compare(right.keys->path);
+    }
+    if (cmp == 0)
+      return false;
+    return ascending ? cmp < 0 : cmp > 0;
+  });
+
+  for (int i = 0; i < static_cast<int>(data.size()); ++i) {
+    entries[i] = data.at(i).path;
+  }
+}
+
+void sortImagesByTime(QStringList &entries, bool newestFirst,
+                      FileMetadataCache *metadata) {
+  if (entries.size() < 2)
+    return;
+
+  FileMetadataCache localCache;
+  FileMetadataCache &cache = metadata ? *metadata : localCache;
+  cache.ensure(entries);
+
+  struct TimeEntry {
+    QString path;
+    qint64 timestamp;
+  };
+
+  std::vector<TimeEntry> data;
+  data.reserve(entries.size());
+  for (const QString &path : entries) {
+    data.push_back(TimeEntry{path, cache.metadata(path).modifiedMsecs});
+  }
+
+  parallelStableSort(
+      data, [newestFirst](const TimeEntry &left, const TimeEntry &right) {
+        if (left.timestamp == right.timestamp) {
+          return left.path < right.path;
+        }
+        return newestFirst ? left.timestamp > right.timestamp
+                           : left.timestamp < right.timestamp;
+      });
+
+  for (int i = 0; i < static_cast<int>(data.size()); ++i) {
+    entries[i] = data.at(i).path;
+  }
+}
+
+ImageLessThan imageNameLessThan(bool ascending, NameSortKeyCache *cache) {
+  return [ascending, cache](const QString &left, const QString &right) {
+    // 取右侧的键可能插入新条目并使左侧引用失效，所以左侧最后再取一次。
+    cache->keys(left);
+    const NameSortKeyCache::Keys &rightKeys = cache->keys(right);
+    const NameSortKeyCache::Keys &leftKeys = cache->keys(left);
+    int cmp = leftKeys.fileName.compare(rightKeys.fileName);
+    if (cmp == 0) {
+      cmp = leftKeys.path.compare(rightKeys.path);
+    }
+    if (cmp == 0)
+      return false;
+    return ascending ? cmp < 0 : cmp > 0;
+  };
+}
+
+ImageLessThan imageTimeLessThan(bool newestFirst, FileMetadataCache *metadata) {
+  const auto timestamp = [metadata](const QString &path) {
+    return metadata->metadata(path).modifiedMsecs;
+  };
+  return [newestFirst, timestamp](const QString &left, const QString &right) {
+    const qint64 leftStamp = timestamp(left);
+    const qint64 rightStamp = timestamp(right);
+    if (leftStamp == rightStamp) {
+      return left < right;
+    }
+    return newestFirst ? leftStamp > rightStamp : leftStamp < rightStamp;
+  };
+}
+
+QPageSize pageSizeFromName(const QString &pageName) {
+  const QString key = pageName.trimmed().toUpper();
+  if (key == QLatin1String("A3")) {
+    return QPageSize(QPageSize::A3);
+  }
+  if (key == QLatin1String("A5")) {
+    return QPageSize(QPageSize::A5);
+  }
+  if (key == QLatin1String("LETTER")) {
+    return QPageSize(QPageSize::Letter);
+  }
+  if (key == QLatin1String("LEGAL")) {
+    return QPageSize(QPageSize::Legal);
+  }
+  if (key == QLatin1String("B5")) {
+    return QPageSize(QPageSize::B5);
+  }
+  if (key == QLatin1String("TABLOID")) {
+    return QPageSize(QPageSize::Tabloid);
+  }
+  return QPageSize(QPageSize::A4);
+}
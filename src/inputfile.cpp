@@ -0,0 +1,130 @@
+#include "inputfile.h"
+#include "conversiontrace.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+#include <climits>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedInputFile::MappedInputFile(const QString &filePath)
+    : m_file(filePath), m_mapped(false) {}
+
+bool MappedInputFile::open() {
+  if (!m_file.open(QIODevice::ReadOnly))
+    return false;
+  const qint64 size = m_file.size();
+  if (size > 0) {
+    if (uchar *address = m_file.map(0, size)) {
+      m_data = QByteArray::fromRawData(reinterpret_cast<const char *>(address),
+                                       static_cast<qsizetype>(size));
+      m_mapped = true;
+      return true;
+    }
+  }
+  m_data = m_file.readAll();
+  return true;
+}
+
+qint64 adviseWillNeed(const QString &filePath, qint64 maxBytes) {
+#if defined(Q_OS_UNIX)
+  const int fd = ::open(QFile::encodeName(filePath).constData(),
+                        O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  qint64 length = 0;
+  struct stat info;
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    length = std::min<qint64>(info.st_size, maxBytes);
+  if (length > 0) {
+#if defined(Q_OS_DARWIN)
+    struct radvisory advice;
+    advice.ra_offset = 0;
+    advice.ra_count = static_cast<int>(std::min<qint64>(length, INT_MAX));
+    if (::fcntl(fd, F_RDADVISE, &advice) == -1)
+      length = 0;
+#elif defined(POSIX_FADV_WILLNEED)
+    // 文件关闭后预读仍会继续，页缓存按文件而不是文件描述符保存。
+    if (::posix_fadvise(fd, 0, static_cast<off_t>(length),
+                        POSIX_FADV_WILLNEED) != 0)
+      length = 0;
+#else
+    length = 0;
+#endif
+  }
+  ::close(fd);
+  return length;
+#else
+  Q_UNUSED(filePath);
+  Q_UNUSED(maxBytes);
+  return 0;
+#endif
+}
+
+InputReadahead::InputReadahead(const QStringList &files, int firstFile,
+                               int fileCount, int maxFiles, qint64 maxBytes,
+                               ConversionTrace *trace)
+    : m_files(files), m_end(firstFile + fileCount),
+      m_maxFiles(std::max(0, maxFiles)),
+      m_maxBytes(std::max<qint64>(0, maxBytes)), m_trace(trace),
+      m_current(firstFile - 1), m_nextHint(firstFile), m_hintedBytes(0),
+      m_running(false), m_stopping(false) {
+  m_pool.setMaxThreadCount(1);
+}
+
+InputReadahead::~InputReadahead() {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+  }
+  m_pool.waitForDone();
+}
+
+void InputReadahead::advance(int index) {
+  if (m_maxFiles == 0 || m_maxBytes == 0)
+    return;
+  QMutexLocker locker(&m_mutex);
+  m_current = std::max(m_current, index);
+  if (m_running || m_stopping)
+    return;
+  m_running = true;
+  m_pool.start([this]() { issue(); });
+}
+
+void InputReadahead::issue() {
+  for (;;) {
+    int next = 0;
+    qint64 budget = 0;
+    {
+      QMutexLocker locker(&m_mutex);
+      // 已经开始解码的文件由解码线程自己读取，不再占用额度。
+      while (!m_hinted.empty() && m_hinted.front().first <= m_current) {
+        m_hintedBytes -= m_hinted.front().second;
+        m_hinted.pop_front();
+      }
+      m_nextHint = std::max(m_nextHint, m_current + 1);
+      budget = m_maxBytes - m_hintedBytes;
+      if (m_stopping || m_nextHint >= m_end ||
+          m_nextHint > m_current + m_maxFiles || budget <= 0) {
+        m_running = false;
+        return;
+      }
+      next = m_nextHint++;
+    }
+
+    // 超出额度的大文件只预读开头一段，解码时其余部分照常按需读取。
+    qint64 advised = 0;
+    {
+      TraceScope scope(m_trace, TraceStage::Readahead, next);
+      advised = adviseWillNeed(m_files.at(next), budget);
+      scope.setBytes(advised);
+    }
+    QMutexLocker locker(&m_mutex);
+    m_hinted.emplace_back(next, advised);
+    m_hintedBytes += advised;
+  }
+}
@@ -0,0 +1,337 @@
+#include "jobqueue.h"
+
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+// 每个任务按页数申请解码线程：少量页面的任务只占一个线程，
+// 这样一批小任务可以同时运行，把所有核心用满。
+constexpr int kPagesPerThread = 8;
+constexpr qint64 kDefaultMemoryBudget = 2048LL * 1024 * 1024;
+// 文件大小未知时按这个大小估计。
+constexpr qint64 kUnknownInputBytes = 8LL * 1024 * 1024;
+// 解码后的像素大约是压缩文件的这么多倍（照片类 JPEG 常见 1:8 到 1:10）。
+constexpr int kDecodeExpansion = 8;
+
+qint64 largestInput(const QList<qint64> &sizes) {
+  qint64 largest = -1;
+  for (qint64 size : sizes)
+    largest = std::max(largest, size);
+  return largest > 0 ? largest : kUnknownInputBytes;
+}
+
+// 解码中的页面每线程一张展开的图像，另有约两倍线程数的已编码页面在窗口中
+// 等待写入。
+qint64 estimateMemory(qint64 largestInputBytes, int threads) {
+  return qint64(threads) * largestInputBytes * (kDecodeExpansion + 2);
+}
+
+bool isActive(ConversionJobQueue::JobState state) {
+  return state == ConversionJobQueue::Queued ||
+         state == ConversionJobQueue::Running;
+}
+} // namespace
+
+ConversionJobQueue::ConversionJobQueue(QObject *parent)
+    : QAbstractListModel(parent), m_nextJobId(1),
+      m_threadBudget(std::max(1, QThread::idealThreadCount())),
+      m_threadsInUse(0), m_memoryBudget(kDefaultMemoryBudget),
+      m_memoryInUse(0) {
+  m_writerPool.setMaxThreadCount(m_threadBudget);
+}
+
+ConversionJobQueue::~ConversionJobQueue() {
+  // 析构时不再发出信号，只让正在运行的任务尽快停下并等待。
+  for (const auto &job : m_jobs) {
+    if (job->converter)
+      job->converter->cancel();
+  }
+  m_writerPool.waitForDone();
+}
+
+int ConversionJobQueue::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid())
+    return 0;
+  return static_cast<int>(m_jobs.size());
+}
+
+QVariant ConversionJobQueue::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= static_cast<int>(m_jobs.size()))
+    return QVariant();
+
+  const Job &job = *m_jobs[index.row()];
+  switch (role) {
+  case JobIdRole:
+    return job.id;
+  case Qt::DisplayRole:
+  case TitleRole:
+    return job.title;
+  case StateRole:
+    return job.state;
+  case ProgressRole:
+    return job.files.isEmpty()
+               ? 0.0
+               : static_cast<double>(job.pagesDone) / job.files.size();
+  case StatusRole:
+    return job.status;
+  case PageCountRole:
+    return static_cast<int>(job.files.size());
+  case ThreadsRole:
+    return job.threads;
+  }
+  return QVariant();
+}
+
+QHash<int, QByteArray> ConversionJobQueue::roleNames() const {
+  QHash<int, QByteArray> roles;
+  roles[JobIdRole] = "jobId";
+  roles[TitleRole] = "title";
+  roles[StateRole] = "jobState";
+  roles[ProgressRole] = "progress";
+  roles[StatusRole] = "status";
+  roles[PageCountRole] = "pageCount";
+  roles[ThreadsRole] = "threads";
+  return roles;
+}
+
+int ConversionJobQueue::enqueue(QStringList files, QList<qint64> knownSizes,
+                                ConversionOptions options) {
+  auto job = std::make_unique<Job>();
+  job->id = m_nextJobId++;
+  job->title = QFileInfo(options.outputFile).fileName();
+  job->files = std::move(files);
+  job->knownSizes = std::move(knownSizes);
+  job->options = std::move(options);
+  // 只按文件名推算，不像 planVolumes 那样对大小未知的文件做 stat：
+  // 这里在界面线程上。
+  job->outputs =
+      plannedOutputs(job->options, static_cast<int>(job->files.size()));
+  job->status = QStringLiteral("排队中");
+  const int id = job->id;
+
+  const int row = static_cast<int>(m_jobs.size());
+  beginInsertRows(QModelIndex(), row, row);
+  m_jobs.push_back(std::move(job));
+  endInsertRows();
+
+  emit activeCountChanged();
+  schedule();
+  emit progressChanged();
+  return id;
+}
+
+void ConversionJobQueue::cancelJob(int jobId) {
+  const int row = rowOf(jobId);
+  if (row < 0)
+    return;
+  Job &job = *m_jobs[row];
+  if (job.state == Running) {
+    job.converter->cancel();
+    job.status = QStringLiteral("正在取消…");
+    notifyRow(row);
+    return;
+  }
+  if (job.state != Queued)
+    return;
+
+  job.state = Cancelled;
+  job.status = QStringLiteral("已取消");
+  notifyRow(row);
+  ConversionResult result;
+  result.cancelled = true;
+  result.errorText = QStringLiteral("转换已取消。");
+  emit jobFinished(job.id, job.title, result, QVariantMap());
+  emit activeCountChanged();
+  emit progressChanged();
+}
+
+void ConversionJobQueue::removeFinishedJobs() {
+  for (int row = static_cast<int>(m_jobs.size()) - 1; row >= 0; --row) {
+    if (isActive(m_jobs[row]->state))
+      continue;
+    beginRemoveRows(QModelIndex(), row, row);
+    m_jobs.erase(m_jobs.begin() + row);
+    endRemoveRows();
+  }
+}
+
+void ConversionJobQueue::cancelAll() {
+  // 先取消排队中的任务，免得运行中的任务结束后又调度起新的任务。
+  std::vector<int> running;
+  for (const auto &job : m_jobs) {
+    if (job->state == Queued)
+      cancelJob(job->id);
+    else if (job->state == Running)
+      running.push_back(job->id);
+  }
+  for (int jobId : running)
+    cancelJob(jobId);
+}
+
+int ConversionJobQueue::activeCount() const {
+  return static_cast<int>(
+      std::count_if(m_jobs.cbegin(), m_jobs.cend(),
+                    [](const auto &job) { return isActive(job->state); }));
+}
+
+double ConversionJobQueue::progress() const {
+  qint64 pages = 0;
+  qint64 done = 0;
+  for (const auto &job : m_jobs) {
+    if (!isActive(job->state))
+      continue;
+    pages += job->files.size();
+    done += job->pagesDone;
+  }
+  return pages > 0 ? static_cast<double>(done) / pages : 0.0;
+}
+
+void ConversionJobQueue::setMemoryBudget(qint64 bytes) {
+  m_memoryBudget = std::max<qint64>(1, bytes);
+  schedule();
+}
+
+int ConversionJobQueue::rowOf(int jobId) const {
+  for (size_t row = 0; row < m_jobs.size(); ++row) {
+    if (m_jobs[row]->id == jobId)
+      return static_cast<int>(row);
+  }
+  return -1;
+}
+
+// 是否有运行中的任务正在写这个任务要写的某个文件。两个任务同时写同一个
+// 文件时，追加会把文件写坏，覆盖则只留下后完成的那个。
+bool ConversionJobQueue::writesRunningOutput(const Job &job) const {
+  for (const auto &other : m_jobs) {
+    if (other->state != Running)
+      continue;
+    if (outputsOverlap(job.outputs, other->outputs))
+      return true;
+  }
+  return false;
+}
+
+// 严格按入队顺序启动：队首的任务放不下时后面的任务也不越过它，
+// 大任务不会因为小任务源源不断而一直等待。要写的文件正被运行中的任务
+// 写入时同样等待，同一文件上的多次追加因此按入队顺序依次进行。
+void ConversionJobQueue::schedule() {
+  for (const auto &pointer : m_jobs) {
+    Job &job = *pointer;
+    if (job.state != Queued)
+      continue;
+    if (writesRunningOutput(job))
+      return;
+    const int freeThreads = m_threadBudget - m_threadsInUse;
+    if (freeThreads <= 0)
+      return;
+
+    const int pages = static_cast<int>(job.files.size());
+    const int wanted = std::clamp(
+        (pages + kPagesPerThread - 1) / kPagesPerThread, 1, m_threadBudget);
+    int threads = std::min(wanted, freeThreads);
+    const qint64 largest = largestInput(job.knownSizes);
+    // 内存不够时先减少线程；没有其它任务在运行时至少以一个线程启动。
+    while (threads > 1 &&
+           m_memoryInUse + estimateMemory(largest, threads) > m_memoryBudget)
+      --threads;
+    if (m_threadsInUse > 0 &&
+        m_memoryInUse + estimateMemory(largest, threads) > m_memoryBudget)
+      return;
+    startJob(job, threads);
+  }
+}
+
+void ConversionJobQueue::startJob(Job &job, int threads) {
+  job.state = Running;
+  job.threads = threads;
+  job.memoryEstimate = estimateMemory(largestInput(job.knownSizes), threads);
+  job.status = QStringLiteral("正在转换…");
+  m_threadsInUse += threads;
+  m_memoryInUse += job.memoryEstimate;
+
+  ConversionOptions options = job.options;
+  options.decodeThreads = threads;
+  job.trace = std::make_unique<ConversionTrace>();
+  job.converter = std::make_unique<PdfConverter>(job.files, options);
+  job.converter->setKnownFileSizes(job.knownSizes);
+  job.converter->setTrace(job.trace.get());
+  const int jobId = job.id;
+  connect(
+      job.converter.get(), &PdfConverter::pageProcessed, this,
+      [this, jobId](int index, int total, const QString &fileName) {
+        handleJobPageProcessed(jobId, index, total, fileName);
+      },
+      Qt::QueuedConnection);
+
+  job.watcher = std::make_unique<QFutureWatcher<ConversionResult>>();
+  connect(job.watcher.get(), &QFutureWatcher<ConversionResult>::finished, this,
+          [this, jobId]() { handleJobFinished(jobId); });
+  PdfConverter *converter = job.converter.get();
+  job.watcher->setFuture(QtConcurrent::run(
+      &m_writerPool, [converter]() { return converter->run(); }));
+  notifyRow(rowOf(jobId));
+}
+
+void ConversionJobQueue::handleJobPageProcessed(int jobId, int index,
+                                                int total,
+                                                const QString &fileName) {
+  const int row = rowOf(jobId);
+  if (row < 0 || m_jobs[row]->state != Running)
+    return;
+  Job &job = *m_jobs[row];
+  job.pagesDone = std::max(job.pagesDone, index + 1);
+  job.status = tr("正在处理第 %1/%2 张：%3")
+                   .arg(index + 1)
+                   .arg(std::max(1, total))
+                   .arg(fileName);
+  notifyRow(row);
+  emit progressChanged();
+}
+
+void ConversionJobQueue::handleJobFinished(int jobId) {
+  const int row = rowOf(jobId);
+  if (row < 0)
+    return;
+  Job &job = *m_jobs[row];
+  const ConversionResult result = job.watcher->result();
+  const QVariantMap performance = job.trace->summary().toVariantMap();
+
+  m_threadsInUse -= job.threads;
+  m_memoryInUse -= job.memoryEstimate;
+  job.threads = 0;
+  job.memoryEstimate = 0;
+  // 正处于 finished 信号中，观察器稍后再删除。
+  job.watcher.release()->deleteLater();
+  job.converter.reset();
+  job.trace.reset();
+
+  if (result.success) {
+    job.state = Finished;
+    job.pagesDone = static_cast<int>(job.files.size());
+    job.status = result.failedFiles.isEmpty()
+                     ? tr("已完成，共 %1 页").arg(result.convertedPages)
+                     : tr("已完成，共 %1 页，跳过 %2 个文件")
+                           .arg(result.convertedPages)
+                           .arg(result.failedFiles.size());
+  } else if (result.cancelled) {
+    job.state = Cancelled;
+    job.status = QStringLiteral("已取消");
+  } else {
+    job.state = Failed;
+    job.status = result.errorText;
+  }
+  notifyRow(row);
+
+  emit jobFinished(jobId, job.title, result, performance);
+  schedule();
+  emit activeCountChanged();
+  emit progressChanged();
+}
+
+void ConversionJobQueue::notifyRow(int row) {
+  if (row < 0)
+    return;
+  emit dataChanged(index(row), index(row));
+}
@@ -1,11 +1,48 @@
 #include "backend.h"
+#include "commandline.h"
+#include "thumbnailprovider.h"
+#include <QCoreApplication>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQmlEngine>
 #include <QQuickStyle>
 
+#if defined(Q_OS_WIN)
+#define NOMINMAX
+#include <cstdio>
+#include <windows.h>
+
+namespace {
+// 程序以 WIN32 子系统链接，从 cmd 或 PowerShell 启动时没有控制台，命令行
+// 模式的输出会全部丢失。附加到父进程的控制台并重新打开标准输出；已被重定向
+// 到文件或管道的句柄保持不变。
+void attachParentConsole() {
+  if (!AttachConsole(ATTACH_PARENT_PROCESS))
+    return;
+  const auto unattached = [](DWORD handle) {
+    const HANDLE current = GetStdHandle(handle);
+    return current == nullptr || current == INVALID_HANDLE_VALUE;
+  };
+  if (unattached(STD_OUTPUT_HANDLE))
+    std::freopen("CONOUT$", "w", stdout);
+  if (unattached(STD_ERROR_HANDLE))
+    std::freopen("CONOUT$", "w", stderr);
+}
+} // namespace
+#endif
+
 int main(int argc, char *argv[]) {
+  if (isCommandLineInvocation(argc, argv)) {
+#if defined(Q_OS_WIN)
+    attachParentConsole();
+#endif
+    // 命令行模式只需要 QCoreApplication，不创建窗口也不加载 QML 引擎。
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("images2pdf-qt"));
+    return runCommandLine(app.arguments());
+  }
+
   qputenv("QT_SCALE_FACTOR", "0.75");
   QGuiApplication app(argc, argv);
   QQuickStyle::setStyle("Material");
@@ -16,6 +53,9 @@ int main(int argc, char *argv[]) {
   Backend backend;
   QQmlApplicationEngine engine;
   engine.rootContext()->setContextProperty("backend", &backend);
+  // 引擎接管提供器的所有权；backend 先于引擎构造，析构时仍然有效。
+  engine.addImageProvider(QStringLiteral("thumbnail"),
+                          new ThumbnailProvider(backend.metadataCache()));
 
   // To handle failure to load
   QObject::connect(
@@ -0,0 +1,318 @@
+#include "pdfdocument.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+constexpr int kCatalogObject = 1;
+constexpr int kPagesObject = 2;
+
+QByteArray formatNumber(double value) {
+  QByteArray text = QByteArray::number(value, 'f', 3);
+  while (text.endsWith('0'))
+    text.chop(1);
+  if (text.endsWith('.'))
+    text.chop(1);
+  return text.isEmpty() || text == "-" ? QByteArray("0") : text;
+}
+
+QByteArray colorSpaceName(int components) {
+  switch (components) {
+  case 1:
+    return QByteArrayLiteral("/DeviceGray");
+  case 4:
+    return QByteArrayLiteral("/DeviceCMYK");
+  default:
+    return QByteArrayLiteral("/DeviceRGB");
+  }
+}
+} // namespace
+
+PdfDocument::PdfDocument(const QString &filePath)
+    : m_file(filePath), m_appendFile(filePath), m_appending(false),
+      m_finished(false), m_baseOffset(0), m_pagesObject(kPagesObject),
+      m_bytesWritten(0) {}
+
+PdfDocument::~PdfDocument() {
+  // 新建的文件由 QSaveFile 自动丢弃；追加未完成时去掉写了一半的更新。
+  if (m_appending && !m_finished && m_appendFile.isOpen())
+    m_appendFile.resize(m_base.fileSize);
+}
+
+bool PdfDocument::open() {
+  if (!m_file.open(QIODevice::WriteOnly)) {
+    m_errorString = m_file.errorString();
+    return false;
+  }
+  // 对象 0 为空闲链表头，1、2 预留给目录与页面树。
+  m_offsets.assign(kPagesObject + 1, 0);
+  m_pageObjects.clear();
+  m_bytesWritten = 0;
+  return write(QByteArrayLiteral("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n"));
+}
+
+bool PdfDocument::openForAppend(const PdfAppendBase &base) {
+  m_appending = true;
+  m_base = base;
+  if (!m_appendFile.open(QIODevice::ReadWrite)) {
+    m_errorString = m_appendFile.errorString();
+    return false;
+  }
+  // 文件在读取之后被改动过时不能接着写。
+  if (m_appendFile.size() != base.fileSize ||
+      !m_appendFile.seek(base.fileSize)) {
+    m_errorString = QStringLiteral("文件在读取后被修改。");
+    m_appendFile.close();
+    return false;
+  }
+  // 新对象从原 /Size 开始编号，之前的编号只占位。
+  m_offsets.assign(static_cast<size_t>(base.size), 0);
+  m_pageObjects.clear();
+  m_pagesObject = base.pagesObject;
+  m_baseOffset = base.fileSize;
+  m_bytesWritten = 0;
+  // 原文件末尾可能没有换行，保证新对象从新的一行开始。
+  m_appendFile.seek(base.fileSize - 1);
+  const QByteArray last = m_appendFile.read(1);
+  m_appendFile.seek(base.fileSize);
+  return last == "\n" || last == "\r" || write(QByteArrayLiteral("\n"));
+}
+
+int PdfDocument::addImage(const PdfImage &image) {
+  if (image.isNull() || image.width <= 0 || image.height <= 0)
+    return 0;
+
+  const int number = allocateObject();
+  QByteArray colorSpace = colorSpaceName(image.components);
+  if (!image.palette.isEmpty()) {
+    const qsizetype entries =
+        image.palette.size() / std::max(1, image.components);
+    colorSpace = "[/Indexed " + colorSpace + " " +
+                 QByteArray::number(entries - 1) + " <" +
+                 image.palette.toHex() + ">]";
+  }
+  QByteArray header = "<< /Type /XObject /Subtype /Image /Width " +
+                      QByteArray::number(image.width) + " /Height " +
+                      QByteArray::number(image.height) + " /ColorSpace " +
+                      colorSpace + " /BitsPerComponent " +
+                      QByteArray::number(image.bitsPerComponent);
+  if (!image.filter.isEmpty())
+    header += " /Filter /" + image.filter;
+  if (!image.decodeParms.isEmpty())
+    header += " /DecodeParms " + image.decodeParms;
+  if (!image.decodeArray.isEmpty())
+    header += " /Decode " + image.decodeArray;
+  header += " /Length " + QByteArray::number(image.data.size()) +
+            " >>\nstream\n";
+
+  if (!beginObject(number) || !write(header) || !write(image.data) ||
+      !write(QByteArrayLiteral("\nendstream\nendobj\n")))
+    return 0;
+  return number;
+}
+
+bool PdfDocument::addPage(const QSizeF &pageSize, const QRectF &imageRect,
+                          int imageObject) {
+  if (imageObject <= 0)
+    return false;
+
+  // PDF 坐标原点在左下角，这里把左上角原点的矩形翻转过来。
+  const double bottom = pageSize.height() - imageRect.bottom();
+  const QByteArray content = "q " + formatNumber(imageRect.width()) +
+                             " 0 0 " + formatNumber(imageRect.height()) + " " +
+                             formatNumber(imageRect.left()) + " " +
+                             formatNumber(bottom) + " cm /Im0 Do Q\n";
+
+  const int contentObject = allocateObject();
+  if (!beginObject(contentObject) ||
+      !write("<< /Length " + QByteArray::number(content.size()) +
+             " >>\nstream\n" + content + "endstream\nendobj\n"))
+    return false;
+
+  const int pageObject = allocateObject();
+  const QByteArray page =
+      "<< /Type /Page /Parent " + QByteArray::number(m_pagesObject) + " " +
+      QByteArray::number(m_appending ? m_base.pagesGeneration : 0) +
+      " R /MediaBox [0 0 " + formatNumber(pageSize.width()) + " " +
+      formatNumber(pageSize.height()) +
+      "] /Resources << /XObject << /Im0 " + QByteArray::number(imageObject) +
+      " 0 R >> >> /Contents " + QByteArray::number(contentObject) +
+      " 0 R >>\nendobj\n";
+  if (!beginObject(pageObject) || !write(page))
+    return false;
+
+  m_pageObjects.push_back(pageObject);
+  return true;
+}
+
+bool PdfDocument::finish() {
+  if (m_appending)
+    return finishAppend();
+
+  QByteArray kids;
+  for (int object : m_pageObjects) {
+    kids += QByteArray::number(object) + " 0 R ";
+  }
+  if (!beginObject(kPagesObject) ||
+      !write("<< /Type /Pages /Kids [" + kids.trimmed() + "] /Count " +
+             QByteArray::number(static_cast<qint64>(m_pageObjects.size())) +
+             " >>\nendobj\n"))
+    return false;
+
+  if (!beginObject(kCatalogObject) ||
+      !write("<< /Type /Catalog /Pages " + QByteArray::number(kPagesObject) +
+             " 0 R >>\nendobj\n"))
+    return false;
+
+  const qint64 xrefOffset = m_bytesWritten;
+  QByteArray xref = "xref\n0 " +
+                    QByteArray::number(static_cast<qint64>(m_offsets.size())) +
+                    "\n0000000000 65535 f \n";
+  xref.reserve(xref.size() + static_cast<qsizetype>(m_offsets.size()) * 20);
+  char entry[32];
+  for (size_t i = 1; i < m_offsets.size(); ++i) {
+    std::snprintf(entry, sizeof(entry), "%010lld 00000 n \n",
+                  static_cast<long long>(m_offsets[i]));
+    xref += entry;
+  }
+  xref += "trailer\n<< /Size " +
+          QByteArray::number(static_cast<qint64>(m_offsets.size())) +
+          " /Root " + QByteArray::number(kCatalogObject) +
+          " 0 R >>\nstartxref\n" + QByteArray::number(xrefOffset) +
+          "\n%%EOF\n";
+  if (!write(xref))
+    return false;
+
+  if (!m_file.commit()) {
+    m_errorString = m_file.errorString();
+    return false;
+  }
+  return true;
+}
+
+// 增量更新：改写页面树根节点（沿用原对象号与代数），交叉引用只列出改写与
+// 新增的对象，/Prev 指向原来的交叉引用。目录不变，仍指向同一个根节点。
+bool PdfDocument::finishAppend() {
+  QByteArray kids;
+  for (int object : m_pageObjects)
+    kids += QByteArray::number(object) + " 0 R ";
+  QByteArray pages;
+  if (!extendPagesDictionary(m_base.pagesDictionary, kids.trimmed(),
+                             static_cast<int>(m_pageObjects.size()), &pages)) {
+    m_errorString = QStringLiteral("现有 PDF 的页面树格式不受支持。");
+    return false;
+  }
+  const qint64 pagesOffset = m_baseOffset + m_bytesWritten;
+  if (!beginObject(m_pagesObject, m_base.pagesGeneration) ||
+      !write(pages + "\nendobj\n"))
+    return false;
+
+  QByteArray trailer = " /Root " + m_base.rootReference + " /Prev " +
+                       QByteArray::number(m_base.startXref);
+  if (!m_base.infoReference.isEmpty())
+    trailer += " /Info " + m_base.infoReference;
+  if (!m_base.idArray.isEmpty())
+    trailer += " /ID " + m_base.idArray;
+
+  const int firstNew = m_base.size;
+  if (m_base.usesXrefStream) {
+    // 原文件使用交叉引用流时也写交叉引用流（不压缩），兼容只认流的读取器。
+    const int xrefObject = allocateObject();
+    const qint64 xrefOffset = m_baseOffset + m_bytesWritten;
+    m_offsets[xrefObject] = xrefOffset;
+    const int newCount = static_cast<int>(m_offsets.size()) - firstNew;
+    QByteArray entries;
+    const auto appendEntry = [&entries](qint64 offset, int generation) {
+      char entry[11];
+      entry[0] = 1;
+      for (int b = 0; b < 8; ++b)
+        entry[1 + b] = static_cast<char>((offset >> (8 * (7 - b))) & 0xFF);
+      entry[9] = static_cast<char>((generation >> 8) & 0xFF);
+      entry[10] = static_cast<char>(generation & 0xFF);
+      entries.append(entry, sizeof(entry));
+    };
+    appendEntry(pagesOffset, m_base.pagesGeneration);
+    for (size_t i = firstNew; i < m_offsets.size(); ++i)
+      appendEntry(m_offsets[i], 0);
+    const QByteArray header =
+        QByteArray::number(xrefObject) +
+        " 0 obj\n<< /Type /XRef /Size " +
+        QByteArray::number(static_cast<qint64>(m_offsets.size())) +
+        " /W [1 8 2] /Index [" + QByteArray::number(m_pagesObject) + " 1 " +
+        QByteArray::number(firstNew) + " " + QByteArray::number(newCount) +
+        "]" + trailer + " /Length " + QByteArray::number(entries.size()) +
+        " >>\nstream\n";
+    if (!write(header) || !write(entries) ||
+        !write("\nendstream\nendobj\nstartxref\n" +
+               QByteArray::number(xrefOffset) + "\n%%EOF\n"))
+      return false;
+  } else {
+    const qint64 xrefOffset = m_baseOffset + m_bytesWritten;
+    QByteArray xref;
+    char entry[32];
+    std::snprintf(entry, sizeof(entry), "%010lld %05d n \n",
+                  static_cast<long long>(pagesOffset), m_base.pagesGeneration);
+    xref += "xref\n" + QByteArray::number(m_pagesObject) + " 1\n" + entry;
+    xref += QByteArray::number(firstNew) + " " +
+            QByteArray::number(static_cast<qint64>(m_offsets.size()) -
+                               firstNew) +
+            "\n";
+    for (size_t i = firstNew; i < m_offsets.size(); ++i) {
+      std::snprintf(entry, sizeof(entry), "%010lld 00000 n \n",
+                    static_cast<long long>(m_offsets[i]));
+      xref += entry;
+    }
+    xref += "trailer\n<< /Size " +
+            QByteArray::number(static_cast<qint64>(m_offsets.size())) +
+            trailer + " >>\nstartxref\n" + QByteArray::number(xrefOffset) +
+            "\n%%EOF\n";
+    if (!write(xref))
+      return false;
+  }
+
+  if (!m_appendFile.flush()) {
+    m_errorString = m_appendFile.errorString();
+    return false;
+  }
+  m_finished = true;
+  m_appendFile.close();
+  return true;
+}
+
+int PdfDocument::pageCount() const {
+  return static_cast<int>(m_pageObjects.size());
+}
+
+qint64 PdfDocument::bytesWritten() const { return m_bytesWritten; }
+
+QString PdfDocument::errorString() const { return m_errorString; }
+
+int PdfDocument::allocateObject() {
+  m_offsets.push_back(0);
+  return static_cast<int>(m_offsets.size()) - 1;
+}
+
+bool PdfDocument::beginObject(int number, int generation) {
+  // 追加模式下原有对象的位置不会写进新的交叉引用，改写的页面树根节点由
+  // finishAppend 单独列出。
+  if (number < static_cast<int>(m_offsets.size()))
+    m_offsets[number] = m_baseOffset + m_bytesWritten;
+  return write(QByteArray::number(number) + " " +
+               QByteArray::number(generation) + " obj\n");
+}
+
+QFileDevice &PdfDocument::output() {
+  return m_appending ? static_cast<QFileDevice &>(m_appendFile) : m_file;
+}
+
+bool PdfDocument::write(const QByteArray &data) {
+  if (data.isEmpty())
+    return true;
+  QFileDevice &device = output();
+  if (device.write(data) != data.size()) {
+    m_errorString = device.errorString();
+    return false;
+  }
+  m_bytesWritten += data.size();
+  return true;
+}
@@ -0,0 +1,670 @@
+#include "pdfreader.h"
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+namespace {
+// startxref 应在文件最后 1024 字节内，多读一些兼容末尾带垃圾的文件。
+constexpr qint64 kTailBytes = 4096;
+constexpr qint64 kReadChunk = 64 * 1024;
+// 单个字典或 xref 表的上限，防止损坏的文件让读取无限增长。
+constexpr qint64 kMaxValueBytes = 64LL * 1024 * 1024;
+constexpr int kMaxReferenceDepth = 8;
+
+bool isWhite(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' ||
+         c == '\0';
+}
+
+bool isDelimiter(char c) {
+  return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' ||
+         c == ']' || c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+qsizetype skipWhite(const QByteArray &data, qsizetype pos) {
+  while (pos < data.size()) {
+    if (isWhite(data.at(pos))) {
+      ++pos;
+    } else if (data.at(pos) == '%') {
+      while (pos < data.size() && data.at(pos) != '\n' && data.at(pos) != '\r')
+        ++pos;
+    } else {
+      break;
+    }
+  }
+  return pos;
+}
+
+qsizetype skipToken(const QByteArray &data, qsizetype pos) {
+  while (pos < data.size() && !isWhite(data.at(pos)) &&
+         !isDelimiter(data.at(pos)))
+    ++pos;
+  return pos;
+}
+
+bool isInteger(const QByteArray &token) {
+  if (token.isEmpty())
+    return false;
+  for (char c : token) {
+    if (c < '0' || c > '9')
+      return false;
+  }
+  return true;
+}
+
+// 跳过从 pos 开始的一个值，返回其后的位置；数据不完整时返回 -1。
+// "12 0 R" 这样的间接引用作为一个值处理。
+qsizetype skipValue(const QByteArray &data, qsizetype pos) {
+  pos = skipWhite(data, pos);
+  if (pos >= data.size())
+    return -1;
+  const char c = data.at(pos);
+  if (c == '<' && pos + 1 < data.size() && data.at(pos + 1) == '<') {
+    pos += 2;
+    for (;;) {
+      pos = skipWhite(data, pos);
+      if (pos + 1 >= data.size())
+        return -1;
+      if (data.at(pos) == '>' && data.at(pos + 1) == '>')
+        return pos + 2;
+      pos = skipValue(data, pos);
+      if (pos < 0)
+        return -1;
+    }
+  }
+  if (c == '[') {
+    ++pos;
+    for (;;) {
+      pos = skipWhite(data, pos);
+      if (pos >= data.size())
+        return -1;
+      if (data.at(pos) == ']')
+        return pos + 1;
+      pos = skipValue(data, pos);
+      if (pos < 0)
+        return -1;
+    }
+  }
+  if (c == '(') {
+    int depth = 0;
+    for (; pos < data.size(); ++pos) {
+      const char ch = data.at(pos);
+      if (ch == '\\') {
+        ++pos;
+      } else if (ch == '(') {
+        ++depth;
+      } else if (ch == ')' && --depth == 0) {
+        return pos + 1;
+      }
+    }
+    return -1;
+  }
+  if (c == '<') {
+    const qsizetype end = data.indexOf('>', pos);
+    return end < 0 ? -1 : end + 1;
+  }
+  if (c == '/')
+    return skipToken(data, pos + 1);
+  if (isDelimiter(c))
+    return -1;
+
+  const qsizetype end = skipToken(data, pos);
+  // 数字后面紧跟“整数 R”时是间接引用。
+  if (isInteger(data.mid(pos, end - pos))) {
+    const qsizetype second = skipWhite(data, end);
+    const qsizetype secondEnd = skipToken(data, second);
+    if (secondEnd > second && isInteger(data.mid(second, secondEnd - second))) {
+      const qsizetype third = skipWhite(data, secondEnd);
+      if (third < data.size() && data.at(third) == 'R' &&
+          (third + 1 == data.size() || isWhite(data.at(third + 1)) ||
+           isDelimiter(data.at(third + 1))))
+        return third + 1;
+    }
+  }
+  return end;
+}
+
+// 在字典的第一层查找 key（如 "/Kids"），给出值的起止位置。
+bool findDictionaryValue(const QByteArray &dictionary, const QByteArray &key,
+                         qsizetype *start, qsizetype *end) {
+  qsizetype pos = skipWhite(dictionary, 0);
+  if (!dictionary.mid(pos, 2).startsWith("<<"))
+    return false;
+  pos += 2;
+  for (;;) {
+    pos = skipWhite(dictionary, pos);
+    if (pos >= dictionary.size() || dictionary.at(pos) != '/')
+      return false;
+    const qsizetype keyEnd = skipToken(dictionary, pos + 1);
+    const QByteArray name = dictionary.mid(pos, keyEnd - pos);
+    const qsizetype valueStart = skipWhite(dictionary, keyEnd);
+    const qsizetype valueEnd = skipValue(dictionary, valueStart);
+    if (valueEnd < 0)
+      return false;
+    if (name == key) {
+      *start = valueStart;
+      *end = valueEnd;
+      return true;
+    }
+    pos = valueEnd;
+  }
+}
+
+QByteArray dictionaryValue(const QByteArray &dictionary, const QByteArray &key) {
+  qsizetype start = 0;
+  qsizetype end = 0;
+  if (!findDictionaryValue(dictionary, key, &start, &end))
+    return QByteArray();
+  return dictionary.mid(start, end - start);
+}
+
+bool parseReference(const QByteArray &value, int *object, int *generation) {
+  const QList<QByteArray> parts = value.simplified().split(' ');
+  if (parts.size() != 3 || parts.at(2) != "R" || !isInteger(parts.at(0)) ||
+      !isInteger(parts.at(1)))
+    return false;
+  *object = parts.at(0).toInt();
+  *generation = parts.at(1).toInt();
+  return true;
+}
+
+QList<qint64> integerArray(const QByteArray &value) {
+  QList<qint64> numbers;
+  QByteArray inner = value.trimmed();
+  if (!inner.startsWith('[') || !inner.endsWith(']'))
+    return numbers;
+  inner = inner.mid(1, inner.size() - 2);
+  for (const QByteArray &part : inner.simplified().split(' ')) {
+    bool ok = false;
+    const qint64 number = part.toLongLong(&ok);
+    if (ok)
+      numbers.append(number);
+  }
+  return numbers;
+}
+
+QByteArray inflate(const QByteArray &data) {
+  // qUncompress 需要 4 字节的长度前缀；长度只是初始缓冲区大小，不够时会扩大。
+  QByteArray prefixed(4, '\0');
+  qToBigEndian<quint32>(
+      static_cast<quint32>(std::min<qint64>(data.size() * 4LL, 1 << 30)),
+      prefixed.data());
+  prefixed += data;
+  return qUncompress(prefixed);
+}
+
+// PNG 预测器（Predictor >= 10）：每行首字节是该行的过滤方式。
+QByteArray undoPngPredictor(const QByteArray &data, int columns, int colors,
+                            int bitsPerComponent) {
+  const int bytesPerPixel = std::max(1, colors * bitsPerComponent / 8);
+  const int rowBytes = (columns * colors * bitsPerComponent + 7) / 8;
+  if (rowBytes <= 0)
+    return QByteArray();
+  QByteArray output;
+  QByteArray previous(rowBytes, '\0');
+  for (qsizetype row = 0; row + rowBytes + 1 <= data.size();
+       row += rowBytes + 1) {
+    const int filter = static_cast<unsigned char>(data.at(row));
+    QByteArray current = data.mid(row + 1, rowBytes);
+    for (int i = 0; i < rowBytes; ++i) {
+      const int left =
+          i >= bytesPerPixel ? static_cast<unsigned char>(current[i - bytesPerPixel])
+                             : 0;
+      const int up = static_cast<unsigned char>(previous[i]);
+      const int upLeft =
+          i >= bytesPerPixel
+              ? static_cast<unsigned char>(previous[i - bytesPerPixel])
+              : 0;
+      int predictor = 0;
+      switch (filter) {
+      case 1:
+        predictor = left;
+        break;
+      case 2:
+        predictor = up;
+        break;
+      case 3:
+        predictor = (left + up) / 2;
+        break;
+      case 4: {
+        const int estimate = left + up - upLeft;
+        const int distanceLeft = std::abs(estimate - left);
+        const int distanceUp = std::abs(estimate - up);
+        const int distanceUpLeft = std::abs(estimate - upLeft);
+        predictor = distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft
+                        ? left
+                    : distanceUp <= distanceUpLeft ? up
+                                                   : upLeft;
+        break;
+      }
+      default:
+        break;
+      }
+      current[i] = static_cast<char>(
+          (static_cast<unsigned char>(current[i]) + predictor) & 0xFF);
+    }
+    output += current;
+    previous = current;
+  }
+  return output;
+}
+
+struct XrefEntry {
+  // 1 = 普通对象（offset 为文件偏移），2 = 位于对象流 offset 中的第 index 个。
+  int type = 0;
+  qint64 offset = 0;
+  int generation = 0;
+  int index = 0;
+};
+
+class PdfFileReader {
+public:
+  explicit PdfFileReader(const QString &filePath) : m_file(filePath) {}
+
+  bool open() {
+    if (!m_file.open(QIODevice::ReadOnly))
+      return false;
+    m_size = m_file.size();
+    return true;
+  }
+
+  qint64 size() const { return m_size; }
+
+  QByteArray readAt(qint64 offset, qint64 length) {
+    if (offset < 0 || offset >= m_size || !m_file.seek(offset))
+      return QByteArray();
+    return m_file.read(std::min(length, m_size - offset));
+  }
+
+  // 从 offset 开始读取足以包含一个完整值（及其前面的 prefix 部分）的数据；
+  // parse 返回值的结束位置或 -1。
+  template <typename Parse>
+  bool readComplete(qint64 offset, QByteArray *data, qsizetype *end,
+                    Parse parse) {
+    for (qint64 length = kReadChunk;; length *= 2) {
+      *data = readAt(offset, length);
+      *end = parse(*data);
+      if (*end >= 0 && *end < data->size())
+        return true;
+      if (offset + data->size() >= m_size)
+        return *end >= 0;
+      if (length >= kMaxValueBytes)
+        return false;
+    }
+  }
+
+  qint64 findStartXref() {
+    const qint64 tailOffset = std::max<qint64>(0, m_size - kTailBytes);
+    const QByteArray tail = readAt(tailOffset, kTailBytes);
+    const qsizetype keyword = tail.lastIndexOf("startxref");
+    if (keyword < 0)
+      return -1;
+    const qsizetype start = skipWhite(tail, keyword + 9);
+    const qsizetype end = skipToken(tail, start);
+    bool ok = false;
+    const qint64 offset = tail.mid(start, end - start).toLongLong(&ok);
+    return ok ? offset : -1;
+  }
+
+  // 从最新的一节开始沿 /Prev 读取全部交叉引用，较新的条目优先。
+  bool loadXref(qint64 startXref) {
+    QSet<qint64> visited;
+    std::vector<qint64> pending = {startXref};
+    while (!pending.empty()) {
+      const qint64 offset = pending.back();
+      pending.pop_back();
+      if (offset <= 0 || offset >= m_size || visited.contains(offset))
+        continue;
+      visited.insert(offset);
+
+      QByteArray trailer;
+      const QByteArray head = readAt(offset, 16);
+      const bool classic = head.mid(skipWhite(head, 0)).startsWith("xref");
+      if (classic ? !loadXrefTable(offset, &trailer)
+                  : !loadXrefStream(offset, &trailer))
+        return false;
+      if (m_trailer.isEmpty()) {
+        m_trailer = trailer;
+        m_usesXrefStream = !classic;
+      }
+      // 混合文件：对象流中的对象在本节的表里记为空闲，实际位置由本节的
+      // /XRefStm 给出。流中的条目紧接着读入，只替换本节表中的空闲条目，
+      // 不替换本节的在用条目与更新各节的条目。
+      bool ok = false;
+      const qint64 stream =
+          dictionaryValue(trailer, "/XRefStm").toLongLong(&ok);
+      if (classic && ok && stream > 0 && stream < m_size &&
+          !visited.contains(stream)) {
+        visited.insert(stream);
+        QByteArray streamDictionary;
+        if (!loadXrefStream(stream, &streamDictionary))
+          return false;
+      }
+      m_replaceable.clear();
+      const qint64 previous = dictionaryValue(trailer, "/Prev").toLongLong(&ok);
+      if (ok)
+        pending.push_back(previous);
+    }
+    return !m_trailer.isEmpty();
+  }
+
+  const QByteArray &trailer() const { return m_trailer; }
+  bool usesXrefStream() const { return m_usesXrefStream; }
+
+  std::optional<XrefEntry> entry(int object) const {
+    const auto it = m_entries.constFind(object);
+    if (it == m_entries.constEnd() || it->type == 0)
+      return std::nullopt;
+    return *it;
+  }
+
+  // 读取间接对象的值；对象是流时 stream 为解码前的数据。
+  bool readObject(int object, QByteArray *value, QByteArray *stream = nullptr,
+                  int depth = 0) {
+    const std::optional<XrefEntry> found = entry(object);
+    if (!found || depth > kMaxReferenceDepth)
+      return false;
+    if (found->type == 1)
+      return readObjectAt(found->offset, value, stream, depth);
+
+    // 压缩对象：对象流开头是 N 对“对象号 偏移”，偏移相对于 /First。
+    QByteArray streamDictionary;
+    QByteArray streamData;
+    if (stream ||
+        !readObject(static_cast<int>(found->offset), &streamDictionary,
+                    &streamData, depth + 1) ||
+        !decodeStream(streamDictionary, &streamData))
+      return false;
+    const int count = dictionaryValue(streamDictionary, "/N").toInt();
+    const int first = dictionaryValue(streamDictionary, "/First").toInt();
+    if (found->index < 0 || found->index >= count)
+      return false;
+    const QList<QByteArray> header =
+        streamData.left(first).simplified().split(' ');
+    if (header.size() < count * 2)
+      return false;
+    const qsizetype start = first + header.at(found->index * 2 + 1).toLongLong();
+    const qsizetype end = skipValue(streamData, start);
+    if (end < 0)
+      return false;
+    *value = streamData.mid(start, end - start).trimmed();
+    return true;
+  }
+
+private:
+  bool readObjectAt(qint64 offset, QByteArray *value, QByteArray *stream,
+                    int depth) {
+    QByteArray data;
+    qsizetype valueStart = -1;
+    qsizetype valueEnd = -1;
+    const bool complete =
+        readComplete(offset, &data, &valueEnd, [&](const QByteArray &chunk) {
+          const qsizetype keyword = chunk.indexOf("obj");
+          if (keyword < 0)
+            return qsizetype(-1);
+          valueStart = skipWhite(chunk, keyword + 3);
+          const qsizetype end = skipValue(chunk, valueStart);
+          // 流对象还需要值后面的 stream 关键字。
+          return stream && end >= 0 && end + 16 > chunk.size() ? qsizetype(-1)
+                                                               : end;
+        });
+    if (!complete)
+      return false;
+    *value = data.mid(valueStart, valueEnd - valueStart);
+    if (!stream)
+      return true;
+
+    const qsizetype keyword = skipWhite(data, valueEnd);
+    if (!data.mid(keyword, 6).startsWith("stream"))
+      return false;
+    qsizetype dataStart = keyword + 6;
+    if (dataStart < data.size() && data.at(dataStart) == '\r')
+      ++dataStart;
+    if (dataStart < data.size() && data.at(dataStart) == '\n')
+      ++dataStart;
+
+    const QByteArray lengthValue = dictionaryValue(*value, "/Length");
+    qint64 length = 0;
+    int lengthObject = 0;
+    int lengthGeneration = 0;
+    if (parseReference(lengthValue, &lengthObject, &lengthGeneration)) {
+      QByteArray resolved;
+      if (!readObject(lengthObject, &resolved, nullptr, depth + 1))
+        return false;
+      length = resolved.trimmed().toLongLong();
+    } else {
+      length = lengthValue.trimmed().toLongLong();
+    }
+    if (length < 0 || length > kMaxValueBytes)
+      return false;
+    *stream = readAt(offset + dataStart, length);
+    return stream->size() == length;
+  }
+
+  bool decodeStream(const QByteArray &dictionary, QByteArray *data) {
+    const QByteArray filter = dictionaryValue(dictionary, "/Filter").trimmed();
+    if (filter.isEmpty())
+      return true;
+    if (filter != "/FlateDecode" && filter != "[/FlateDecode]" &&
+        filter != "[ /FlateDecode ]")
+      return false;
+    *data = inflate(*data);
+    if (data->isEmpty())
+      return false;
+
+    const QByteArray parms = dictionaryValue(dictionary, "/DecodeParms");
+    const int predictor = dictionaryValue(parms, "/Predictor").toInt();
+    if (predictor >= 10) {
+      const QByteArray columns = dictionaryValue(parms, "/Columns");
+      const QByteArray colors = dictionaryValue(parms, "/Colors");
+      const QByteArray bits = dictionaryValue(parms, "/BitsPerComponent");
+      *data = undoPngPredictor(*data, columns.isEmpty() ? 1 : columns.toInt(),
+                               colors.isEmpty() ? 1 : colors.toInt(),
+                               bits.isEmpty() ? 8 : bits.toInt());
+    } else if (predictor > 1) {
+      // TIFF 预测器不会出现在交叉引用流与对象流中。
+      return false;
+    }
+    return true;
+  }
+
+  // 较新的条目优先；m_replaceable 中是本节表里的空闲条目，可被本节的
+  // /XRefStm 替换。
+  void insertEntry(int object, const XrefEntry &entry) {
+    if (!m_entries.contains(object) || m_replaceable.remove(object))
+      m_entries.insert(object, entry);
+  }
+
+  bool loadXrefTable(qint64 offset, QByteArray *trailer) {
+    QByteArray data;
+    qsizetype trailerStart = -1;
+    qsizetype end = -1;
+    if (!readComplete(offset, &data, &end, [&](const QByteArray &chunk) {
+          const qsizetype keyword = chunk.indexOf("trailer");
+          if (keyword < 0)
+            return qsizetype(-1);
+          trailerStart = skipWhite(chunk, keyword + 7);
+          return skipValue(chunk, trailerStart);
+        }))
+      return false;
+    *trailer = data.mid(trailerStart, end - trailerStart);
+
+    const QList<QByteArray> tokens =
+        data.mid(0, data.indexOf("trailer")).simplified().split(' ');
+    // tokens[0] 是 "xref"，之后是若干“起始号 数量”加条目。
+    qsizetype i = 1;
+    while (i + 1 < tokens.size()) {
+      bool startOk = false;
+      bool countOk = false;
+      const int first = tokens.at(i).toInt(&startOk);
+      const int count = tokens.at(i + 1).toInt(&countOk);
+      if (!startOk || !countOk || i + 2 + qsizetype(count) * 3 > tokens.size())
+        return false;
+      i += 2;
+      for (int n = 0; n < count; ++n, i += 3) {
+        XrefEntry entry;
+        if (tokens.at(i + 2) == "n") {
+          entry.type = 1;
+          entry.offset = tokens.at(i).toLongLong();
+          entry.generation = tokens.at(i + 1).toInt();
+        } else if (!m_entries.contains(first + n)) {
+          m_replaceable.insert(first + n);
+        }
+        insertEntry(first + n, entry);
+      }
+    }
+    return true;
+  }
+
+  bool loadXrefStream(qint64 offset, QByteArray *trailer) {
+    QByteArray data;
+    if (!readObjectAt(offset, trailer, &data, 0) ||
+        dictionaryValue(*trailer, "/Type").trimmed() != "/XRef" ||
+        !decodeStream(*trailer, &data))
+      return false;
+
+    const QList<qint64> widths = integerArray(dictionaryValue(*trailer, "/W"));
+    if (widths.size() != 3)
+      return false;
+    QList<qint64> index = integerArray(dictionaryValue(*trailer, "/Index"));
+    if (index.isEmpty())
+      index = {0, dictionaryValue(*trailer, "/Size").toLongLong()};
+    const qint64 entryBytes = widths[0] + widths[1] + widths[2];
+    if (entryBytes <= 0)
+      return false;
+
+    const auto field = [&](qsizetype pos, qint64 width, qint64 fallback) {
+      if (width == 0)
+        return fallback;
+      qint64 value = 0;
+      for (qint64 b = 0; b < width; ++b)
+        value = (value << 8) | static_cast<unsigned char>(data.at(pos + b));
+      return value;
+    };
+    qsizetype pos = 0;
+    for (qsizetype range = 0; range + 1 < index.size(); range += 2) {
+      for (qint64 n = 0; n < index[range + 1]; ++n, pos += entryBytes) {
+        if (pos + entryBytes > data.size())
+          return false;
+        XrefEntry entry;
+        entry.type = static_cast<int>(field(pos, widths[0], 1));
+        const qint64 second = field(pos + widths[0], widths[1], 0);
+        const qint64 third = field(pos + widths[0] + widths[1], widths[2], 0);
+        if (entry.type == 1) {
+          entry.offset = second;
+          entry.generation = static_cast<int>(third);
+        } else if (entry.type == 2) {
+          entry.offset = second;
+          entry.index = static_cast<int>(third);
+        } else {
+          entry.type = 0;
+        }
+        insertEntry(static_cast<int>(index[range] + n), entry);
+      }
+    }
+    return true;
+  }
+
+  QFile m_file;
+  qint64 m_size = 0;
+  QHash<int, XrefEntry> m_entries;
+  QSet<int> m_replaceable;
+  QByteArray m_trailer;
+  bool m_usesXrefStream = false;
+};
+} // namespace
+
+bool readPdfAppendBase(const QString &filePath, PdfAppendBase *base,
+                       QString *error) {
+  PdfFileReader reader(filePath);
+  if (!reader.open()) {
+    *error = QStringLiteral("无法打开现有的 PDF 文件。");
+    return false;
+  }
+  base->fileSize = reader.size();
+  base->startXref = reader.findStartXref();
+  if (base->startXref < 0 || !reader.loadXref(base->startXref)) {
+    *error = QStringLiteral("无法解析现有 PDF 的交叉引用表。");
+    return false;
+  }
+
+  const QByteArray &trailer = reader.trailer();
+  if (!dictionaryValue(trailer, "/Encrypt").isEmpty()) {
+    *error = QStringLiteral("不支持向加密的 PDF 追加页面。");
+    return false;
+  }
+  base->usesXrefStream = reader.usesXrefStream();
+  base->size = dictionaryValue(trailer, "/Size").trimmed().toInt();
+  base->rootReference = dictionaryValue(trailer, "/Root").simplified();
+  base->infoReference = dictionaryValue(trailer, "/Info").simplified();
+  base->idArray = dictionaryValue(trailer, "/ID").simplified();
+
+  int catalogObject = 0;
+  int catalogGeneration = 0;
+  QByteArray catalog;
+  if (base->size <= 0 ||
+      !parseReference(base->rootReference, &catalogObject,
+                      &catalogGeneration) ||
+      !reader.readObject(catalogObject, &catalog) ||
+      !parseReference(dictionaryValue(catalog, "/Pages"), &base->pagesObject,
+                      &base->pagesGeneration) ||
+      !reader.readObject(base->pagesObject, &base->pagesDictionary)) {
+    *error = QStringLiteral("无法读取现有 PDF 的页面树。");
+    return false;
+  }
+  // 对象流中的对象代数总是 0，xref 中记录的 index 不是代数。
+  const std::optional<XrefEntry> pagesEntry =
+      reader.entry(base->pagesObject);
+  base->pagesGeneration = pagesEntry && pagesEntry->type == 1
+                              ? pagesEntry->generation
+                              : 0;
+
+  bool countOk = false;
+  base->pageCount =
+      dictionaryValue(base->pagesDictionary, "/Count").trimmed().toInt(&countOk);
+  QByteArray probe;
+  if (!countOk || !extendPagesDictionary(base->pagesDictionary, QByteArray(), 0,
+                                         &probe)) {
+    *error = QStringLiteral("现有 PDF 的页面树格式不受支持。");
+    return false;
+  }
+  return true;
+}
+
+bool extendPagesDictionary(const QByteArray &dictionary, const QByteArray &kids,
+                           int addedPages, QByteArray *result) {
+  qsizetype kidsStart = 0;
+  qsizetype kidsEnd = 0;
+  qsizetype countStart = 0;
+  qsizetype countEnd = 0;
+  if (!findDictionaryValue(dictionary, "/Kids", &kidsStart, &kidsEnd) ||
+      !findDictionaryValue(dictionary, "/Count", &countStart, &countEnd) ||
+      dictionary.at(kidsStart) != '[' || dictionary.at(kidsEnd - 1) != ']')
+    return false;
+  bool ok = false;
+  const qint64 count =
+      dictionary.mid(countStart, countEnd - countStart).toLongLong(&ok);
+  if (!ok)
+    return false;
+
+  QByteArray extended = dictionary;
+  const QByteArray newCount = QByteArray::number(count + addedPages);
+  const QByteArray insertion = kids.isEmpty() ? QByteArray() : ' ' + kids;
+  // 先改位置靠后的值，前面的位置不受影响。
+  if (countStart > kidsEnd) {
+    extended.replace(countStart, countEnd - countStart, newCount);
+    extended.insert(kidsEnd - 1, insertion);
+  } else {
+    extended.insert(kidsEnd - 1, insertion);
+    extended.replace(countStart, countEnd - countStart, newCount);
+  }
+  *result = extended;
+  return true;
+}
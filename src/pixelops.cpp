@@ -0,0 +1,401 @@
+#include "pixelops.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+// BT.601 亮度权重，定点 8 位小数，三者之和为 256。
+constexpr int kRedWeight = 77;
+constexpr int kGreenWeight = 150;
+constexpr int kBlueWeight = 29;
+
+// Sauvola 参数：k 越大越倾向于判为白色，R 为灰度标准差的动态范围。
+constexpr double kSauvolaK = 0.2;
+constexpr double kSauvolaR = 128.0;
+
+// 页面分类：max(R,G,B) − min(R,G,B) 超过阈值的像素算彩色，彩色像素超过
+// 采样的 0.1% 才算彩色页面，扫描仪在黑字边缘产生的色边不会误判。
+// 介于暗、亮两档之间的中间调少于 2% 时视为黑白页面。
+constexpr int kChromaThreshold = 24;
+constexpr qint64 kMaxSamplePixels = 1 << 20;
+constexpr double kColorFraction = 0.001;
+constexpr double kMidtoneFraction = 0.02;
+constexpr int kDarkLevel = 64;
+constexpr int kLightLevel = 192;
+constexpr int kMaxPaletteColors = 256;
+
+void lumaRowScalar(const uchar *src, uchar *dst, int width) {
+  const auto *pixels = reinterpret_cast<const QRgb *>(src);
+  for (int x = 0; x < width; ++x) {
+    const QRgb pixel = pixels[x];
+    dst[x] = static_cast<uchar>(
+        (kRedWeight * qRed(pixel) + kGreenWeight * qGreen(pixel) +
+         kBlueWeight * qBlue(pixel) + 128) >>
+        8);
+  }
+}
+
+#ifdef IMAGES2PDF_HAVE_SSE2
+// 每次处理 4 个 BGRA 像素：扩展为 16 位后用 madd 求 B·wb+G·wg 与 R·wr，
+// 再把两半相加、移位并打包回字节。
+void lumaRowSse2(const uchar *src, uchar *dst, int width) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weights = _mm_setr_epi16(kBlueWeight, kGreenWeight, kRedWeight,
+                                         0, kBlueWeight, kGreenWeight,
+                                         kRedWeight, 0);
+  const __m128i rounding = _mm_set1_epi32(128);
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    const __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+    __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+    __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+    low = _mm_add_epi32(low, _mm_srli_epi64(low, 32));
+    high = _mm_add_epi32(high, _mm_srli_epi64(high, 32));
+    low = _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 1, 2, 0));
+    high = _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i sum = _mm_unpacklo_epi64(low, high);
+    sum = _mm_srli_epi32(_mm_add_epi32(sum, rounding), 8);
+    sum = _mm_packs_epi32(sum, sum);
+    sum = _mm_packus_epi16(sum, sum);
+    const int value = _mm_cvtsi128_si32(sum);
+    std::memcpy(dst + x, &value, 4);
+  }
+  lumaRowScalar(src + x * 4, dst + x, width - x);
+}
+#endif
+
+int chromaCountScalar(const uchar *src, int width) {
+  const auto *pixels = reinterpret_cast<const QRgb *>(src);
+  int count = 0;
+  for (int x = 0; x < width; ++x) {
+    const QRgb pixel = pixels[x];
+    const int high = std::max({qRed(pixel), qGreen(pixel), qBlue(pixel)});
+    const int low = std::min({qRed(pixel), qGreen(pixel), qBlue(pixel)});
+    count += high - low > kChromaThreshold;
+  }
+  return count;
+}
+
+#ifdef IMAGES2PDF_HAVE_SSE2
+// 每次处理 4 个 BGRA 像素：把 G、R 移到最低字节后取逐字节的最大与最小值，
+// 只看每个像素最低字节的差，超过阈值的像素由比较结果的符号位计数。
+int chromaCountSse2(const uchar *src, int width) {
+  const __m128i lowByte = _mm_set1_epi32(0xFF);
+  const __m128i threshold = _mm_set1_epi32(kChromaThreshold);
+  int count = 0;
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    const __m128i blue =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+    const __m128i green = _mm_srli_epi32(blue, 8);
+    const __m128i red = _mm_srli_epi32(blue, 16);
+    const __m128i high = _mm_max_epu8(_mm_max_epu8(blue, green), red);
+    const __m128i low = _mm_min_epu8(_mm_min_epu8(blue, green), red);
+    const __m128i chroma = _mm_and_si128(_mm_sub_epi8(high, low), lowByte);
+    const int mask = _mm_movemask_ps(
+        _mm_castsi128_ps(_mm_cmpgt_epi32(chroma, threshold)));
+    count += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) +
+             ((mask >> 3) & 1);
+  }
+  return count + chromaCountScalar(src + x * 4, width - x);
+}
+#endif
+
+// 最多记录 kMaxPaletteColors 种颜色的开放寻址集合，超出后不再记录。
+class ColorSet {
+public:
+  ColorSet() { m_used.fill(false); }
+
+  void insertRow(const QRgb *pixels, int width) {
+    for (int x = 0; x < width && !m_overflow; ++x) {
+      const QRgb color = pixels[x] | 0xFF000000u;
+      if (color == m_last)
+        continue;
+      m_last = color;
+      size_t slot = (color * 2654435761u) % m_slots.size();
+      while (m_used[slot] && m_slots[slot] != color)
+        slot = (slot + 1) % m_slots.size();
+      if (m_used[slot])
+        continue;
+      if (++m_size > kMaxPaletteColors) {
+        m_overflow = true;
+        return;
+      }
+      m_used[slot] = true;
+      m_slots[slot] = color;
+    }
+  }
+
+  bool overflowed() const { return m_overflow; }
+
+private:
+  std::array<QRgb, 4 * kMaxPaletteColors> m_slots{};
+  std::array<bool, 4 * kMaxPaletteColors> m_used;
+  QRgb m_last = 0;
+  int m_size = 0;
+  bool m_overflow = false;
+};
+
+int otsuThreshold(const QImage &grayscale) {
+  std::array<qint64, 256> histogram{};
+  for (int y = 0; y < grayscale.height(); ++y) {
+    const uchar *line = grayscale.constScanLine(y);
+    for (int x = 0; x < grayscale.width(); ++x)
+      ++histogram[line[x]];
+  }
+
+  const double total =
+      static_cast<double>(grayscale.width()) * grayscale.height();
+  double sumAll = 0.0;
+  for (int i = 0; i < 256; ++i)
+    sumAll += static_cast<double>(i) * histogram[i];
+
+  double sumBackground = 0.0;
+  double weightBackground = 0.0;
+  double bestVariance = -1.0;
+  int threshold = 127;
+  for (int t = 0; t < 256; ++t) {
+    weightBackground += histogram[t];
+    if (weightBackground == 0.0)
+      continue;
+    const double weightForeground = total - weightBackground;
+    if (weightForeground == 0.0)
+      break;
+    sumBackground += static_cast<double>(t) * histogram[t];
+    const double meanBackground = sumBackground / weightBackground;
+    const double meanForeground = (sumAll - sumBackground) / weightForeground;
+    const double difference = meanBackground - meanForeground;
+    const double variance =
+        weightBackground * weightForeground * difference * difference;
+    if (variance > bestVariance) {
+      bestVariance = variance;
+      threshold = t;
+    }
+  }
+  return threshold;
+}
+
+inline void setWhite(uchar *line, int x) { line[x >> 3] |= 0x80 >> (x & 7); }
+
+QImage emptyBilevel(const QSize &size) {
+  QImage result(size, QImage::Format_Mono);
+  if (result.isNull())
+    return result;
+  result.setColorTable({qRgb(0, 0, 0), qRgb(255, 255, 255)});
+  result.fill(0);
+  return result;
+}
+
+QImage globalBilevel(const QImage &grayscale) {
+  QImage result = emptyBilevel(grayscale.size());
+  if (result.isNull())
+    return result;
+  const int threshold = otsuThreshold(grayscale);
+  for (int y = 0; y < grayscale.height(); ++y) {
+    const uchar *in = grayscale.constScanLine(y);
+    uchar *out = result.scanLine(y);
+    for (int x = 0; x < grayscale.width(); ++x) {
+      if (in[x] > threshold)
+        setWhite(out, x);
+    }
+  }
+  return result;
+}
+
+// Sauvola 阈值：T = m·(1 + k·(s/R − 1))。窗口内的均值与方差用列累加和
+// 滑动计算，内存只占两行列和，与图片高度无关。
+QImage adaptiveBilevel(const QImage &grayscale) {
+  QImage result = emptyBilevel(grayscale.size());
+  if (result.isNull())
+    return result;
+
+  const int width = grayscale.width();
+  const int height = grayscale.height();
+  const int radius = std::clamp(std::max(width, height) / 100, 7, 50);
+
+  std::vector<quint32> columnSum(width, 0);
+  std::vector<quint64> columnSquares(width, 0);
+  const auto addRow = [&](int y, int sign) {
+    const uchar *line = grayscale.constScanLine(y);
+    for (int x = 0; x < width; ++x) {
+      const quint32 value = line[x];
+      if (sign > 0) {
+        columnSum[x] += value;
+        columnSquares[x] += value * value;
+      } else {
+        columnSum[x] -= value;
+        columnSquares[x] -= value * value;
+      }
+    }
+  };
+
+  for (int y = 0; y < std::min(radius, height); ++y)
+    addRow(y, 1);
+
+  for (int y = 0; y < height; ++y) {
+    if (y + radius < height)
+      addRow(y + radius, 1);
+    if (y - radius - 1 >= 0)
+      addRow(y - radius - 1, -1);
+    const int rows = std::min(height - 1, y + radius) - std::max(0, y - radius) + 1;
+
+    quint64 sum = 0;
+    quint64 squares = 0;
+    for (int x = 0; x < std::min(radius, width); ++x) {
+      sum += columnSum[x];
+      squares += columnSquares[x];
+    }
+
+    const uchar *in = grayscale.constScanLine(y);
+    uchar *out = result.scanLine(y);
+    for (int x = 0; x < width; ++x) {
+      if (x + radius < width) {
+        sum += columnSum[x + radius];
+        squares += columnSquares[x + radius];
+      }
+      if (x - radius - 1 >= 0) {
+        sum -= columnSum[x - radius - 1];
+        squares -= columnSquares[x - radius - 1];
+      }
+      const int columns =
+          std::min(width - 1, x + radius) - std::max(0, x - radius) + 1;
+      const double count = static_cast<double>(rows) * columns;
+      const double mean = sum / count;
+      const double variance = std::max(0.0, squares / count - mean * mean);
+      const double threshold =
+          mean * (1.0 + kSauvolaK * (std::sqrt(variance) / kSauvolaR - 1.0));
+      if (in[x] > threshold)
+        setWhite(out, x);
+    }
+  }
+  return result;
+}
+} // namespace
+
+const char *pageClassName(PageClass pageClass) {
+  switch (pageClass) {
+  case PageClass::Bilevel:
+    return "bilevel";
+  case PageClass::Grayscale:
+    return "grayscale";
+  case PageClass::Palette:
+    return "palette";
+  case PageClass::Color:
+    return "color";
+  }
+  return "";
+}
+
+ImageAnalysis analyzeImage(const QImage &image) {
+  ImageAnalysis analysis;
+  if (image.isNull())
+    return analysis;
+  const bool gray = image.format() == QImage::Format_Grayscale8;
+  const QImage source = gray ? image : flattenOnWhite(image);
+  const int width = source.width();
+  const int height = source.height();
+  const qint64 pixels = static_cast<qint64>(width) * height;
+  const int step = static_cast<int>(std::clamp<qint64>(
+      (pixels + kMaxSamplePixels - 1) / kMaxSamplePixels, 1, height));
+
+  std::array<qint64, 256> histogram{};
+  std::vector<uchar> luma(gray ? 0 : width);
+  ColorSet colors;
+  qint64 colored = 0;
+  qint64 sampled = 0;
+  for (int y = 0; y < height; y += step) {
+    const uchar *line = source.constScanLine(y);
+    const uchar *values = line;
+    if (!gray) {
+#ifdef IMAGES2PDF_HAVE_SSE2
+      colored += chromaCountSse2(line, width);
+      lumaRowSse2(line, luma.data(), width);
+#else
+      colored += chromaCountScalar(line, width);
+      lumaRowScalar(line, luma.data(), width);
+#endif
+      colors.insertRow(reinterpret_cast<const QRgb *>(line), width);
+      values = luma.data();
+    }
+    for (int x = 0; x < width; ++x)
+      ++histogram[values[x]];
+    sampled += width;
+  }
+  if (sampled == 0)
+    return analysis;
+
+  if (colored > sampled * kColorFraction) {
+    analysis.pageClass =
+        colors.overflowed() ? PageClass::Color : PageClass::Palette;
+    return analysis;
+  }
+  qint64 midtones = 0;
+  for (int level = kDarkLevel + 1; level < kLightLevel; ++level)
+    midtones += histogram[level];
+  if (midtones <= sampled * kMidtoneFraction) {
+    analysis.pageClass = PageClass::Bilevel;
+    return analysis;
+  }
+  analysis.pageClass = PageClass::Grayscale;
+  analysis.grayLevels = static_cast<int>(
+      std::count_if(histogram.begin(), histogram.end(),
+                    [](qint64 count) { return count > 0; }));
+  return analysis;
+}
+
+QImage flattenOnWhite(const QImage &source) {
+  if (!source.hasAlphaChannel())
+    return source.convertToFormat(QImage::Format_RGB32);
+
+  // 预乘格式下与白色合成即 c + (255 - a)。
+  QImage image = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  for (int y = 0; y < image.height(); ++y) {
+    auto *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+    for (int x = 0; x < image.width(); ++x) {
+      const QRgb pixel = line[x];
+      const int inverse = 255 - qAlpha(pixel);
+      line[x] = qRgb(qRed(pixel) + inverse, qGreen(pixel) + inverse,
+                     qBlue(pixel) + inverse);
+    }
+  }
+  image.reinterpretAsFormat(QImage::Format_RGB32);
+  return image;
+}
+
+QImage grayscaleImage(const QImage &source) {
+  if (source.isNull())
+    return QImage();
+  if (source.format() == QImage::Format_Grayscale8)
+    return source;
+  if (source.format() == QImage::Format_Grayscale16 ||
+      (source.isGrayscale() && !source.hasAlphaChannel() &&
+       source.format() == QImage::Format_Indexed8))
+    return source.convertToFormat(QImage::Format_Grayscale8);
+
+  const QImage rgb = flattenOnWhite(source);
+  QImage result(rgb.size(), QImage::Format_Grayscale8);
+  if (result.isNull())
+    return result;
+  for (int y = 0; y < rgb.height(); ++y) {
+#ifdef IMAGES2PDF_HAVE_SSE2
+    lumaRowSse2(rgb.constScanLine(y), result.scanLine(y), rgb.width());
+#else
+    lumaRowScalar(rgb.constScanLine(y), result.scanLine(y), rgb.width());
+#endif
+  }
+  return result;
+}
+
+QImage bilevelImage(const QImage &grayscale, BilevelMode mode) {
+  if (grayscale.isNull() || mode == BilevelMode::Off)
+    return grayscale;
+  const QImage input = grayscaleImage(grayscale);
+  return mode == BilevelMode::Adaptive ? adaptiveBilevel(input)
+                                       : globalBilevel(input);
+}
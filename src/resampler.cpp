@@ -0,0 +1,302 @@
+#include "resampler.h"
+#include "simd.h"
+
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+// 不足这个像素数的图片单线程处理，避免调度开销超过计算本身。
+constexpr int64_t kParallelPixelThreshold = 4 * 1024 * 1024;
+
+// 每个输出像素对应的输入区间与权重；权重按 4 对齐补零，方便向量化点积。
+struct Contributions {
+  std::vector<int> start;
+  std::vector<int> count;
+  std::vector<float> weights;
+  int stride = 0;
+};
+
+constexpr double kPi = 3.14159265358979323846;
+
+double sinc(double x) {
+  if (x == 0.0)
+    return 1.0;
+  x *= kPi;
+  return std::sin(x) / x;
+}
+
+double filterWeight(ResampleFilter filter, double x) {
+  if (filter == ResampleFilter::Box)
+    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+  if (x <= -3.0 || x >= 3.0)
+    return 0.0;
+  return sinc(x) * sinc(x / 3.0);
+}
+
+Contributions computeContributions(int inSize, int outSize,
+                                   ResampleFilter filter) {
+  const double scale = static_cast<double>(inSize) / outSize;
+  const double filterScale = std::max(scale, 1.0);
+  const double radius = filter == ResampleFilter::Box ? 0.5 : 3.0;
+  const double support = radius * filterScale;
+
+  Contributions result;
+  result.stride = (static_cast<int>(std::ceil(support)) * 2 + 1 + 3) & ~3;
+  result.start.resize(outSize);
+  result.count.resize(outSize);
+  result.weights.assign(static_cast<size_t>(outSize) * result.stride, 0.0f);
+
+  for (int i = 0; i < outSize; ++i) {
+    const double center = (i + 0.5) * scale;
+    int first = std::max(static_cast<int>(center - support + 0.5), 0);
+    int last = std::min(static_cast<int>(center + support + 0.5), inSize);
+    if (last - first > result.stride)
+      last = first + result.stride;
+    if (last <= first) {
+      first = std::min(static_cast<int>(center), inSize - 1);
+      last = first + 1;
+    }
+
+    float *weights = result.weights.data() + static_cast<size_t>(i) * result.stride;
+    double total = 0.0;
+    for (int x = first; x < last; ++x) {
+      const double w = filterWeight(filter, (x - center + 0.5) / filterScale);
+      weights[x - first] = static_cast<float>(w);
+      total += w;
+    }
+    if (total == 0.0) {
+      weights[0] = 1.0f;
+      total = 1.0;
+    }
+    for (int x = 0; x < last - first; ++x)
+      weights[x] = static_cast<float>(weights[x] / total);
+
+    result.start[i] = first;
+    result.count[i] = last - first;
+  }
+  return result;
+}
+
+// 与 SIMD 路径保持一致：加 0.5 后截断，负数在截断后被钳到 0。
+inline uint8_t clampToByte(float value) {
+  const int rounded = static_cast<int>(value + 0.5f);
+  return static_cast<uint8_t>(std::clamp(rounded, 0, 255));
+}
+
+// ---- 纵向：acc += weight * src，逐字节累加整行 ----
+
+void accumulateRowScalar(float *acc, const uint8_t *src, int count,
+                         float weight) {
+  for (int i = 0; i < count; ++i)
+    acc[i] += weight * src[i];
+}
+
+#ifdef IMAGES2PDF_HAVE_SSE2
+void accumulateRowSse2(float *acc, const uint8_t *src, int count,
+                       float weight) {
+  const __m128 w = _mm_set1_ps(weight);
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i bytes =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    const __m128i words = _mm_unpacklo_epi8(bytes, zero);
+    const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+    const __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+    _mm_storeu_ps(acc + i,
+                  _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(low, w)));
+    _mm_storeu_ps(acc + i + 4,
+                  _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(high, w)));
+  }
+  accumulateRowScalar(acc + i, src + i, count - i, weight);
+}
+
+IMAGES2PDF_TARGET_AVX2
+void accumulateRowAvx2(float *acc, const uint8_t *src, int count,
+                       float weight) {
+  const __m256 w = _mm256_set1_ps(weight);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i bytes =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+    _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i),
+                                            _mm256_mul_ps(values, w)));
+  }
+  for (; i < count; ++i)
+    acc[i] += weight * src[i];
+}
+#endif
+
+using AccumulateRowFn = void (*)(float *, const uint8_t *, int, float);
+
+AccumulateRowFn selectAccumulateRow() {
+#ifdef IMAGES2PDF_HAVE_SSE2
+  static const AccumulateRowFn selected =
+      cpuHasAvx2() ? accumulateRowAvx2 : accumulateRowSse2;
+  return selected;
+#else
+  return accumulateRowScalar;
+#endif
+}
+
+// ---- 横向：对累加好的浮点行做加权求和并写回 8 位像素 ----
+
+void horizontalPass(const float *acc, uint8_t *dst, int channels,
+                    const Contributions &c, int outWidth) {
+#ifdef IMAGES2PDF_HAVE_SSE2
+  if (channels == 4) {
+    for (int x = 0; x < outWidth; ++x) {
+      const float *weights =
+          c.weights.data() + static_cast<size_t>(x) * c.stride;
+      const float *pixel = acc + static_cast<size_t>(c.start[x]) * 4;
+      __m128 sum = _mm_setzero_ps();
+      for (int k = 0; k < c.count[x]; ++k) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixel + k * 4),
+                                         _mm_set1_ps(weights[k])));
+      }
+      const __m128i rounded =
+          _mm_cvttps_epi32(_mm_add_ps(sum, _mm_set1_ps(0.5f)));
+      const __m128i packed =
+          _mm_packus_epi16(_mm_packs_epi32(rounded, rounded), rounded);
+      const int value = _mm_cvtsi128_si32(packed);
+      std::memcpy(dst + x * 4, &value, 4);
+    }
+    return;
+  }
+  if (channels == 1) {
+    // acc 末尾留有 stride 个 0，补零的权重可以整组读取。
+    for (int x = 0; x < outWidth; ++x) {
+      const float *weights =
+          c.weights.data() + static_cast<size_t>(x) * c.stride;
+      const float *pixel = acc + c.start[x];
+      __m128 sum = _mm_setzero_ps();
+      for (int k = 0; k < c.stride; k += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixel + k),
+                                         _mm_loadu_ps(weights + k)));
+      }
+      sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+      sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+      dst[x] = clampToByte(_mm_cvtss_f32(sum));
+    }
+    return;
+  }
+#endif
+  for (int x = 0; x < outWidth; ++x) {
+    const float *weights = c.weights.data() + static_cast<size_t>(x) * c.stride;
+    for (int ch = 0; ch < channels; ++ch) {
+      const float *pixel =
+          acc + static_cast<size_t>(c.start[x]) * channels + ch;
+      float sum = 0.0f;
+      for (int k = 0; k < c.count[x]; ++k)
+        sum += weights[k] * pixel[k * channels];
+      dst[x * channels + ch] = clampToByte(sum);
+    }
+  }
+}
+
+struct RowRange {
+  int first;
+  int last;
+};
+
+struct PlaneView {
+  const uint8_t *sourceBits;
+  ptrdiff_t sourceStride;
+  int sourceWidth;
+  uint8_t *targetBits;
+  ptrdiff_t targetStride;
+  int targetWidth;
+  int channels;
+};
+
+void resampleRows(const PlaneView &view, const Contributions &horizontal,
+                  const Contributions &vertical, const RowRange &range) {
+  const int rowValues = view.sourceWidth * view.channels;
+  std::vector<float> acc(static_cast<size_t>(rowValues) + horizontal.stride,
+                         0.0f);
+  const AccumulateRowFn accumulateRow = selectAccumulateRow();
+
+  for (int y = range.first; y < range.last; ++y) {
+    std::fill(acc.begin(), acc.begin() + rowValues, 0.0f);
+    const float *weights =
+        vertical.weights.data() + static_cast<size_t>(y) * vertical.stride;
+    for (int k = 0; k < vertical.count[y]; ++k) {
+      const uint8_t *row =
+          view.sourceBits + (vertical.start[y] + k) * view.sourceStride;
+      accumulateRow(acc.data(), row, rowValues, weights[k]);
+    }
+    horizontalPass(acc.data(), view.targetBits + y * view.targetStride,
+                   view.channels, horizontal, view.targetWidth);
+  }
+}
+} // namespace
+
+QImage resampleImage(const QImage &source, const QSize &targetSize,
+                     ResampleFilter filter, QThreadPool *pool) {
+  if (source.isNull() || targetSize.isEmpty())
+    return QImage();
+  if (source.size() == targetSize)
+    return source;
+
+  QImage input;
+  int channels = 4;
+  switch (source.format()) {
+  case QImage::Format_Grayscale8:
+    input = source;
+    channels = 1;
+    break;
+  case QImage::Format_RGB32:
+  case QImage::Format_ARGB32_Premultiplied:
+    input = source;
+    break;
+  default:
+    input = source.convertToFormat(source.hasAlphaChannel()
+                                       ? QImage::Format_ARGB32_Premultiplied
+                                       : QImage::Format_RGB32);
+    break;
+  }
+
+  QImage target(targetSize, input.format());
+  if (target.isNull())
+    return QImage();
+
+  const Contributions horizontal =
+      computeContributions(input.width(), targetSize.width(), filter);
+  const Contributions vertical =
+      computeContributions(input.height(), targetSize.height(), filter);
+
+  // 目标图像在分发前取一次可写指针，避免各线程并发调用 scanLine() 触发 detach 检查。
+  const PlaneView view{input.constBits(),   input.bytesPerLine(),
+                       input.width(),       target.bits(),
+                       target.bytesPerLine(), target.width(),
+                       channels};
+
+  const qint64 workPixels =
+      static_cast<qint64>(input.width()) * targetSize.height();
+  if (!pool)
+    pool = QThreadPool::globalInstance();
+  const int threads = std::max(1, pool->maxThreadCount());
+  if (workPixels < kParallelPixelThreshold || threads == 1 ||
+      targetSize.height() < threads) {
+    resampleRows(view, horizontal, vertical, RowRange{0, targetSize.height()});
+    return target;
+  }
+
+  const int chunkCount = threads * 4;
+  const int rowsPerChunk = (targetSize.height() + chunkCount - 1) / chunkCount;
+  std::vector<RowRange> ranges;
+  for (int y = 0; y < targetSize.height(); y += rowsPerChunk) {
+    ranges.push_back(
+        RowRange{y, std::min(targetSize.height(), y + rowsPerChunk)});
+  }
+  QtConcurrent::blockingMap(pool, ranges, [&](const RowRange &range) {
+    resampleRows(view, horizontal, vertical, range);
+  });
+  return target;
+}
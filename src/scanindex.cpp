@@ -0,0 +1,142 @@
+#include "scanindex.h"
+#include "contenthash.h"
+#include "filemetadata.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr quint32 kIndexMagic = 0x49325053; // "I2PS"
+constexpr quint32 kIndexVersion = 1;
+// 修改时间落在扫描开始前这段时间内的目录不记入索引：同一时间刻度内
+// 稍后发生的改动不会再改变时间戳，复用这种记录可能漏掉新文件。
+constexpr qint64 kRacyWindowNsecs = 2000000000LL;
+
+QString decodePath(const QByteArray &path) {
+#if defined(Q_OS_UNIX)
+  return QFile::decodeName(path);
+#else
+  return QString::fromUtf8(path);
+#endif
+}
+} // namespace
+
+QDataStream &operator<<(QDataStream &stream, const IndexedFile &file) {
+  return stream << file.name << file.size << file.modifiedMsecs;
+}
+
+QDataStream &operator>>(QDataStream &stream, IndexedFile &file) {
+  return stream >> file.name >> file.size >> file.modifiedMsecs;
+}
+
+QDataStream &operator<<(QDataStream &stream, const IndexedDirectory &entry) {
+  return stream << entry.modifiedNsecs << entry.subdirectories << entry.files;
+}
+
+QDataStream &operator>>(QDataStream &stream, IndexedDirectory &entry) {
+  return stream >> entry.modifiedNsecs >> entry.subdirectories >> entry.files;
+}
+
+ScanIndex::ScanIndex(const QString &rootPath, bool includeSubdirectories)
+    : m_rootPath(QDir::cleanPath(rootPath)),
+      m_includeSubdirectories(includeSubdirectories),
+      m_scanStartNsecs(QDateTime::currentMSecsSinceEpoch() * 1000000LL) {}
+
+QString ScanIndex::filePath() const {
+  // 是否递归分开保存，避免单层扫描覆盖完整的递归索引。
+  const QByteArray key = m_rootPath.toUtf8() +
+                         (m_includeSubdirectories ? "\n1" : "\n0");
+  const quint64 hash =
+      xxHash64(key.constData(), static_cast<size_t>(key.size()));
+  const QString cacheDir =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  return cacheDir + QStringLiteral("/scan-index/") +
+         QString::number(hash, 16).rightJustified(16, QLatin1Char('0')) +
+         QStringLiteral(".idx");
+}
+
+void ScanIndex::load() {
+  m_previous.clear();
+  QFile file(filePath());
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  quint32 version = 0;
+  QString rootPath;
+  stream >> magic >> version;
+  if (magic != kIndexMagic || version != kIndexVersion)
+    return;
+  stream >> rootPath;
+  if (rootPath != m_rootPath)
+    return;
+
+  QHash<QByteArray, IndexedDirectory> entries;
+  stream >> entries;
+  if (stream.status() == QDataStream::Ok)
+    m_previous = std::move(entries);
+}
+
+bool ScanIndex::save() const {
+  const QString path = filePath();
+  if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+    return false;
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_0);
+  {
+    QMutexLocker locker(&m_mutex);
+    stream << kIndexMagic << kIndexVersion << m_rootPath << m_current;
+  }
+  if (stream.status() != QDataStream::Ok) {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+bool ScanIndex::lookup(const QByteArray &directory, qint64 modifiedNsecs,
+                       IndexedDirectory *entry) const {
+  // m_previous 在扫描期间只读，无需加锁。
+  const auto it = m_previous.constFind(directory);
+  if (it == m_previous.constEnd() || it->modifiedNsecs < 0 ||
+      it->modifiedNsecs != modifiedNsecs)
+    return false;
+  *entry = it.value();
+  return true;
+}
+
+void ScanIndex::record(const QByteArray &directory, IndexedDirectory entry,
+                       bool reused) {
+  if (entry.modifiedNsecs >= m_scanStartNsecs - kRacyWindowNsecs)
+    entry.modifiedNsecs = -1;
+  if (m_metadata) {
+    QByteArray prefix = directory;
+    if (!prefix.endsWith('/'))
+      prefix.append('/');
+    for (const IndexedFile &file : entry.files) {
+      const QString path = decodePath(prefix + file.name);
+      if (reused)
+        m_metadata->insertIfAbsent(path, file.size, file.modifiedMsecs);
+      else
+        m_metadata->insert(path, file.size, file.modifiedMsecs);
+    }
+  }
+  QMutexLocker locker(&m_mutex);
+  m_current.insert(directory, std::move(entry));
+}
+
+void ScanIndex::setMetadataCache(FileMetadataCache *metadata) {
+  m_metadata = metadata;
+}
@@ -0,0 +1,517 @@
+#include "stripreader.h"
+#include "pixelops.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QRect>
+#include <QTransform>
+#include <algorithm>
+#include <vector>
+
+#if defined(IMAGES2PDF_HAVE_TIFF)
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <tiffio.h>
+#endif
+
+namespace {
+// 每个行带解码后的大小上限（按 32 位像素计），决定峰值内存。
+constexpr qint64 kBandBytes = 16LL * 1024 * 1024;
+constexpr double kEpsilon = 1e-9;
+
+// 面积平均缩小：每个输出像素取它覆盖的源区域的加权平均。源图逐行送入，
+// 只保留一行水平缩小的结果与一行纵向累加值；目标每一维都不大于源图，
+// 因此一个源行最多跨两个输出行。
+class AreaDownsampler {
+public:
+  AreaDownsampler(const QSize &sourceSize, const QSize &targetSize,
+                  bool grayscale)
+      : m_channels(grayscale ? 1 : 3), m_sourceHeight(sourceSize.height()),
+        m_sourceRow(0), m_outputRow(0),
+        m_scaleY(static_cast<double>(sourceSize.height()) /
+                 targetSize.height()),
+        m_output(targetSize, grayscale ? QImage::Format_Grayscale8
+                                       : QImage::Format_RGB32),
+        m_row(static_cast<size_t>(targetSize.width()) * m_channels),
+        m_sum(m_row.size(), 0.0f) {
+    const double scaleX =
+        static_cast<double>(sourceSize.width()) / targetSize.width();
+    m_spans.reserve(static_cast<size_t>(targetSize.width()));
+    for (int x = 0; x < targetSize.width(); ++x) {
+      const double left = x * scaleX;
+      const double right = (x + 1) * scaleX;
+      Span span;
+      span.first = static_cast<int>(left);
+      span.offset = static_cast<int>(m_weights.size());
+      for (int s = span.first; s < sourceSize.width() && s < right; ++s) {
+        const double overlap =
+            std::min<double>(s + 1, right) - std::max<double>(s, left);
+        m_weights.push_back(static_cast<float>(overlap / scaleX));
+      }
+      span.count = static_cast<int>(m_weights.size()) - span.offset;
+      m_spans.push_back(span);
+    }
+  }
+
+  bool isValid() const { return !m_output.isNull(); }
+
+  // row 为 channels 个字节交错的一行源像素。
+  void addRow(const uchar *row) {
+    if (m_sourceRow >= m_sourceHeight)
+      return;
+    resampleRow(row);
+    const double top = m_sourceRow;
+    const double bottom = ++m_sourceRow;
+    const double boundary = (m_outputRow + 1) * m_scaleY;
+    if (bottom < boundary - kEpsilon) {
+      accumulate(static_cast<float>((bottom - top) / m_scaleY));
+      return;
+    }
+    accumulate(static_cast<float>((boundary - top) / m_scaleY));
+    emitRow();
+    if (bottom - boundary > kEpsilon)
+      accumulate(static_cast<float>((bottom - boundary) / m_scaleY));
+  }
+
+  QImage finish() {
+    // 浮点误差可能让最后一行没有在 addRow 中输出。
+    if (m_outputRow < m_output.height())
+      emitRow();
+    return m_output;
+  }
+
+private:
+  struct Span {
+    int first = 0;
+    int offset = 0;
+    int count = 0;
+  };
+
+  void resampleRow(const uchar *row) {
+    for (size_t x = 0; x < m_spans.size(); ++x) {
+      const Span &span = m_spans[x];
+      const float *weights = m_weights.data() + span.offset;
+      const uchar *source = row + static_cast<size_t>(span.first) * m_channels;
+      for (int c = 0; c < m_channels; ++c) {
+        float value = 0.0f;
+        for (int i = 0; i < span.count; ++i)
+          value += weights[i] * source[i * m_channels + c];
+        m_row[x * m_channels + c] = value;
+      }
+    }
+  }
+
+  void accumulate(float weight) {
+    for (size_t i = 0; i < m_sum.size(); ++i)
+      m_sum[i] += weight * m_row[i];
+  }
+
+  static int toByte(float value) {
+    return std::clamp(static_cast<int>(value + 0.5f), 0, 255);
+  }
+
+  void emitRow() {
+    if (m_outputRow >= m_output.height())
+      return;
+    uchar *line = m_output.scanLine(m_outputRow++);
+    if (m_channels == 1) {
+      for (size_t x = 0; x < m_sum.size(); ++x)
+        line[x] = static_cast<uchar>(toByte(m_sum[x]));
+    } else {
+      auto *pixels = reinterpret_cast<QRgb *>(line);
+      for (size_t x = 0; x < m_spans.size(); ++x)
+        pixels[x] = qRgb(toByte(m_sum[x * 3]), toByte(m_sum[x * 3 + 1]),
+                         toByte(m_sum[x * 3 + 2]));
+    }
+    std::fill(m_sum.begin(), m_sum.end(), 0.0f);
+  }
+
+  const int m_channels;
+  const int m_sourceHeight;
+  int m_sourceRow;
+  int m_outputRow;
+  const double m_scaleY;
+  QImage m_output;
+  std::vector<Span> m_spans;
+  std::vector<float> m_weights;
+  std::vector<float> m_row;
+  std::vector<float> m_sum;
+};
+
+#if defined(IMAGES2PDF_HAVE_TIFF)
+// libtiff 直接读取映射的文件内容：map 回调交出整段数据，条带与瓦片不再复制。
+struct TiffStream {
+  const QByteArray *data = nullptr;
+  toff_t position = 0;
+};
+
+tmsize_t tiffRead(thandle_t handle, void *buffer, tmsize_t size) {
+  auto *stream = static_cast<TiffStream *>(handle);
+  const auto total = static_cast<toff_t>(stream->data->size());
+  if (size <= 0 || stream->position >= total)
+    return 0;
+  const toff_t count =
+      std::min<toff_t>(static_cast<toff_t>(size), total - stream->position);
+  std::memcpy(buffer, stream->data->constData() + stream->position,
+              static_cast<size_t>(count));
+  stream->position += count;
+  return static_cast<tmsize_t>(count);
+}
+
+tmsize_t tiffWrite(thandle_t, void *, tmsize_t) { return -1; }
+
+toff_t tiffSeek(thandle_t handle, toff_t offset, int whence) {
+  auto *stream = static_cast<TiffStream *>(handle);
+  switch (whence) {
+  case SEEK_SET:
+    stream->position = offset;
+    break;
+  case SEEK_CUR:
+    stream->position += offset;
+    break;
+  case SEEK_END:
+    stream->position = static_cast<toff_t>(stream->data->size()) + offset;
+    break;
+  default:
+    return static_cast<toff_t>(-1);
+  }
+  return stream->position;
+}
+
+int tiffClose(thandle_t) { return 0; }
+
+toff_t tiffSize(thandle_t handle) {
+  return static_cast<toff_t>(static_cast<TiffStream *>(handle)->data->size());
+}
+
+int tiffMap(thandle_t handle, void **base, toff_t *size) {
+  const QByteArray *data = static_cast<TiffStream *>(handle)->data;
+  *base = const_cast<char *>(data->constData());
+  *size = static_cast<toff_t>(data->size());
+  return 1;
+}
+
+void tiffUnmap(thandle_t, void *, toff_t) {}
+
+struct TiffCloser {
+  void operator()(TIFF *tiff) const { TIFFClose(tiff); }
+};
+using TiffHandle = std::unique_ptr<TIFF, TiffCloser>;
+
+// 打开后切换到第 directory 个 IFD（多页 TIFF 的页），不存在时返回空。
+TiffHandle openTiffHandle(TiffStream *stream, int directory) {
+  TiffHandle tiff(TIFFClientOpen("images2pdf", "r", stream, tiffRead,
+                                 tiffWrite, tiffSeek, tiffClose, tiffSize,
+                                 tiffMap, tiffUnmap));
+  if (tiff && directory > 0 &&
+      !TIFFSetDirectory(tiff.get(), static_cast<tdir_t>(directory)))
+    tiff.reset();
+  return tiff;
+}
+
+bool hasTiffSignature(const QByteArray &data) {
+  return data.startsWith(QByteArrayLiteral("II*\0")) ||
+         data.startsWith(QByteArrayLiteral("MM\0*")) ||
+         data.startsWith(QByteArrayLiteral("II+\0")) ||
+         data.startsWith(QByteArrayLiteral("MM\0+"));
+}
+
+struct TiffLayout {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint16_t bitsPerSample = 1;
+  uint16_t samplesPerPixel = 1;
+  uint16_t photometric = PHOTOMETRIC_MINISWHITE;
+  uint16_t planar = PLANARCONFIG_CONTIG;
+  uint16_t orientation = ORIENTATION_TOPLEFT;
+  bool tiled = false;
+
+  bool grayscale() const {
+    return photometric == PHOTOMETRIC_MINISBLACK ||
+           photometric == PHOTOMETRIC_MINISWHITE;
+  }
+  // 常见的 1 位黑白、8 位灰度与 8 位 RGB 条带按扫描行顺序读取，压缩条带
+  // 也只解码一遍；其余布局交给 libtiff 的 RGBA 接口转换。
+  bool scanlineReadable() const {
+    if (tiled || planar != PLANARCONFIG_CONTIG)
+      return false;
+    if (grayscale())
+      return samplesPerPixel == 1 && (bitsPerSample == 1 || bitsPerSample == 8);
+    return photometric == PHOTOMETRIC_RGB && samplesPerPixel == 3 &&
+           bitsPerSample == 8;
+  }
+};
+
+bool readTiffLayout(TIFF *tiff, TiffLayout *layout) {
+  if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &layout->width) ||
+      !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &layout->height) ||
+      layout->width == 0 || layout->height == 0 ||
+      layout->width > static_cast<uint32_t>(std::numeric_limits<int>::max()) ||
+      layout->height > static_cast<uint32_t>(std::numeric_limits<int>::max()))
+    return false;
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &layout->bitsPerSample);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL,
+                        &layout->samplesPerPixel);
+  TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &layout->photometric);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &layout->planar);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &layout->orientation);
+  layout->tiled = TIFFIsTiled(tiff) != 0;
+  return true;
+}
+
+bool readTiffScanlines(TIFF *tiff, const TiffLayout &layout,
+                       AreaDownsampler *sampler) {
+  const tmsize_t scanlineSize = TIFFScanlineSize(tiff);
+  if (scanlineSize <= 0)
+    return false;
+  std::vector<uchar> scanline(static_cast<size_t>(scanlineSize));
+  std::vector<uchar> line(layout.width);
+  const bool inverted = layout.photometric == PHOTOMETRIC_MINISWHITE;
+  for (uint32_t y = 0; y < layout.height; ++y) {
+    if (TIFFReadScanline(tiff, scanline.data(), y, 0) < 0)
+      return false;
+    if (layout.bitsPerSample == 1) {
+      // MINISBLACK 中 1 为白，MINISWHITE 中 1 为黑。
+      for (uint32_t x = 0; x < layout.width; ++x) {
+        const bool set = (scanline[x >> 3] >> (7 - (x & 7))) & 1;
+        line[x] = set != inverted ? 255 : 0;
+      }
+      sampler->addRow(line.data());
+    } else if (inverted) {
+      for (uint32_t x = 0; x < layout.width; ++x)
+        line[x] = static_cast<uchar>(255 - scanline[x]);
+      sampler->addRow(line.data());
+    } else {
+      sampler->addRow(scanline.data());
+    }
+  }
+  return true;
+}
+
+bool readTiffRgba(TIFF *tiff, const TiffLayout &layout, bool grayscale,
+                  AreaDownsampler *sampler) {
+  char message[1024] = {};
+  TIFFRGBAImage image;
+  if (!TIFFRGBAImageOK(tiff, message) ||
+      !TIFFRGBAImageBegin(&image, tiff, 0, message))
+    return false;
+  // 按存储顺序输出，方向与其它格式一样在缩小后统一变换。
+  image.req_orientation = image.orientation;
+
+  uint32_t unit = 0;
+  if (layout.tiled)
+    TIFFGetField(tiff, TIFFTAG_TILELENGTH, &unit);
+  else
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &unit);
+  unit = std::clamp<uint32_t>(unit, 1, layout.height);
+  // 行带与条带或瓦片对齐，每块只解码一次。单个条带就超出预算时按预算
+  // 分段，压缩条带会因此从头解码多次，但内存仍然有界。
+  const qint64 budgetRows =
+      std::max<qint64>(1, kBandBytes / (qint64(layout.width) * 4));
+  const auto bandRows = static_cast<uint32_t>(
+      unit <= budgetRows ? budgetRows / unit * unit : budgetRows);
+
+  std::vector<uint32_t> raster(static_cast<size_t>(layout.width) * bandRows);
+  std::vector<uchar> line(static_cast<size_t>(layout.width) *
+                          (grayscale ? 1 : 3));
+  bool ok = true;
+  for (uint32_t y = 0; ok && y < layout.height; y += bandRows) {
+    const uint32_t rows = std::min(bandRows, layout.height - y);
+    image.row_offset = static_cast<int>(y);
+    image.col_offset = 0;
+    ok = TIFFRGBAImageGet(&image, raster.data(), layout.width, rows) != 0;
+    for (uint32_t row = 0; ok && row < rows; ++row) {
+      const uint32_t *pixels = raster.data() + size_t(row) * layout.width;
+      uchar *out = line.data();
+      for (uint32_t x = 0; x < layout.width; ++x) {
+        // RGBA 接口输出预乘 alpha，与白色合成即 c + (255 - a)。
+        const uint32_t pixel = pixels[x];
+        const uint32_t white = 255 - TIFFGetA(pixel);
+        *out++ = static_cast<uchar>(TIFFGetR(pixel) + white);
+        if (!grayscale) {
+          *out++ = static_cast<uchar>(TIFFGetG(pixel) + white);
+          *out++ = static_cast<uchar>(TIFFGetB(pixel) + white);
+        }
+      }
+      sampler->addRow(line.data());
+    }
+  }
+  TIFFRGBAImageEnd(&image);
+  return ok;
+}
+#endif
+} // namespace
+
+QImageIOHandler::Transformations orientationTransformation(int orientation) {
+  switch (orientation) {
+  case 2:
+    return QImageIOHandler::TransformationMirror;
+  case 3:
+    return QImageIOHandler::TransformationRotate180;
+  case 4:
+    return QImageIOHandler::TransformationFlip;
+  case 5:
+    return QImageIOHandler::TransformationFlipAndRotate90;
+  case 6:
+    return QImageIOHandler::TransformationRotate90;
+  case 7:
+    return QImageIOHandler::TransformationMirrorAndRotate90;
+  case 8:
+    return QImageIOHandler::TransformationRotate270;
+  default:
+    return QImageIOHandler::TransformationNone;
+  }
+}
+
+QImage applyTransformation(const QImage &image,
+                           QImageIOHandler::Transformations transformation) {
+  if (transformation == QImageIOHandler::TransformationNone)
+    return image;
+  QImage result = image.mirrored(
+      transformation.testFlag(QImageIOHandler::TransformationMirror),
+      transformation.testFlag(QImageIOHandler::TransformationFlip));
+  if (transformation.testFlag(QImageIOHandler::TransformationRotate90))
+    result = result.transformed(QTransform().rotate(90));
+  return result;
+}
+
+StripImageReader::StripImageReader(const QByteArray &data, int frame)
+    : m_data(data), m_frame(frame), m_kind(Kind::None),
+      m_transformation(QImageIOHandler::TransformationNone),
+      m_grayscale(false) {}
+
+bool StripImageReader::open() {
+  m_kind = Kind::None;
+  if (openTiff())
+    m_kind = Kind::Tiff;
+  else if (openClipRect())
+    m_kind = Kind::ClipRect;
+  return m_kind != Kind::None;
+}
+
+QImage StripImageReader::read(const QSize &targetSize) {
+  if (targetSize.isEmpty() || targetSize.width() > m_size.width() ||
+      targetSize.height() > m_size.height())
+    return QImage();
+  QImage image;
+  if (m_kind == Kind::Tiff)
+    image = readTiff(targetSize);
+  else if (m_kind == Kind::ClipRect)
+    image = readClipRect(targetSize);
+  return image.isNull() ? image : applyTransformation(image, m_transformation);
+}
+
+bool StripImageReader::openTiff() {
+#if defined(IMAGES2PDF_HAVE_TIFF)
+  if (!hasTiffSignature(m_data))
+    return false;
+  TiffStream stream;
+  stream.data = &m_data;
+  const TiffHandle tiff = openTiffHandle(&stream, m_frame);
+  TiffLayout layout;
+  if (!tiff || !readTiffLayout(tiff.get(), &layout))
+    return false;
+  char message[1024] = {};
+  if (!layout.scanlineReadable() && !TIFFRGBAImageOK(tiff.get(), message))
+    return false;
+  m_size = QSize(static_cast<int>(layout.width),
+                 static_cast<int>(layout.height));
+  m_transformation = orientationTransformation(layout.orientation);
+  m_grayscale = layout.grayscale();
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool StripImageReader::openClipRect() {
+  QBuffer buffer(&m_data);
+  if (!buffer.open(QIODevice::ReadOnly))
+    return false;
+  QImageReader reader(&buffer);
+  if (!reader.supportsOption(QImageIOHandler::ClipRect) ||
+      (m_frame > 0 && !reader.jumpToImage(m_frame)))
+    return false;
+  m_size = reader.size();
+  if (!m_size.isValid())
+    return false;
+  m_format = reader.format();
+  m_transformation = reader.transformation();
+  const QImage::Format format = reader.imageFormat();
+  m_grayscale = format == QImage::Format_Grayscale8 ||
+                format == QImage::Format_Grayscale16 ||
+                format == QImage::Format_Mono ||
+                format == QImage::Format_MonoLSB;
+  return true;
+}
+
+QImage StripImageReader::readTiff(const QSize &targetSize) {
+#if defined(IMAGES2PDF_HAVE_TIFF)
+  TiffStream stream;
+  stream.data = &m_data;
+  const TiffHandle tiff = openTiffHandle(&stream, m_frame);
+  TiffLayout layout;
+  if (!tiff || !readTiffLayout(tiff.get(), &layout))
+    return QImage();
+  AreaDownsampler sampler(m_size, targetSize, m_grayscale);
+  if (!sampler.isValid())
+    return QImage();
+  const bool ok =
+      layout.scanlineReadable()
+          ? readTiffScanlines(tiff.get(), layout, &sampler)
+          : readTiffRgba(tiff.get(), layout, m_grayscale, &sampler);
+  return ok ? sampler.finish() : QImage();
+#else
+  Q_UNUSED(targetSize);
+  return QImage();
+#endif
+}
+
+// 每个行带重新创建一次读取器并裁剪解码；插件只需输出裁剪区域，
+// 不必为整幅图像分配内存。
+QImage StripImageReader::readClipRect(const QSize &targetSize) {
+  AreaDownsampler sampler(m_size, targetSize, m_grayscale);
+  if (!sampler.isValid())
+    return QImage();
+  QBuffer buffer(&m_data);
+  if (!buffer.open(QIODevice::ReadOnly))
+    return QImage();
+  const int width = m_size.width();
+  const int height = m_size.height();
+  const int bandRows = static_cast<int>(std::clamp<qint64>(
+      kBandBytes / (qint64(width) * 4), 16, height));
+  std::vector<uchar> line(m_grayscale ? 0 : static_cast<size_t>(width) * 3);
+  for (int y = 0; y < height; y += bandRows) {
+    const int rows = std::min(bandRows, height - y);
+    buffer.seek(0);
+    QImageReader reader(&buffer, m_format);
+    reader.setAutoTransform(false);
+    if (m_frame > 0 && !reader.jumpToImage(m_frame))
+      return QImage();
+    reader.setClipRect(QRect(0, y, width, rows));
+    QImage band = reader.read();
+    if (band.size() != QSize(width, rows))
+      return QImage();
+    if (m_grayscale) {
+      band = band.convertToFormat(QImage::Format_Grayscale8);
+      for (int row = 0; row < rows; ++row)
+        sampler.addRow(band.constScanLine(row));
+      continue;
+    }
+    band = flattenOnWhite(band);
+    for (int row = 0; row < rows; ++row) {
+      const auto *pixels = reinterpret_cast<const QRgb *>(band.constScanLine(row));
+      uchar *out = line.data();
+      for (int x = 0; x < width; ++x) {
+        *out++ = static_cast<uchar>(qRed(pixels[x]));
+        *out++ = static_cast<uchar>(qGreen(pixels[x]));
+        *out++ = static_cast<uchar>(qBlue(pixels[x]));
+      }
+      sampler.addRow(line.data());
+    }
+  }
+  return sampler.finish();
+}
@@ -0,0 +1,323 @@
+#include "thumbnailprovider.h"
+#include "filemetadata.h"
+#include "stripreader.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QQuickTextureFactory>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace {
+// APP1 段最长 64 KB，EXIF 缩略图一定在文件开头这一段内。
+constexpr qint64 kExifScanBytes = 64 * 1024 + 4;
+constexpr int kDefaultEdge = 128;
+
+struct ExifThumbnail {
+  QByteArray jpeg;
+  int orientation = 1;
+};
+
+class TiffReader {
+public:
+  TiffReader(const QByteArray &data, qsizetype base, bool bigEndian)
+      : m_data(data), m_base(base), m_bigEndian(bigEndian) {}
+
+  bool has(qsizetype offset, qsizetype length) const {
+    return offset >= 0 && length >= 0 &&
+           m_base + offset + length <= m_data.size();
+  }
+  quint16 u16(qsizetype offset) const {
+    const auto *p =
+        reinterpret_cast<const uchar *>(m_data.constData() + m_base + offset);
+    return m_bigEndian ? quint16((p[0] << 8) | p[1])
+                       : quint16((p[1] << 8) | p[0]);
+  }
+  quint32 u32(qsizetype offset) const {
+    const auto *p =
+        reinterpret_cast<const uchar *>(m_data.constData() + m_base + offset);
+    return m_bigEndian ? (quint32(p[0]) << 24) | (quint32(p[1]) << 16) |
+                             (quint32(p[2]) << 8) | p[3]
+                       : (quint32(p[3]) << 24) | (quint32(p[2]) << 16) |
+                             (quint32(p[1]) << 8) | p[0];
+  }
+
+private:
+  const QByteArray &m_data;
+  qsizetype m_base;
+  bool m_bigEndian;
+};
+
+// 解析 JPEG 的 APP1/Exif：IFD0 取方向，IFD1 取内嵌缩略图的位置与长度。
+ExifThumbnail readExifThumbnail(const QByteArray &data) {
+  ExifThumbnail result;
+  if (data.size() < 4 || uchar(data[0]) != 0xFF || uchar(data[1]) != 0xD8)
+    return result;
+
+  qsizetype pos = 2;
+  while (pos + 4 <= data.size()) {
+    if (uchar(data[pos]) != 0xFF)
+      return result;
+    const uchar marker = uchar(data[pos + 1]);
+    if (marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7)) {
+      pos += 2;
+      continue;
+    }
+    // 到了帧或扫描数据，后面不会再有 APP1。
+    if (marker == 0xDA || (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+                           marker != 0xC8 && marker != 0xCC))
+      return result;
+    const int length = (uchar(data[pos + 2]) << 8) | uchar(data[pos + 3]);
+    if (length < 2)
+      return result;
+    if (marker == 0xE1 && length >= 16 &&
+        data.mid(pos + 4, 6) == QByteArrayLiteral("Exif\0\0")) {
+      const qsizetype tiff = pos + 10;
+      const qsizetype segmentEnd = std::min<qsizetype>(pos + 2 + length,
+                                                       data.size());
+      const QByteArray segment = data.left(segmentEnd);
+      if (tiff + 8 > segment.size())
+        return result;
+      const bool bigEndian = segment.mid(tiff, 2) == "MM";
+      if (!bigEndian && segment.mid(tiff, 2) != "II")
+        return result;
+      const TiffReader reader(segment, tiff, bigEndian);
+      if (reader.u16(2) != 42)
+        return result;
+
+      quint32 ifd = reader.u32(4);
+      for (int ifdIndex = 0; ifdIndex < 2 && ifd != 0; ++ifdIndex) {
+        if (!reader.has(ifd, 2))
+          return result;
+        const int count = reader.u16(ifd);
+        if (!reader.has(ifd + 2, count * 12 + 4))
+          return result;
+        quint32 thumbOffset = 0;
+        quint32 thumbLength = 0;
+        for (int i = 0; i < count; ++i) {
+          const qsizetype entry = ifd + 2 + i * 12;
+          const quint16 tag = reader.u16(entry);
+          if (ifdIndex == 0 && tag == 0x0112)
+            result.orientation = reader.u16(entry + 8);
+          else if (ifdIndex == 1 && tag == 0x0201)
+            thumbOffset = reader.u32(entry + 8);
+          else if (ifdIndex == 1 && tag == 0x0202)
+            thumbLength = reader.u32(entry + 8);
+        }
+        if (ifdIndex == 1 && thumbOffset > 0 && thumbLength > 0 &&
+            reader.has(thumbOffset, thumbLength)) {
+          result.jpeg = segment.mid(tiff + thumbOffset, thumbLength);
+        }
+        ifd = reader.u32(ifd + 2 + count * 12);
+      }
+      return result;
+    }
+    pos += 2 + length;
+  }
+  return result;
+}
+
+// freedesktop 缩略图规范的尺寸档位：normal 128、large 256、x-large 512。
+QString sizeBucket(int edge) {
+  if (edge <= 128)
+    return QStringLiteral("normal");
+  if (edge <= 256)
+    return QStringLiteral("large");
+  return QStringLiteral("x-large");
+}
+
+int bucketEdge(int edge) { return edge <= 128 ? 128 : edge <= 256 ? 256 : 512; }
+
+QString diskCachePath(const QString &uri, int edge) {
+  const QByteArray hash =
+      QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex();
+  return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+         QStringLiteral("/thumbnails/") + sizeBucket(edge) + QLatin1Char('/') +
+         QString::fromLatin1(hash) + QStringLiteral(".png");
+}
+
+QImage readDiskThumbnail(const QString &cachePath, const QString &uri,
+                         qint64 mtimeSeconds) {
+  QImageReader reader(cachePath, "png");
+  if (!reader.canRead() ||
+      reader.text(QStringLiteral("Thumb::URI")) != uri ||
+      reader.text(QStringLiteral("Thumb::MTime")) !=
+          QString::number(mtimeSeconds))
+    return QImage();
+  return reader.read();
+}
+
+void writeDiskThumbnail(const QString &cachePath, const QString &uri,
+                        qint64 mtimeSeconds, QImage image) {
+  const QString directory = QFileInfo(cachePath).absolutePath();
+  if (!QDir().mkpath(directory))
+    return;
+  // 规范要求缓存目录仅本人可读写。
+  QFile::setPermissions(directory, QFileDevice::ReadOwner |
+                                       QFileDevice::WriteOwner |
+                                       QFileDevice::ExeOwner);
+  image.setText(QStringLiteral("Thumb::URI"), uri);
+  image.setText(QStringLiteral("Thumb::MTime"), QString::number(mtimeSeconds));
+
+  QSaveFile file(cachePath);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+  if (!image.save(&file, "png")) {
+    file.cancelWriting();
+    return;
+  }
+  if (file.commit())
+    QFile::setPermissions(cachePath,
+                          QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+}
+
+QImage decodeThumbnail(const QString &path, int edge) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+    return QImage();
+
+  // 内嵌的 EXIF 缩略图（通常 160×120）足够大时直接使用，省去整张解码。
+  const QByteArray head = file.peek(kExifScanBytes);
+  const ExifThumbnail exif = readExifThumbnail(head);
+  if (!exif.jpeg.isEmpty()) {
+    QImage embedded = QImage::fromData(exif.jpeg, "jpeg");
+    if (!embedded.isNull() &&
+        std::max(embedded.width(), embedded.height()) >= edge) {
+      return applyTransformation(embedded,
+                                 orientationTransformation(exif.orientation));
+    }
+  }
+
+  QImageReader reader(&file);
+  reader.setAutoTransform(true);
+  const QSize sourceSize = reader.size();
+  if (sourceSize.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+    QSize scaled = sourceSize;
+    if (std::max(scaled.width(), scaled.height()) > edge)
+      scaled.scale(edge, edge, Qt::KeepAspectRatio);
+    reader.setScaledSize(scaled.expandedTo(QSize(1, 1)));
+  }
+  QImage image = reader.read();
+  if (image.isNull())
+    return image;
+  if (std::max(image.width(), image.height()) > edge)
+    image = image.scaled(edge, edge, Qt::KeepAspectRatio,
+                         Qt::SmoothTransformation);
+  return image;
+}
+
+class ThumbnailResponse : public QQuickImageResponse, public QRunnable {
+public:
+  ThumbnailResponse(ThumbnailProvider *provider, QString path,
+                    const QSize &requestedSize)
+      : m_provider(provider), m_path(std::move(path)),
+        m_requestedSize(requestedSize) {
+    setAutoDelete(false);
+  }
+
+  QQuickTextureFactory *textureFactory() const override {
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+  }
+  QString errorString() const override { return m_error; }
+  void cancel() override {
+    m_cancelled.store(true, std::memory_order_relaxed);
+  }
+
+  void run() override {
+    // 视图在排队期间已经不需要这张图（例如快速滚动时），直接结束。
+    if (!m_cancelled.load(std::memory_order_relaxed)) {
+      const int edge = m_requestedSize.isValid()
+                           ? std::max(m_requestedSize.width(),
+                                      m_requestedSize.height())
+                           : kDefaultEdge;
+      m_image = m_provider->thumbnail(m_path, std::max(edge, 1));
+      if (m_image.isNull())
+        m_error = QStringLiteral("无法读取图片：%1").arg(m_path);
+      else if (m_requestedSize.isValid() &&
+               (m_image.width() > m_requestedSize.width() ||
+                m_image.height() > m_requestedSize.height()))
+        m_image = m_image.scaled(m_requestedSize, Qt::KeepAspectRatio,
+                                 Qt::SmoothTransformation);
+    }
+    emit finished();
+  }
+
+private:
+  ThumbnailProvider *m_provider;
+  QString m_path;
+  QSize m_requestedSize;
+  QImage m_image;
+  QString m_error;
+  std::atomic_bool m_cancelled{false};
+};
+} // namespace
+
+ThumbnailProvider::ThumbnailProvider(FileMetadataCache *metadata,
+                                     qint64 memoryBudgetBytes)
+    : m_metadata(metadata) {
+  m_memoryCache.setMaxCost(memoryBudgetBytes);
+  // 缩略图解码以 I/O 为主，线程不宜过多，以免与转换任务抢占磁盘。
+  m_pool.setMaxThreadCount(
+      std::clamp(QThread::idealThreadCount() / 2, 1, 4));
+}
+
+ThumbnailProvider::~ThumbnailProvider() { m_pool.waitForDone(); }
+
+QQuickImageResponse *
+ThumbnailProvider::requestImageResponse(const QString &id,
+                                        const QSize &requestedSize) {
+  // QML 端对路径做了百分号编码，Qt 只解码其中一部分，这里统一还原。
+  const QString path = QUrl::fromPercentEncoding(id.toUtf8());
+  auto *response = new ThumbnailResponse(this, path, requestedSize);
+  m_pool.start(response);
+  return response;
+}
+
+QImage ThumbnailProvider::thumbnail(const QString &path, int edge) {
+  const FileMetadata metadata = m_metadata->metadata(path);
+  if (metadata.size < 0)
+    return QImage();
+
+  const int bucket = bucketEdge(edge);
+  const QString key = path + QLatin1Char('\n') +
+                      QString::number(metadata.modifiedMsecs) +
+                      QLatin1Char('\n') + QString::number(bucket);
+  QImage image = cachedThumbnail(key);
+  if (!image.isNull())
+    return image;
+
+  const QString uri = QUrl::fromLocalFile(path).toString(QUrl::FullyEncoded);
+  const qint64 mtimeSeconds = metadata.modifiedMsecs / 1000;
+  const QString cachePath = diskCachePath(uri, bucket);
+  image = readDiskThumbnail(cachePath, uri, mtimeSeconds);
+  if (image.isNull()) {
+    image = decodeThumbnail(path, bucket);
+    if (image.isNull())
+      return image;
+    writeDiskThumbnail(cachePath, uri, mtimeSeconds, image);
+  }
+  storeThumbnail(key, image);
+  return image;
+}
+
+QImage ThumbnailProvider::cachedThumbnail(const QString &key) {
+  QMutexLocker locker(&m_cacheMutex);
+  const QImage *image = m_memoryCache.object(key);
+  return image ? *image : QImage();
+}
+
+void ThumbnailProvider::storeThumbnail(const QString &key, const QImage &image) {
+  QMutexLocker locker(&m_cacheMutex);
+  m_memoryCache.insert(key, new QImage(image), image.sizeInBytes());
+}
@@ -0,0 +1,278 @@
+#include "pdfdocument.h"
+#include "pdfreader.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+#include <cstdio>
+#include <vector>
+
+namespace {
+// 1×1 的未压缩灰度图像，页面内容无关紧要，只要能写进页面树。
+PdfImage pixelImage() {
+  PdfImage image;
+  image.width = 1;
+  image.height = 1;
+  image.components = 1;
+  image.data = QByteArray(1, '\x80');
+  return image;
+}
+
+bool addPages(PdfDocument *document, int pages) {
+  for (int i = 0; i < pages; ++i) {
+    const int image = document->addImage(pixelImage());
+    if (!document->addPage(QSizeF(595, 842), QRectF(0, 0, 595, 842), image))
+      return false;
+  }
+  return true;
+}
+
+// 由 PdfDocument 新建的文件：传统 xref 表，没有 /Prev。
+bool writeClassicPdf(const QString &path, int pages) {
+  PdfDocument document(path);
+  return document.open() && addPages(&document, pages) && document.finish();
+}
+
+// 交叉引用流的一行：类型、偏移或对象流号、代数或流内序号。
+struct XrefRow {
+  int type;
+  quint32 second;
+  quint16 third;
+};
+
+// 按 /W [1 4 2] 排列各行，每行前加 PNG Up 预测器的过滤字节。
+QByteArray predictedXrefRows(const std::vector<XrefRow> &rows) {
+  constexpr int kColumns = 7;
+  QByteArray previous(kColumns, '\0');
+  QByteArray predicted;
+  for (const XrefRow &entry : rows) {
+    QByteArray row(kColumns, '\0');
+    row[0] = static_cast<char>(entry.type);
+    qToBigEndian(entry.second, row.data() + 1);
+    qToBigEndian(entry.third, row.data() + 5);
+    predicted.append('\x02');
+    for (int i = 0; i < kColumns; ++i)
+      predicted.append(static_cast<char>(row[i] - previous[i]));
+    previous = row;
+  }
+  return predicted;
+}
+
+// 只有一页的 PDF 1.5 文件主体：目录（1）与页面树根节点（2）放在对象流（4）
+// 里，页面（3）是普通对象。交叉引用由调用方补写。
+QByteArray objectStreamBody(qint64 *pageOffset, qint64 *objectStreamOffset) {
+  QByteArray file = "%PDF-1.5\n%\xE2\xE3\xCF\xD3\n";
+
+  const QByteArray catalog = "<< /Type /Catalog /Pages 2 0 R >>";
+  const QByteArray pages = "<< /Type /Pages /Kids [3 0 R] /Count 1 >>";
+  const QByteArray offsets =
+      "1 0 2 " + QByteArray::number(catalog.size() + 1) + " ";
+  const QByteArray objects = catalog + " " + pages;
+  const QByteArray objectStream = offsets + objects;
+
+  *pageOffset = file.size();
+  file += "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 595 842] "
+          ">>\nendobj\n";
+  *objectStreamOffset = file.size();
+  file += "4 0 obj\n<< /Type /ObjStm /N 2 /First " +
+          QByteArray::number(offsets.size()) + " /Length " +
+          QByteArray::number(objectStream.size()) + " >>\nstream\n" +
+          objectStream + "\nendstream\nendobj\n";
+  return file;
+}
+
+bool writeFile(const QString &path, const QByteArray &data) {
+  QFile output(path);
+  return output.open(QIODevice::WriteOnly) && output.write(data) == data.size();
+}
+
+// PDF 1.5 的写法：交叉引用流以 Flate 与 PNG Up 预测器压缩，和常见的
+// PDF 生成器一样。
+bool writeObjectStreamPdf(const QString &path) {
+  qint64 pageOffset = 0;
+  qint64 objectStreamOffset = 0;
+  QByteArray file = objectStreamBody(&pageOffset, &objectStreamOffset);
+  const qint64 xrefOffset = file.size();
+  const QByteArray predicted = predictedXrefRows(
+      {{0, 0, 0xFFFF},
+       {2, 4, 0},
+       {2, 4, 1},
+       {1, static_cast<quint32>(pageOffset), 0},
+       {1, static_cast<quint32>(objectStreamOffset), 0},
+       {1, static_cast<quint32>(xrefOffset), 0}});
+  // qCompress 在 zlib 流之前附加 4 字节长度。
+  const QByteArray compressed = qCompress(predicted).mid(4);
+  file += "5 0 obj\n<< /Type /XRef /Size 6 /W [1 4 2] /Root 1 0 R "
+          "/Filter /FlateDecode /DecodeParms << /Columns 7 /Predictor 12 >> "
+          "/Length " +
+          QByteArray::number(compressed.size()) + " >>\nstream\n" +
+          compressed + "\nendstream\nendobj\nstartxref\n" +
+          QByteArray::number(xrefOffset) + "\n%%EOF\n";
+  return writeFile(path, file);
+}
+
+// 混合引用文件（PDF 1.5 兼容旧读取器的写法）：传统 xref 表把对象流中的
+// 目录与页面树根节点记为空闲，它们的位置只在 /XRefStm 指向的交叉引用流中。
+bool writeHybridPdf(const QString &path) {
+  qint64 pageOffset = 0;
+  qint64 objectStreamOffset = 0;
+  QByteArray file = objectStreamBody(&pageOffset, &objectStreamOffset);
+  const qint64 streamOffset = file.size();
+  const QByteArray rows =
+      qCompress(predictedXrefRows({{2, 4, 0}, {2, 4, 1}})).mid(4);
+  file += "5 0 obj\n<< /Type /XRef /Size 6 /Index [1 2] /W [1 4 2] "
+          "/Filter /FlateDecode /DecodeParms << /Columns 7 /Predictor 12 >> "
+          "/Length " +
+          QByteArray::number(rows.size()) + " >>\nstream\n" + rows +
+          "\nendstream\nendobj\n";
+
+  const qint64 xrefOffset = file.size();
+  char entry[32];
+  QByteArray xref = "xref\n0 6\n0000000000 65535 f \n"
+                    "0000000000 00000 f \n0000000000 00000 f \n";
+  for (qint64 offset : {pageOffset, objectStreamOffset, streamOffset}) {
+    std::snprintf(entry, sizeof(entry), "%010lld 00000 n \n",
+                  static_cast<long long>(offset));
+    xref += entry;
+  }
+  file += xref + "trailer\n<< /Size 6 /Root 1 0 R /XRefStm " +
+          QByteArray::number(streamOffset) + " >>\nstartxref\n" +
+          QByteArray::number(xrefOffset) + "\n%%EOF\n";
+  return writeFile(path, file);
+}
+
+bool appendPages(const QString &path, int pages) {
+  PdfAppendBase base;
+  QString error;
+  if (!readPdfAppendBase(path, &base, &error))
+    return false;
+  PdfDocument document(path);
+  return document.openForAppend(base) && addPages(&document, pages) &&
+         document.finish();
+}
+
+// startxref 指向的那一节（xref 表的 trailer 或交叉引用流的字典）中的
+// /Prev，没有时返回 -1。
+qint64 previousXref(const QString &path, qint64 startXref) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly) || !file.seek(startXref))
+    return -2;
+  QByteArray section = file.readAll();
+  section.truncate(section.indexOf("startxref"));
+  static const QRegularExpression prev(QStringLiteral("/Prev\\s+(\\d+)"));
+  const QRegularExpressionMatch match =
+      prev.match(QString::fromLatin1(section));
+  return match.hasMatch() ? match.captured(1).toLongLong() : -1;
+}
+
+PdfAppendBase readBase(const QString &path) {
+  PdfAppendBase base;
+  QString error;
+  if (!readPdfAppendBase(path, &base, &error))
+    qWarning("%s", qPrintable(error));
+  return base;
+}
+} // namespace
+
+// 追加后用 readPdfAppendBase 重新解析：页数包含新旧页面，页面树根节点的
+// /Kids 逐一列出，各节交叉引用经 /Prev 连回原文件。
+class PdfAppendTest : public QObject {
+  Q_OBJECT
+
+private slots:
+  void appendToClassicXref();
+  void appendToXrefStream();
+  void appendToHybridReference();
+  void appendTwice_data();
+  void appendTwice();
+
+private:
+  QTemporaryDir m_dir;
+};
+
+void PdfAppendTest::appendToClassicXref() {
+  const QString path = m_dir.filePath(QStringLiteral("classic.pdf"));
+  QVERIFY(writeClassicPdf(path, 2));
+  const PdfAppendBase original = readBase(path);
+  QCOMPARE(original.pageCount, 2);
+  QVERIFY(!original.usesXrefStream);
+  QCOMPARE(previousXref(path, original.startXref), qint64(-1));
+
+  QVERIFY(appendPages(path, 3));
+  const PdfAppendBase appended = readBase(path);
+  QCOMPARE(appended.pageCount, 5);
+  QCOMPARE(appended.pagesDictionary.count(" 0 R"), qsizetype(5));
+  QVERIFY(!appended.usesXrefStream);
+  QCOMPARE(appended.pagesObject, original.pagesObject);
+  QVERIFY(appended.startXref > original.fileSize);
+  QCOMPARE(previousXref(path, appended.startXref), original.startXref);
+}
+
+void PdfAppendTest::appendToXrefStream() {
+  const QString path = m_dir.filePath(QStringLiteral("objstm.pdf"));
+  QVERIFY(writeObjectStreamPdf(path));
+  const PdfAppendBase original = readBase(path);
+  QCOMPARE(original.pageCount, 1);
+  QVERIFY(original.usesXrefStream);
+  QCOMPARE(original.size, 6);
+
+  QVERIFY(appendPages(path, 2));
+  const PdfAppendBase appended = readBase(path);
+  QCOMPARE(appended.pageCount, 3);
+  QCOMPARE(appended.pagesDictionary.count(" 0 R"), qsizetype(3));
+  QVERIFY(appended.usesXrefStream);
+  QCOMPARE(appended.pagesObject, 2);
+  // 两页各占图像、内容与页面三个对象，另有新的交叉引用流。
+  QCOMPARE(appended.size, original.size + 2 * 3 + 1);
+  QCOMPARE(previousXref(path, appended.startXref), original.startXref);
+}
+
+void PdfAppendTest::appendToHybridReference() {
+  const QString path = m_dir.filePath(QStringLiteral("hybrid.pdf"));
+  QVERIFY(writeHybridPdf(path));
+  const PdfAppendBase original = readBase(path);
+  QCOMPARE(original.pageCount, 1);
+  QVERIFY(!original.usesXrefStream);
+  QCOMPARE(original.pagesObject, 2);
+
+  QVERIFY(appendPages(path, 2));
+  const PdfAppendBase appended = readBase(path);
+  QCOMPARE(appended.pageCount, 3);
+  QCOMPARE(appended.pagesDictionary.count(" 0 R"), qsizetype(3));
+  QCOMPARE(previousXref(path, appended.startXref), original.startXref);
+}
+
+void PdfAppendTest::appendTwice_data() {
+  QTest::addColumn<bool>("objectStreams");
+  QTest::newRow("classic xref") << false;
+  QTest::newRow("xref stream") << true;
+}
+
+void PdfAppendTest::appendTwice() {
+  QFETCH(bool, objectStreams);
+  const QString path = m_dir.filePath(
+      objectStreams ? QStringLiteral("twice-objstm.pdf")
+                    : QStringLiteral("twice-classic.pdf"));
+  QVERIFY(objectStreams ? writeObjectStreamPdf(path)
+                        : writeClassicPdf(path, 1));
+  const PdfAppendBase original = readBase(path);
+  QCOMPARE(original.pageCount, 1);
+
+  QVERIFY(appendPages(path, 2));
+  const PdfAppendBase first = readBase(path);
+  QVERIFY(appendPages(path, 4));
+  const PdfAppendBase second = readBase(path);
+
+  QCOMPARE(first.pageCount, 3);
+  QCOMPARE(second.pageCount, 7);
+  QCOMPARE(second.pagesDictionary.count(" 0 R"), qsizetype(7));
+  QCOMPARE(second.usesXrefStream, objectStreams);
+  QCOMPARE(previousXref(path, second.startXref), first.startXref);
+  QCOMPARE(previousXref(path, first.startXref), original.startXref);
+  QCOMPARE(previousXref(path, original.startXref), qint64(-1));
+}
+
+QTEST_GUILESS_MAIN(PdfAppendTest)
+#include "tst_pdfappend.moc"